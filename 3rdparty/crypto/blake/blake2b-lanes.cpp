@@ -0,0 +1,313 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "blake2b-lanes.h"
+#include <string.h>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define BLAKE2B_LANES_X86
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       define BLAKE2B_TARGET_AVX2
+#   else
+#       define BLAKE2B_TARGET_AVX2 __attribute__((target("avx2")))
+#   endif
+#endif
+
+namespace
+{
+    const uint64_t s_IV[8] =
+    {
+        0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+        0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+        0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+        0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+    };
+
+    const uint8_t s_Sigma[12][16] =
+    {
+        {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+        { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+        { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+        {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+        {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+        {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+        { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+        { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+        {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+        { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+        {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+        { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+    };
+
+    uint64_t Load64(const uint8_t* p)
+    {
+        uint64_t x = 0;
+        for (int i = 8; i--; )
+            x = (x << 8) | p[i];
+        return x;
+    }
+
+    void Store64(uint8_t* p, uint64_t x)
+    {
+        for (int i = 0; i < 8; i++, x >>= 8)
+            p[i] = static_cast<uint8_t>(x);
+    }
+
+    uint64_t RotR64(uint64_t x, unsigned int n)
+    {
+        return (x >> n) | (x << (64 - n));
+    }
+
+    // The message words shared by all the lanes: the buffered prefix, zero-padded
+    struct Message
+    {
+        uint64_t m_p[16];
+        uint32_t m_iWord;
+        uint32_t m_nShift;
+
+        Message(const blake2b_lanes_ctx& ctx)
+        {
+            uint8_t pBlock[128];
+            memcpy(pBlock, ctx.buf, ctx.buflen);
+            memset(pBlock + ctx.buflen, 0, sizeof(pBlock) - ctx.buflen);
+
+            for (uint32_t i = 0; i < 16; i++)
+                m_p[i] = Load64(pBlock + i * 8);
+
+            m_iWord = ctx.buflen / 8;
+            m_nShift = (ctx.buflen % 8) * 8;
+        }
+
+        // the lane suffix may span 2 words
+        uint64_t get_Word(uint32_t i, uint32_t nSuffix) const
+        {
+            uint64_t x = m_p[i];
+            if (i == m_iWord)
+                x |= static_cast<uint64_t>(nSuffix) << m_nShift;
+            else if ((i == m_iWord + 1) && (m_nShift > 32))
+                x |= static_cast<uint64_t>(nSuffix) >> (64 - m_nShift);
+            return x;
+        }
+    };
+
+    void StoreHash(const uint64_t* pH, uint8_t* pOut, size_t outlen)
+    {
+        uint8_t pBuf[64];
+        for (uint32_t i = 0; i < 8; i++)
+            Store64(pBuf + i * 8, pH[i]);
+        memcpy(pOut, pBuf, outlen);
+    }
+
+    void FinalPortable(const blake2b_lanes_ctx& ctx, const Message& msg, uint32_t nSuffix, uint8_t* pOut, size_t outlen)
+    {
+        uint64_t m[16], v[16];
+        for (uint32_t i = 0; i < 16; i++)
+            m[i] = msg.get_Word(i, nSuffix);
+
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            v[i] = ctx.h[i];
+            v[i + 8] = s_IV[i];
+        }
+
+        v[12] ^= ctx.counter + ctx.buflen + 4;
+        v[14] = ~v[14]; // last block
+
+#define BLAKE2B_LANES_G(r, i, a, b, c, d) \
+        a = a + b + m[s_Sigma[r][2 * i]]; \
+        d = RotR64(d ^ a, 32); \
+        c = c + d; \
+        b = RotR64(b ^ c, 24); \
+        a = a + b + m[s_Sigma[r][2 * i + 1]]; \
+        d = RotR64(d ^ a, 16); \
+        c = c + d; \
+        b = RotR64(b ^ c, 63);
+
+        for (uint32_t r = 0; r < 12; r++)
+        {
+            BLAKE2B_LANES_G(r, 0, v[0], v[4], v[8], v[12])
+            BLAKE2B_LANES_G(r, 1, v[1], v[5], v[9], v[13])
+            BLAKE2B_LANES_G(r, 2, v[2], v[6], v[10], v[14])
+            BLAKE2B_LANES_G(r, 3, v[3], v[7], v[11], v[15])
+            BLAKE2B_LANES_G(r, 4, v[0], v[5], v[10], v[15])
+            BLAKE2B_LANES_G(r, 5, v[1], v[6], v[11], v[12])
+            BLAKE2B_LANES_G(r, 6, v[2], v[7], v[8], v[13])
+            BLAKE2B_LANES_G(r, 7, v[3], v[4], v[9], v[14])
+        }
+
+#undef BLAKE2B_LANES_G
+
+        uint64_t h[8];
+        for (uint32_t i = 0; i < 8; i++)
+            h[i] = ctx.h[i] ^ v[i] ^ v[i + 8];
+
+        StoreHash(h, pOut, outlen);
+    }
+
+#ifdef BLAKE2B_LANES_X86
+
+    bool IsAvx2Supported()
+    {
+#   if defined(_MSC_VER)
+        int pRegs[4];
+        __cpuid(pRegs, 0);
+        if (pRegs[0] < 7)
+            return false;
+
+        __cpuid(pRegs, 1);
+        const int nOsxSaveAvx = (1 << 27) | (1 << 28);
+        if ((pRegs[2] & nOsxSaveAvx) != nOsxSaveAvx)
+            return false;
+        if ((_xgetbv(0) & 6) != 6)
+            return false; // YMM state isn't preserved by the OS
+
+        __cpuidex(pRegs, 7, 0);
+        return 0 != (pRegs[1] & (1 << 5));
+#   else
+        __builtin_cpu_init();
+        return 0 != __builtin_cpu_supports("avx2");
+#   endif
+    }
+
+    // 4 lanes, each 64-bit element of the vector belongs to a different lane
+    BLAKE2B_TARGET_AVX2 void FinalAvx2x4(const blake2b_lanes_ctx& ctx, const Message& msg, const uint32_t* pSuffix, uint8_t* pOut, size_t outlen)
+    {
+        __m256i m[16], v[16];
+        for (uint32_t i = 0; i < 16; i++)
+            m[i] = _mm256_set1_epi64x(msg.m_p[i]);
+
+        // only the suffix words differ
+        for (uint32_t i = msg.m_iWord; (i < 16) && (i <= msg.m_iWord + 1); i++)
+        {
+            m[i] = _mm256_set_epi64x(
+                msg.get_Word(i, pSuffix[3]),
+                msg.get_Word(i, pSuffix[2]),
+                msg.get_Word(i, pSuffix[1]),
+                msg.get_Word(i, pSuffix[0]));
+        }
+
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            v[i] = _mm256_set1_epi64x(ctx.h[i]);
+            v[i + 8] = _mm256_set1_epi64x(s_IV[i]);
+        }
+
+        v[12] = _mm256_set1_epi64x(s_IV[4] ^ (ctx.counter + ctx.buflen + 4));
+        v[14] = _mm256_set1_epi64x(~s_IV[6]); // last block
+
+        const __m256i r16 = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9);
+        const __m256i r24 = _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10);
+
+#define BLAKE2B_LANES_G(r, i, a, b, c, d) \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[s_Sigma[r][2 * i]]); \
+        d = _mm256_shuffle_epi32(_mm256_xor_si256(d, a), _MM_SHUFFLE(2, 3, 0, 1)); \
+        c = _mm256_add_epi64(c, d); \
+        b = _mm256_shuffle_epi8(_mm256_xor_si256(b, c), r24); \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[s_Sigma[r][2 * i + 1]]); \
+        d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), r16); \
+        c = _mm256_add_epi64(c, d); \
+        b = _mm256_xor_si256(b, c); \
+        b = _mm256_or_si256(_mm256_srli_epi64(b, 63), _mm256_add_epi64(b, b));
+
+        // unrolled, so that the message words are addressed directly
+#define BLAKE2B_LANES_ROUND(r) \
+        BLAKE2B_LANES_G(r, 0, v[0], v[4], v[8], v[12]) \
+        BLAKE2B_LANES_G(r, 1, v[1], v[5], v[9], v[13]) \
+        BLAKE2B_LANES_G(r, 2, v[2], v[6], v[10], v[14]) \
+        BLAKE2B_LANES_G(r, 3, v[3], v[7], v[11], v[15]) \
+        BLAKE2B_LANES_G(r, 4, v[0], v[5], v[10], v[15]) \
+        BLAKE2B_LANES_G(r, 5, v[1], v[6], v[11], v[12]) \
+        BLAKE2B_LANES_G(r, 6, v[2], v[7], v[8], v[13]) \
+        BLAKE2B_LANES_G(r, 7, v[3], v[4], v[9], v[14])
+
+        BLAKE2B_LANES_ROUND(0)
+        BLAKE2B_LANES_ROUND(1)
+        BLAKE2B_LANES_ROUND(2)
+        BLAKE2B_LANES_ROUND(3)
+        BLAKE2B_LANES_ROUND(4)
+        BLAKE2B_LANES_ROUND(5)
+        BLAKE2B_LANES_ROUND(6)
+        BLAKE2B_LANES_ROUND(7)
+        BLAKE2B_LANES_ROUND(8)
+        BLAKE2B_LANES_ROUND(9)
+        BLAKE2B_LANES_ROUND(10)
+        BLAKE2B_LANES_ROUND(11)
+
+#undef BLAKE2B_LANES_ROUND
+#undef BLAKE2B_LANES_G
+
+        uint64_t pH[8][4];
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            __m256i h = _mm256_xor_si256(_mm256_set1_epi64x(ctx.h[i]), _mm256_xor_si256(v[i], v[i + 8]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pH[i]), h);
+        }
+
+        for (uint32_t iLane = 0; iLane < 4; iLane++)
+        {
+            uint64_t h[8];
+            for (uint32_t i = 0; i < 8; i++)
+                h[i] = pH[i][iLane];
+
+            StoreHash(h, pOut + iLane * outlen, outlen);
+        }
+    }
+
+    const bool s_bAvx2Supported = IsAvx2Supported();
+    bool s_bAvx2 = s_bAvx2Supported;
+
+#endif // BLAKE2B_LANES_X86
+}
+
+void blake2b_lanes_final_u32(const blake2b_lanes_ctx* pCtx, const uint32_t* pSuffix, size_t nLanes, uint8_t* pOut, size_t outlen)
+{
+    assert(pCtx->buflen + 4 <= sizeof(pCtx->buf));
+    assert(outlen <= 64);
+
+    Message msg(*pCtx);
+
+#ifdef BLAKE2B_LANES_X86
+    if (s_bAvx2)
+    {
+        for (; nLanes >= 4; nLanes -= 4)
+        {
+            FinalAvx2x4(*pCtx, msg, pSuffix, pOut, outlen);
+            pSuffix += 4;
+            pOut += outlen * 4;
+        }
+    }
+#endif // BLAKE2B_LANES_X86
+
+    for (size_t i = 0; i < nLanes; i++)
+        FinalPortable(*pCtx, msg, pSuffix[i], pOut + i * outlen, outlen);
+}
+
+size_t blake2b_lanes_width()
+{
+#ifdef BLAKE2B_LANES_X86
+    if (s_bAvx2)
+        return 4;
+#endif // BLAKE2B_LANES_X86
+    return 1;
+}
+
+void blake2b_lanes_enable_simd(bool bEnable)
+{
+#ifdef BLAKE2B_LANES_X86
+    s_bAvx2 = bEnable && s_bAvx2Supported;
+#endif // BLAKE2B_LANES_X86
+}
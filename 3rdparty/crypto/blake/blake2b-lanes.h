@@ -0,0 +1,39 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Multi-lane BLAKE2b finalization, for many messages that differ only by a 32-bit suffix (such as the Equihash leaves).
+// All the lanes share the chaining value and the last (partial) block, only the suffix words differ.
+// The AVX2 implementation (4 lanes per compression) is selected at runtime if the CPU supports it, otherwise the portable one is used.
+
+typedef struct blake2b_lanes_ctx
+{
+    uint64_t h[8];       // chaining value, after all the full blocks of the prefix
+    uint8_t  buf[128];   // the remaining prefix bytes
+    uint64_t counter;    // number of bytes compressed before buf
+    uint32_t buflen;     // must leave room for the suffix: buflen + 4 <= 128
+} blake2b_lanes_ctx;
+
+// Hash of prefix||le32(pSuffix[i]) for each lane, written to pOut + i * outlen
+void blake2b_lanes_final_u32(const blake2b_lanes_ctx*, const uint32_t* pSuffix, size_t nLanes, uint8_t* pOut, size_t outlen);
+
+// Number of lanes processed together by the selected implementation (1 for the portable one)
+size_t blake2b_lanes_width();
+
+// Disable (or re-enable, if supported) the SIMD implementation. For tests and benchmarks
+void blake2b_lanes_enable_simd(bool);
@@ -21,6 +21,7 @@
 #else
 #include "blake/sse/blake2.h"
 #endif
+#include "blake/blake2b-lanes.h"
 
 #include <cstring>
 #include <exception>
@@ -41,6 +42,16 @@ void CompressArray(const unsigned char* in, size_t in_len,
                    unsigned char* out, size_t out_len,
                    size_t bit_len, size_t byte_pad=0);
 
+// Snapshot of the state for the multi-lane leaf hashing. Returns false if the buffered input leaves no room for the index
+bool InitHashLanes(const eh_HashState& base_state, blake2b_lanes_ctx& ctx);
+
+// Hash for the index g is the word-wise sum of the leaf hashes from the start of its 16-aligned group up to g
+void GenerateHash(const eh_HashState& base_state, eh_index g,
+                  unsigned char* hash, size_t hLen, size_t N, size_t R);
+// Hashes for g0..g0+nCount-1, sharing the running sums. Written to hash + i * hLen
+void GenerateHashes(const eh_HashState& base_state, eh_index g0, eh_index nCount,
+                    unsigned char* hash, size_t hLen, size_t N, size_t R);
+
 eh_index ArrayToEhIndex(const unsigned char* array);
 eh_trunc TruncateIndex(const eh_index i, const unsigned int ilen);
 
@@ -74,30 +74,86 @@ int EquihashR<N,K,R>::InitialiseState(eh_HashState& base_state)
     return blake2b_init_param(&base_state, &param);
 }
 
+bool InitHashLanes(const eh_HashState& base_state, blake2b_lanes_ctx& ctx)
+{
+#if defined(__ANDROID__) || !defined(BEAM_USE_AVX)
+    if (base_state.f[0] || base_state.t[1])
+        return false;
+    ctx.counter = base_state.t[0];
+#else
+    if (base_state.lastblock)
+        return false;
+    ctx.counter = base_state.counter;
+#endif
+
+    if (base_state.buflen + sizeof(eh_index) > sizeof(ctx.buf))
+        return false;
+
+    static_assert(sizeof(ctx.h) == sizeof(base_state.h));
+    memcpy(ctx.h, base_state.h, sizeof(ctx.h));
+    memcpy(ctx.buf, base_state.buf, base_state.buflen);
+    ctx.buflen = static_cast<uint32_t>(base_state.buflen);
+
+    return true;
+}
+
 void GenerateHash(const eh_HashState& base_state, eh_index g,
                   unsigned char* hash, size_t hLen, size_t N, size_t R )
 {
+    GenerateHashes(base_state, g, 1, hash, hLen, N, R);
+}
 
+void GenerateHashes(const eh_HashState& base_state, eh_index g0, eh_index nCount,
+                    unsigned char* hash, size_t hLen, size_t N, size_t R)
+{
+    assert(hLen <= BLAKE2B_OUTBYTES);
 
-    uint32_t myHash[16] = {0};
-    uint32_t startIndex = g & 0xFFFFFFF0;
+    // without SIMD the backend implementation is used, it's at least as fast as the portable lanes
+    blake2b_lanes_ctx ctx;
+    bool bLanes = (blake2b_lanes_width() > 1) && InitHashLanes(base_state, ctx);
 
-    for (uint32_t g2 = startIndex; g2 <= g; g2++) {
-	    uint32_t tmpHash[16] = {0};
-	 
-	    eh_HashState state;	
-	    state = base_state;
-	    eh_index lei = htole32(g2);
-	    blake2b_update(&state, (const unsigned char*) &lei,
-		                              sizeof(eh_index));
-	    
-	    blake2b_final(&state, (unsigned char*)&tmpHash[0], static_cast<uint8_t>(hLen));
+    const eh_index nGroup = 16;
+    const eh_index gEnd = g0 + nCount;
 
-	    for (uint32_t idx = 0; idx < 16; idx++) myHash[idx] += tmpHash[idx];
-    }
+    // the running sum is reset at each group start, so the leaves are hashed a group at a time
+    for (eh_index g = g0 & ~(nGroup - 1); g < gEnd; g += nGroup) {
+        eh_index nLeafs = std::min(nGroup, gEnd - g);
+
+        unsigned char pLeaf[nGroup][BLAKE2B_OUTBYTES];
+
+        if (bLanes) {
+            eh_index pIdx[nGroup];
+            for (eh_index i = 0; i < nLeafs; i++)
+                pIdx[i] = g + i;
+
+            unsigned char pOut[nGroup * BLAKE2B_OUTBYTES];
+            blake2b_lanes_final_u32(&ctx, pIdx, nLeafs, pOut, hLen);
+
+            for (eh_index i = 0; i < nLeafs; i++)
+                memcpy(pLeaf[i], pOut + i * hLen, hLen);
+        } else {
+            for (eh_index i = 0; i < nLeafs; i++) {
+                eh_HashState state = base_state;
+                eh_index lei = htole32(g + i);
+                blake2b_update(&state, (const unsigned char*) &lei, sizeof(eh_index));
+                blake2b_final(&state, pLeaf[i], static_cast<uint8_t>(hLen));
+            }
+        }
+
+        uint32_t myHash[16] = {0};
+        for (eh_index i = 0; i < nLeafs; i++) {
+            uint32_t tmpHash[16] = {0};
+            memcpy(tmpHash, pLeaf[i], hLen);
+
+            for (uint32_t idx = 0; idx < 16; idx++) myHash[idx] += tmpHash[idx];
 
-    memcpy(hash, &myHash[0], hLen);
-    ZeroizeUnusedBits(N, R, hash, hLen);
+            if (g + i >= g0) {
+                unsigned char* pDst = hash + (g + i - g0) * hLen;
+                memcpy(pDst, &myHash[0], hLen);
+                ZeroizeUnusedBits(N, R, pDst, hLen);
+            }
+        }
+    }
 }
 
 void ExpandArray(const unsigned char* in, size_t in_len,
@@ -438,6 +494,7 @@ bool EquihashR<N,K,R>::OptimisedSolve(const eh_HashState& base_state,
 {
     eh_index init_size { 1U << (CollisionBitLength + 1 - R) };
     eh_index recreate_size { UntruncateIndex(1, 0, CollisionBitLength + 1) };
+    const eh_index nHashesBatch = 16; // hashes are generated in 16-aligned groups, see GenerateHashes
 
     // First run the algorithm with truncated indices
 
@@ -451,9 +508,11 @@ bool EquihashR<N,K,R>::OptimisedSolve(const eh_HashState& base_state,
         size_t lenIndices = sizeof(eh_trunc);
         std::vector<TruncatedStepRow<TruncatedWidth>> Xt;
         Xt.reserve(init_size);
-        unsigned char tmpHash[HashOutput];
+        unsigned char pHashes[nHashesBatch * HashOutput];
         for (eh_index g = 0; Xt.size() < init_size; g++) {
-            GenerateHash(base_state, g, tmpHash, HashOutput, N, R);
+            if (!(g % nHashesBatch))
+                GenerateHashes(base_state, g, nHashesBatch, pHashes, HashOutput, N, R);
+            const unsigned char* tmpHash = pHashes + (g % nHashesBatch) * HashOutput;
             for (eh_index i = 0; i < IndicesPerHashOutput && Xt.size() < init_size; i++) {
                 Xt.emplace_back(tmpHash+(i*GetSizeInBytes(N)), GetSizeInBytes(N), HashLength, CollisionBitLength,
                     static_cast<eh_index>(g*IndicesPerHashOutput)+i, static_cast<unsigned int>(CollisionBitLength + 1));
@@ -560,7 +619,8 @@ bool EquihashR<N,K,R>::OptimisedSolve(const eh_HashState& base_state,
         std::set<std::vector<unsigned char>> solns;
         size_t hashLen;
         size_t lenIndices;
-        unsigned char tmpHash[HashOutput];
+        unsigned char pHashes[nHashesBatch * HashOutput];
+        eh_index gBatch = 0;
         std::vector<boost::optional<std::vector<FullStepRow<FinalFullWidth>>>> X;
         X.reserve(K+1);
 
@@ -571,10 +631,14 @@ bool EquihashR<N,K,R>::OptimisedSolve(const eh_HashState& base_state,
             icv.reserve(recreate_size);
             for (eh_index j = 0; j < recreate_size; j++) {
                 eh_index newIndex { UntruncateIndex(partialSoln.get()[i], j, CollisionBitLength + 1) };
-                if (j == 0 || newIndex % IndicesPerHashOutput == 0) {
-                    GenerateHash(base_state, newIndex/IndicesPerHashOutput,
-                                 tmpHash, HashOutput, N, R);
+                // the indices are consecutive, generate the hashes a group at a time
+                eh_index g = newIndex/IndicesPerHashOutput;
+                if (j == 0 || (g % nHashesBatch == 0 && newIndex % IndicesPerHashOutput == 0)) {
+                    GenerateHashes(base_state, g, nHashesBatch - g % nHashesBatch,
+                                   pHashes, HashOutput, N, R);
+                    gBatch = g;
                 }
+                const unsigned char* tmpHash = pHashes + (g - gBatch) * HashOutput;
                 icv.emplace_back(tmpHash+((newIndex % IndicesPerHashOutput) * GetSizeInBytes(N)),
                                  GetSizeInBytes(N), HashLength, CollisionBitLength, newIndex);
                 if (cancelled(PartialGeneration)) throw solver_cancelled;
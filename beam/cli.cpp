@@ -183,7 +183,7 @@ int main_impl(int argc, char* argv[])
 #define LOG_FILES_PREFIX "node_"
 
 		const auto path = boost::filesystem::system_complete(LOG_FILES_DIR);
-		auto logger = beam::Logger::create(logLevel, logLevel, fileLogLevel, LOG_FILES_PREFIX, path.string());
+		auto logger = beam::Logger::create(logLevel, logLevel, fileLogLevel, LOG_FILES_PREFIX, path.string(), vm[cli::LOG_ASYNC].as<bool>());
 
 		try
 		{
@@ -322,6 +322,12 @@ int main_impl(int argc, char* argv[])
 					if (vm.count(cli::VACUUM))
 						node.m_Cfg.m_ProcessorParams.m_Vacuum = vm[cli::VACUUM].as<bool>();
 
+					if (vm.count(cli::DB_PROFILE) && !node.m_Cfg.m_ProcessorParams.m_DbProfile.Set(vm[cli::DB_PROFILE].as<string>()))
+					{
+						LOG_ERROR() << "unknown DB profile: " << vm[cli::DB_PROFILE].as<string>();
+						return -1;
+					}
+
 					if (vm.count(cli::RESET_ID))
 						node.m_Cfg.m_ProcessorParams.m_ResetSelfID = vm[cli::RESET_ID].as<bool>();
 
@@ -157,6 +157,7 @@ namespace beam
 			:public Sigma::Proof
 		{
 			typedef std::unique_ptr<Proof> Ptr;
+			BEAM_ARENA_ALLOCATED
 
 			Asset::ID m_Begin; // 1st element
 			ECC::Point m_hGen;
@@ -407,6 +408,8 @@ namespace beam
 
 	struct TxElement
 	{
+		BEAM_ARENA_ALLOCATED // inputs and outputs are allocated in bulk during the block deserialization
+
 		ECC::Point m_Commitment;
 		int cmp(const TxElement&) const;
 	};
@@ -591,6 +594,7 @@ namespace beam
 	struct TxKernel
 	{
 		typedef std::unique_ptr<TxKernel> Ptr;
+		BEAM_ARENA_ALLOCATED
 
 		struct Subtype
 		{
@@ -266,13 +266,13 @@ namespace beam
 
 	void MappedFile::EnsureReserve(uint32_t iBank, uint32_t nSize, uint32_t nMinFree)
 	{
+		nSize = AlignUp(nSize, sizeof(Offset));
+
 		while (get_Bank(iBank).m_Free < nMinFree)
 		{
-			// grow
+			// grow, at least by a page, and enough for at least 1 element
 			Offset n0 = m_nMapping;
-			Offset n1 = AlignUp(n0, s_PageSize) + s_PageSize;
-
-			nSize = AlignUp(nSize, sizeof(Offset));
+			Offset n1 = AlignUp(n0, s_PageSize) + AlignUp(nSize, s_PageSize);
 
 			CloseMapping();
 			Resize(n1);
@@ -32,6 +32,7 @@ ProtocolPlus::ProtocolPlus(uint8_t v0, uint8_t v1, uint8_t v2, size_t maxMessage
 void ProtocolPlus::ResetVars()
 {
     m_Mode = Mode::Plaintext;
+    m_InMsgSize = 0;
     m_MyNonce = Zero;
     m_RemoteNonce = Zero;
 }
@@ -49,6 +50,8 @@ uint32_t ProtocolPlus::get_MacSize()
 
 bool ProtocolPlus::VerifyMsg(const uint8_t* p, uint32_t nSize)
 {
+    m_InMsgSize = nSize;
+
     if (Mode::Duplex != m_Mode)
         return true;
 
@@ -245,6 +248,67 @@ bool Bbs::Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAd
     return (hvMac == hvMac2);
 }
 
+bool Bbs::Decryptor::Init(const void* p, uint32_t n)
+{
+    ECC::Hash::Value hvMac;
+    if (n < m_RemotePublic.nBytes + hvMac.nBytes)
+        return false;
+
+    m_pMsg = reinterpret_cast<const uint8_t*>(p);
+    m_nMsg = n;
+    memcpy(m_RemotePublic.m_pData, m_pMsg, m_RemotePublic.nBytes);
+
+    ECC::Point::Native pt;
+    if (!m_RemotePublic.ExportNnz(pt))
+        return false;
+
+    // the same precalculated multiples are used for all the attempts. In secure mode they're not modified by the multiplication
+    ECC::Mode::Scope scope(ECC::Mode::Secure);
+    m_Casual.Init(pt);
+    return true;
+}
+
+bool Bbs::Decryptor::Decrypt(ByteBuffer& res, const ECC::Scalar::Native& privateAddr, const PeerID& publicAddr)
+{
+    ECC::Point::Native ptSecret;
+    {
+        ECC::Mode::Scope scope(ECC::Mode::Secure);
+
+        ECC::MultiMac mm;
+        mm.m_pCasual = &m_Casual;
+        mm.m_Casual = 1;
+        mm.m_pKCasual = Cast::NotConst(&privateAddr);
+        mm.Calculate(ptSecret);
+    }
+
+    ECC::NoLeak<ECC::Hash::Value> hvSecret;
+    ECC::Hash::Processor() << ptSecret >> hvSecret.V;
+
+    AES::Encoder enc;
+    enc.Init(hvSecret.V.m_pData);
+
+    ECC::Hash::Mac hmac;
+    hmac.Reset(hvSecret.V.m_pData, hvSecret.V.nBytes);
+
+    AES::StreamCipher cIn;
+    InitCipherIV(cIn, hvSecret.V, publicAddr);
+
+    ECC::Hash::Value hvMac, hvMac2;
+    const uint8_t* pSrc = m_pMsg + m_RemotePublic.nBytes;
+    memcpy(hvMac.m_pData, pSrc, hvMac.nBytes);
+    cIn.XCrypt(enc, hvMac.m_pData, hvMac.nBytes);
+
+    pSrc += hvMac.nBytes;
+    res.assign(pSrc, m_pMsg + m_nMsg);
+    if (!res.empty())
+        cIn.XCrypt(enc, &res.front(), static_cast<uint32_t>(res.size()));
+
+    hmac.Write(res.data(), static_cast<uint32_t>(res.size()));
+    hmac >> hvMac2;
+
+    return (hvMac == hvMac2);
+}
+
 void Bbs::get_HashPartial(ECC::Hash::Processor& hp, const BbsMsg& msg)
 {
 	hp
@@ -518,6 +582,14 @@ bool NodeConnection::IsLive() const
     return m_Connection && !m_pAsyncFail;
 }
 
+static uint32_t get_MsgSize(const SerializedMsg& sm)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < sm.size(); i++)
+        n += sm[i].size;
+    return static_cast<uint32_t>(n);
+}
+
 #define THE_MACRO(code, msg) \
 void NodeConnection::Send(const msg& v) \
 { \
@@ -526,6 +598,7 @@ void NodeConnection::Send(const msg& v) \
     m_SerializeCache.clear(); \
     MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v); \
     m_Protocol.Encrypt(m_SerializeCache, ser); \
+    OnTraffic(uint8_t(code), get_MsgSize(m_SerializeCache), true); \
     io::Result res = m_Connection->write_msg(m_SerializeCache); \
     m_SerializeCache.clear(); \
 \
@@ -538,6 +611,7 @@ bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
     try { \
         /* checkpoint */ \
         TestInputMsgContext(code); \
+        OnTraffic(uint8_t(code), m_Protocol.m_InMsgSize, false); \
         return OnMsg2(std::move(v)); \
     } catch (const NodeProcessingException& e) { \
         OnProcessingExc(e); \
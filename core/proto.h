@@ -545,6 +545,20 @@ namespace proto {
 
 		bool Encrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void*, uint32_t); // will fail iff addr is invalid
 		bool Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr);
+
+		// Tries multiple addresses against the same message. The remote public key is imported and prepared for
+		// multiplication once, then each address costs a single DH multiplication, no allocations or copies of the original message.
+		struct Decryptor
+		{
+			bool Init(const void* p, uint32_t n); // fails if the message is malformed
+			bool Decrypt(ByteBuffer& res, const ECC::Scalar::Native& privateAddr, const PeerID& publicAddr); // on success res is the plaintext. Reused between attempts
+
+		private:
+			const uint8_t* m_pMsg;
+			uint32_t m_nMsg;
+			PeerID m_RemotePublic;
+			ECC::MultiMac::Casual m_Casual;
+		};
 	};
 
 	struct TxStatus
@@ -620,6 +634,7 @@ namespace proto {
         };
 
         Mode::Enum m_Mode;
+        uint32_t m_InMsgSize; // size of the last received msg, including header and MAC
 
         typedef uintBig_t<8> MacValue;
         static void get_HMac(ECC::Hash::Mac&, MacValue&);
@@ -746,6 +761,7 @@ namespace proto {
         const Connection* get_Connection() { return m_Connection.get(); }
 
         virtual void OnConnectedSecure() {}
+        virtual void OnTraffic(uint8_t /* nCode */, uint32_t /* nSize */, bool /* bOut */) {} // for stats
 
         struct ByeReason
         {
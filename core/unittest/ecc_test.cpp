@@ -1560,6 +1560,28 @@ void TestBbs()
 	n = (uint32_t) buf.size();
 
 	verify_test(!beam::proto::Bbs::Decrypt(p, n, privateAddr));
+
+	// multiple candidate addresses, only one of them is valid
+	Scalar::Native pSk[3];
+	beam::PeerID pPk[_countof(pSk)];
+	for (uint32_t i = 0; i < _countof(pSk); i++)
+	{
+		SetRandom(pSk[i]);
+		pPk[i].FromSk(pSk[i]);
+	}
+
+	verify_test(beam::proto::Bbs::Encrypt(buf, pPk[1], nonce, szMsg, sizeof(szMsg)));
+	beam::ByteBuffer buf2 = buf, res;
+
+	beam::proto::Bbs::Decryptor dec;
+	verify_test(!dec.Init(&buf.front(), 10));
+	verify_test(dec.Init(&buf.front(), (uint32_t) buf.size()));
+
+	verify_test(!dec.Decrypt(res, pSk[0], pPk[0]));
+	verify_test(!dec.Decrypt(res, pSk[2], pPk[2]));
+	verify_test(dec.Decrypt(res, pSk[1], pPk[1]));
+	verify_test((res.size() == sizeof(szMsg)) && !memcmp(&res.front(), szMsg, res.size()));
+	verify_test(buf == buf2); // original message is intact
 }
 
 void TestRatio(const beam::Difficulty& d0, const beam::Difficulty& d1, double k)
@@ -14,19 +14,21 @@
 
 #include "adapter.h"
 #include "node/node.h"
+#include "utility/metrics.h"
 #include "core/serialization_adapters.h"
 #include "http/http_msg_creator.h"
 #include "http/http_json_serializer.h"
 #include "nlohmann/json.hpp"
 #include "utility/helpers.h"
 #include "utility/logger.h"
+#include <mutex>
 
 namespace beam { namespace explorer {
 
 namespace {
 
 static const size_t PACKER_FRAGMENTS_SIZE = 4096;
-static const size_t CACHE_DEPTH = 100000;
+static const size_t CACHE_MAX_BYTES = 64 * 1024 * 1024;
 
 const char* hash_to_hex(char* buf, const Merkle::Hash& hash) {
     return to_hex(buf, hash.m_pData, hash.nBytes);
@@ -47,45 +49,102 @@ const char* difficulty_to_hex(char* buf, const Difficulty& d) {
     return uint256_to_hex(buf, raw);
 }
 
-struct ResponseCache {
+/// Serialized responses for blocks and block ranges. The bodies are immutable unless the
+/// chain is rolled back, hence the eviction is LRU and the invalidation is on rollback only.
+/// Blocks cache is thread-safe: read by the http thread, updated by the node thread
+class ResponseCache {
+public:
+    // node thread only
     io::SharedBuffer status;
-    std::map<Height, io::SharedBuffer> blocks;
     Height currentHeight=0;
 
-    explicit ResponseCache(size_t depth) : _depth(depth)
+    explicit ResponseCache(size_t maxBytes) : _maxBytes(maxBytes)
     {}
 
-    void compact() {
-        if (blocks.empty() || currentHeight <= _depth) return;
-        Height horizon = currentHeight - _depth;
-        if (blocks.rbegin()->first < horizon) {
-            blocks.clear();
-            return;
-        }
-        auto b = blocks.begin();
-        auto it = b;
-        while (it != blocks.end()) {
-            if (it->first >= horizon) break;
-            ++it;
+    bool get_block(io::SerializedMsg& out, Height h) {
+        return get(out, Key{ h, 0 });
+    }
+
+    void put_block(Height h, const io::SharedBuffer& body) {
+        put(Key{ h, 0 }, body);
+    }
+
+    bool get_blocks(io::SerializedMsg& out, Height startHeight, uint64_t n) {
+        return get(out, Key{ startHeight, n });
+    }
+
+    void put_blocks(Height startHeight, uint64_t n, const io::SharedBuffer& body) {
+        put(Key{ startHeight, n }, body);
+    }
+
+    /// Drops everything that refers to heights >= h
+    void rollback(Height h) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto it = _entries.begin(); it != _entries.end(); ) {
+            auto itNext = std::next(it);
+            if (it->first.get_top() >= h) {
+                erase(it);
+            }
+            it = itNext;
         }
-        blocks.erase(b, it);
     }
 
-    bool get_block(io::SerializedMsg& out, Height h) {
-        const auto& it = blocks.find(h);
-        if (it == blocks.end()) return false;
-        out.push_back(it->second);
+private:
+    struct Key {
+        Height h;
+        uint64_t n; // 0 for a single block
+
+        Height get_top() const { return n ? h + n - 1 : h; }
+
+        bool operator < (const Key& k) const {
+            return (h < k.h) || ((h == k.h) && (n < k.n));
+        }
+    };
+
+    struct Entry {
+        io::SharedBuffer body;
+        std::list<Key>::iterator lru;
+    };
+
+    using Map = std::map<Key, Entry>;
+
+    bool get(io::SerializedMsg& out, const Key& key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it == _entries.end()) return false;
+        _lru.splice(_lru.end(), _lru, it->second.lru);
+        out.push_back(it->second.body);
         return true;
     }
 
-    void put_block(Height h, const io::SharedBuffer& body) {
-        if (currentHeight - h > _depth) return;
-        compact();
-        blocks[h] = body;
+    void put(const Key& key, const io::SharedBuffer& body) {
+        if (body.size > _maxBytes) return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        if (it != _entries.end()) erase(it);
+
+        while (!_lru.empty() && (_bytes + body.size > _maxBytes)) {
+            erase(_entries.find(_lru.front()));
+        }
+
+        Entry& e = _entries[key];
+        e.body = body;
+        e.lru = _lru.insert(_lru.end(), key);
+        _bytes += body.size;
     }
 
-private:
-    size_t _depth;
+    void erase(Map::iterator it) {
+        _bytes -= it->second.body.size;
+        _lru.erase(it->second.lru);
+        _entries.erase(it);
+    }
+
+    std::mutex _mutex;
+    Map _entries;
+    std::list<Key> _lru; // least recently used first
+    size_t _bytes = 0;
+    size_t _maxBytes;
 };
 
 using nlohmann::json;
@@ -101,9 +160,14 @@ public:
         _nodeBackend(node.get_Processor()),
         _statusDirty(true),
         _nodeIsSyncing(true),
-        _cache(CACHE_DEPTH)
+        _cache(CACHE_MAX_BYTES)
     {
         init_helper_fragments();
+
+        if (node.m_Cfg.m_ProcessorParams.m_DbProfile.m_Wal) {
+            _reader.path = node.m_Cfg.m_sPathLocal; // opened on the first use, the node creates the DB
+        }
+
         _hook = &node.m_Cfg.m_Observer;
         _nextHook = *_hook;
         *_hook = this;
@@ -150,9 +214,7 @@ private:
 
     void OnRolledBack(const Block::SystemState::ID& id) override {
 
-        auto& blocks = _cache.blocks;
-
-        blocks.erase(blocks.lower_bound(id.m_Height), blocks.end());
+        _cache.rollback(id.m_Height);
 
         if (_nextHook) _nextHook->OnRolledBack(id);
     }
@@ -189,8 +251,77 @@ private:
         return true;
     }
 
-    bool extract_row(Height height, uint64_t& row, uint64_t* prevRow) {
-        NodeDB& db = _nodeBackend.get_DB();
+    /// The blocks are read either on the node thread, with the node's own DB connection,
+    /// or on the http thread with the read-only one (see NodeDB::OpenReader)
+    struct DbContext {
+        NodeDB& db;
+        NodeProcessor* processor; // node thread only
+        Height currentHeight; // blocks above are not available
+        Height finalHeight; // responses up to this height may be cached. On the node thread the rollbacks are handled synchronously
+        HttpMsgCreator& packer;
+        io::SerializedMsg& sm;
+    };
+
+    DbContext get_node_context() {
+        if (_statusDirty) {
+            const auto &cursor = _nodeBackend.m_Cursor;
+            _cache.currentHeight = cursor.m_Sid.m_Height;
+        }
+        return DbContext{ _nodeBackend.get_DB(), &_nodeBackend, _cache.currentHeight, MaxHeight, _packer, _sm };
+    }
+
+    bool open_reader() {
+        if (_reader.path.empty()) {
+            return false;
+        }
+        if (!_reader.db) {
+            try {
+                auto db = std::make_unique<NodeDB>();
+                db->OpenReader(_reader.path.c_str());
+                _reader.db = std::move(db);
+            } catch (const CorruptionException& e) {
+                LOG_WARNING() << "explorer: cannot open DB reader, " << e.m_sErr;
+                _reader.path.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Runs the request on the http thread, within a single read transaction, i.e. on a consistent snapshot.
+    /// The snapshot may lag behind the node (uncommitted changes, rollbacks), hence only the blocks below
+    /// the fossil height, which can't be rolled back, are cached
+    template <typename Func>
+    bool run_reader(io::SerializedMsg& out, Func&& func) {
+        if (!open_reader()) {
+            return false;
+        }
+
+        size_t outPos = out.size();
+        bool ok = false;
+
+        try {
+            NodeDB& db = *_reader.db;
+            NodeDB::Transaction t(db);
+
+            NodeDB::StateID sid;
+            db.get_Cursor(sid);
+
+            DbContext c{ db, nullptr, sid.m_Height, db.ParamIntGetDef(NodeDB::ParamID::FossilHeight, Rules::HeightGenesis - 1), _reader.packer, _reader.sm };
+            ok = func(c);
+        } catch (const CorruptionException& e) {
+            LOG_WARNING() << "explorer: DB reader failed, " << e.m_sErr;
+        }
+
+        if (!ok) {
+            out.resize(outPos);
+            _reader.sm.clear();
+        }
+        return ok;
+    }
+
+    bool extract_row(DbContext& c, Height height, uint64_t& row, uint64_t* prevRow) {
+        NodeDB& db = c.db;
         NodeDB::WalkerState ws;
         db.EnumStatesAt(ws, height);
         while (true) {
@@ -211,8 +342,8 @@ private:
         return true;
     }
 
-    bool extract_block_from_row(json& out, uint64_t row, Height height) {
-        NodeDB& db = _nodeBackend.get_DB();
+    bool extract_block_from_row(DbContext& c, json& out, uint64_t row, Height height) {
+        NodeDB& db = c.db;
 
         Block::SystemState::Full blockState;
 		Block::SystemState::ID id;
@@ -226,7 +357,11 @@ private:
 			NodeDB::StateID sid;
 			sid.m_Row = row;
 			sid.m_Height = id.m_Height;
-			_nodeBackend.ExtractBlockWithExtra(block, sid);
+			if (c.processor) {
+				c.processor->ExtractBlockWithExtra(block, sid);
+			} else {
+				NodeProcessor::ExtractBlockWithExtra(db, block, sid);
+			}
 
 		} catch (...) {
             ok = false;
@@ -299,47 +434,44 @@ private:
         return ok;
     }
 
-    bool extract_block(json& out, Height height, uint64_t& row, uint64_t* prevRow) {
+    bool extract_block(DbContext& c, json& out, Height height, uint64_t& row, uint64_t* prevRow) {
         bool ok = true;
         if (row == 0) {
-            ok = extract_row(height, row, prevRow);
+            ok = extract_row(c, height, row, prevRow);
         } else if (prevRow != 0) {
             *prevRow = row;
-            if (!_nodeBackend.get_DB().get_Prev(*prevRow)) {
+            if (!c.db.get_Prev(*prevRow)) {
                 *prevRow = 0;
             }
         }
-        return ok && extract_block_from_row(out, row, height);
+        return ok && extract_block_from_row(c, out, row, height);
     }
 
-    bool get_block_impl(io::SerializedMsg& out, uint64_t height, uint64_t& row, uint64_t* prevRow) {
+    bool get_block_impl(DbContext& c, io::SerializedMsg& out, uint64_t height, uint64_t& row, uint64_t* prevRow) {
         if (_cache.get_block(out, height)) {
             if (prevRow && row > 0) {
-                extract_row(height, row, prevRow);
+                extract_row(c, height, row, prevRow);
             }
             return true;
         }
 
-        if (_statusDirty) {
-            const auto &cursor = _nodeBackend.m_Cursor;
-            _cache.currentHeight = cursor.m_Sid.m_Height;
-        }
-
         io::SharedBuffer body;
-        bool blockAvailable = (height <= _cache.currentHeight);
+        bool blockAvailable = (height <= c.currentHeight);
         if (blockAvailable) {
             json j;
-            if (!extract_block(j, height, row, prevRow)) {
+            if (!extract_block(c, j, height, row, prevRow)) {
                 blockAvailable = false;
             } else {
-                _sm.clear();
-                if (serialize_json_msg(_sm, _packer, j)) {
-                    body = io::normalize(_sm, false);
-                    _cache.put_block(height, body);
+                c.sm.clear();
+                if (serialize_json_msg(c.sm, c.packer, j)) {
+                    body = io::normalize(c.sm, false);
+                    if (height <= c.finalHeight) {
+                        _cache.put_block(height, body);
+                    }
                 } else {
                     return false;
                 }
-                _sm.clear();
+                c.sm.clear();
             }
         }
 
@@ -348,42 +480,93 @@ private:
             return true;
         }
 
-        return serialize_json_msg(out, _packer, json{ { "found", false}, {"height", height } });
+        return serialize_json_msg(out, c.packer, json{ { "found", false}, {"height", height } });
+    }
+
+    bool get_block_by_hash_impl(DbContext& c, io::SerializedMsg& out, const ByteBuffer& hash) {
+        Height height = c.db.FindBlock(hash);
+        uint64_t row = 0;
+
+        return get_block_impl(c, out, height, row, 0);
+    }
+
+    bool get_block_by_kernel_impl(DbContext& c, io::SerializedMsg& out, const ByteBuffer& key) {
+        Height height = c.db.FindKernel(key);
+        uint64_t row = 0;
+
+        return get_block_impl(c, out, height, row, 0);
     }
 
     bool get_block(io::SerializedMsg& out, uint64_t height) override {
+        DbContext c = get_node_context();
         uint64_t row=0;
-        return get_block_impl(out, height, row, 0);
+        return get_block_impl(c, out, height, row, 0);
     }
 
     bool get_block_by_hash(io::SerializedMsg& out, const ByteBuffer& hash) override {
-        NodeDB& db = _nodeBackend.get_DB();
+        DbContext c = get_node_context();
+        return get_block_by_hash_impl(c, out, hash);
+    }
 
-        Height height = db.FindBlock(hash);
-        uint64_t row = 0;
+    bool get_block_by_kernel(io::SerializedMsg& out, const ByteBuffer& key) override {
+        DbContext c = get_node_context();
+        return get_block_by_kernel_impl(c, out, key);
+    }
 
-        return get_block_impl(out, height, row, 0);
+    bool get_block_cached(io::SerializedMsg& out, uint64_t height) override {
+        return _cache.get_block(out, height);
     }
 
-    bool get_block_by_kernel(io::SerializedMsg& out, const ByteBuffer& key) override {
-        NodeDB& db = _nodeBackend.get_DB();
+    bool get_blocks_cached(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) override {
+        return _cache.get_blocks(out, startHeight, clamp_blocks_count(n));
+    }
 
-        Height height = db.FindKernel(key);
-        uint64_t row = 0;
+    bool get_block_reader(io::SerializedMsg& out, uint64_t height) override {
+        return run_reader(out, [&](DbContext& c) {
+            uint64_t row = 0;
+            return get_block_impl(c, out, height, row, 0);
+        });
+    }
 
-        return get_block_impl(out, height, row, 0);
+    bool get_block_by_hash_reader(io::SerializedMsg& out, const ByteBuffer& hash) override {
+        return run_reader(out, [&](DbContext& c) {
+            return get_block_by_hash_impl(c, out, hash);
+        });
     }
 
-    bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) override {
+    bool get_block_by_kernel_reader(io::SerializedMsg& out, const ByteBuffer& key) override {
+        return run_reader(out, [&](DbContext& c) {
+            return get_block_by_kernel_impl(c, out, key);
+        });
+    }
+
+    bool get_blocks_reader(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) override {
+        return run_reader(out, [&](DbContext& c) {
+            return get_blocks_impl(c, out, startHeight, n);
+        });
+    }
+
+    static uint64_t clamp_blocks_count(uint64_t n) {
         static const uint64_t maxElements = 1500;
         if (n > maxElements) n = maxElements;
         else if (n==0) n=1;
+        return n;
+    }
+
+    bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) override {
+        DbContext c = get_node_context();
+        return get_blocks_impl(c, out, startHeight, n);
+    }
+
+    bool get_blocks_impl(DbContext& c, io::SerializedMsg& out, uint64_t startHeight, uint64_t n) {
+        n = clamp_blocks_count(n);
         Height endHeight = startHeight + n - 1;
+        size_t outPos = out.size();
         out.push_back(_leftBrace);
         uint64_t row = 0;
         uint64_t prevRow = 0;
         for (;;) {
-            bool ok = get_block_impl(out, endHeight, row, &prevRow);
+            bool ok = get_block_impl(c, out, endHeight, row, &prevRow);
             if (!ok) return false;
             if (endHeight == startHeight) {
                 break;
@@ -393,6 +576,15 @@ private:
             --endHeight;
         }
         out.push_back(_rightBrace);
+
+        if (startHeight + n - 1 <= std::min(c.currentHeight, c.finalHeight)) {
+            // all the blocks are present, the response won't change unless rolled back
+            io::SerializedMsg range(out.begin() + outPos, out.end());
+            io::SharedBuffer body = io::normalize(range, false);
+            _cache.put_blocks(startHeight, n, body);
+            out.resize(outPos);
+            out.push_back(body);
+        }
         return true;
     }
 
@@ -424,6 +616,16 @@ private:
         return true;
     }
 
+    bool get_metrics(io::SerializedMsg& out) override
+    {
+        _node.UpdateMetrics();
+
+        std::string s = metrics::Registry::get().Write();
+        out.push_back({ s.data(), s.size() });
+
+        return true;
+    }
+
     HttpMsgCreator _packer;
 
     // node db interface
@@ -446,6 +648,14 @@ private:
     ResponseCache _cache;
 
     io::SerializedMsg _sm;
+
+    // http thread only
+    struct Reader {
+        std::string path; // empty if not available
+        std::unique_ptr<NodeDB> db;
+        HttpMsgCreator packer{ PACKER_FRAGMENTS_SIZE };
+        io::SerializedMsg sm;
+    } _reader;
 };
 
 IAdapter::Ptr create_adapter(Node& node) {
@@ -38,7 +38,25 @@ struct IAdapter {
 
     virtual bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) = 0;
 
+    /// Serve from the response cache only. Thread-safe, return false if not cached
+    virtual bool get_block_cached(io::SerializedMsg& out, uint64_t height) = 0;
+
+    virtual bool get_blocks_cached(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) = 0;
+
+    /// Same as get_block...() but served on the http thread, from a read-only DB connection (WAL DB profile only).
+    /// Return false if not served, then the request should go to the node thread
+    virtual bool get_block_reader(io::SerializedMsg& out, uint64_t height) = 0;
+
+    virtual bool get_block_by_hash_reader(io::SerializedMsg& out, const ByteBuffer& hash) = 0;
+
+    virtual bool get_block_by_kernel_reader(io::SerializedMsg& out, const ByteBuffer& key) = 0;
+
+    virtual bool get_blocks_reader(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) = 0;
+
     virtual bool get_peers(io::SerializedMsg& out) = 0;
+
+    /// Returns body for /metrics request, text exposition format
+    virtual bool get_metrics(io::SerializedMsg& out) = 0;
 };
 
 IAdapter::Ptr create_adapter(Node& node);
@@ -25,6 +25,7 @@ using namespace std;
 
 struct Options {
     std::string nodeDbFilename;
+    NodeDB::Profile dbProfile;
     std::string accessControlFile;
     std::string nodeConnectTo;
     io::Address nodeListenTo;
@@ -93,6 +94,7 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
         (cli::PASS, po::value<string>()->default_value(""), "password for owner key")
         (cli::IP_WHITELIST, po::value<std::string>()->default_value(""), "IP whitelist")
         (cli::LOG_CLEANUP_DAYS, po::value<uint32_t>()->default_value(5), "old logfiles cleanup period(days)")
+        (cli::DB_PROFILE, po::value<string>()->default_value("wal"), "DB storage profile: default, wal, wal_fast. In WAL mode the blocks are served without the node thread")
     ;
 
     cliOptions.add(createRulesOptionsDescription());
@@ -131,6 +133,8 @@ bool parse_cmdline(int argc, char* argv[], Options& o) {
 
         o.logCleanupPeriod = vm[cli::LOG_CLEANUP_DAYS].as<uint32_t>() * 24 * 3600;
         o.nodeDbFilename = FILES_PREFIX ".db";
+        if (!o.dbProfile.Set(vm[cli::DB_PROFILE].as<string>()))
+            throw std::runtime_error("unknown DB profile: " + vm[cli::DB_PROFILE].as<string>());
         //o.accessControlFile = "api.keys";
 
         o.nodeConnectTo = vm[cli::NODE_PEER].as<string>();
@@ -204,6 +208,7 @@ void setup_node(Node& node, const Options& o) {
     LOG_INFO() << "Rules signature: " << Rules::get().get_SignatureStr();
 
     node.m_Cfg.m_sPathLocal = o.nodeDbFilename;
+    node.m_Cfg.m_ProcessorParams.m_DbProfile = o.dbProfile;
     node.m_Cfg.m_Listen.port(o.nodeListenTo.port());
     node.m_Cfg.m_Listen.ip(o.nodeListenTo.ip());
     node.m_Cfg.m_MiningThreads = 0;
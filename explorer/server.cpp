@@ -29,44 +29,70 @@ static const uint64_t SERVER_RESTART_TIMER = 1;
 static const uint64_t ACL_REFRESH_TIMER = 2;
 static const unsigned SERVER_RESTART_INTERVAL = 1000;
 static const unsigned ACL_REFRESH_INTERVAL = 5555;
+static const size_t MAX_PIPELINED_REQUESTS = 16;
 
 enum Dirs {
-    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS, DIR_PEERS
+    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS, DIR_PEERS, DIR_METRICS
     // etc
 };
 
 } //namespace
 
 Server::Server(IAdapter& adapter, io::Reactor& reactor, io::Address bindAddress, const std::string& keysFileName, const std::vector<uint32_t>& whitelist) :
-    _msgCreator(2000),
     _backend(adapter),
-    _reactor(reactor),
-    _timers(reactor, 100),
+    _reactor(io::Reactor::create()),
     _bindAddress(bindAddress),
+    _msgCreator(2000),
     _acl(keysFileName), //TODO
     _whitelist(whitelist)
 {
-    _timers.set_timer(SERVER_RESTART_TIMER, 0, BIND_THIS_MEMFN(start_server));
-    _timers.set_timer(ACL_REFRESH_TIMER, ACL_REFRESH_INTERVAL, BIND_THIS_MEMFN(refresh_acl));
+    _nodeRx = std::make_unique<RX<Task>>(reactor, [](Task&& task) { task(); });
+    _toNode = std::make_unique<TX<Task>>(_nodeRx->get_tx());
+
+    // the http reactor is not running yet, its objects can be created here
+    _httpRx = std::make_unique<RX<Task>>(*_reactor, [](Task&& task) { task(); });
+    _toHttp = std::make_unique<TX<Task>>(_httpRx->get_tx());
+    _timers = std::make_unique<io::MultipleTimers>(*_reactor, 100);
+
+    _timers->set_timer(SERVER_RESTART_TIMER, 0, BIND_THIS_MEMFN(start_server));
+    _timers->set_timer(ACL_REFRESH_TIMER, ACL_REFRESH_INTERVAL, BIND_THIS_MEMFN(refresh_acl));
+
+    _thread = std::thread([this]() {
+        io::Reactor::Scope scope(*_reactor);
+        _reactor->run();
+
+        _connections.clear();
+        _server.reset();
+        _timers.reset();
+        _httpRx.reset();
+    });
+}
+
+Server::~Server() {
+    _reactor->stop();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    _nodeRx.reset();
 }
 
 void Server::start_server() {
     try {
         _server = io::TcpServer::create(
-            _reactor,
+            *_reactor,
             _bindAddress,
             BIND_THIS_MEMFN(on_stream_accepted)
         );
         LOG_INFO() << STS << "listens to " << _bindAddress;
     } catch (const std::exception& e) {
         LOG_ERROR() << STS << "cannot start server: " << e.what() << " restarting in  " << SERVER_RESTART_INTERVAL << " msec";
-        _timers.set_timer(SERVER_RESTART_TIMER, SERVER_RESTART_INTERVAL, BIND_THIS_MEMFN(start_server));
+        _timers->set_timer(SERVER_RESTART_TIMER, SERVER_RESTART_INTERVAL, BIND_THIS_MEMFN(start_server));
     }
 }
 
 void Server::refresh_acl() {
     _acl.refresh();
-    _timers.set_timer(ACL_REFRESH_TIMER, ACL_REFRESH_INTERVAL, BIND_THIS_MEMFN(refresh_acl));
+    _timers->set_timer(ACL_REFRESH_TIMER, ACL_REFRESH_INTERVAL, BIND_THIS_MEMFN(refresh_acl));
 }
 
 void Server::on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode) {
@@ -85,7 +111,7 @@ void Server::on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode er
 
         newStream->enable_keepalive(1);
         LOG_DEBUG() << STS << "+peer " << peer;
-        _connections[peer.u64()] = std::make_unique<HttpConnection>(
+        _connections[peer.u64()].conn = std::make_unique<HttpConnection>(
             peer.u64(),
             BaseConnection::inbound,
             BIND_THIS_MEMFN(on_request),
@@ -95,7 +121,22 @@ void Server::on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode er
         );
     } else {
         LOG_ERROR() << STS << io::error_str(errorCode) << ", restarting server in  " << SERVER_RESTART_INTERVAL << " msec";
-        _timers.set_timer(SERVER_RESTART_TIMER, SERVER_RESTART_INTERVAL, BIND_THIS_MEMFN(start_server));
+        _timers->set_timer(SERVER_RESTART_TIMER, SERVER_RESTART_INTERVAL, BIND_THIS_MEMFN(start_server));
+    }
+}
+
+const std::map<std::string_view, int>& Server::get_dirs() {
+    static const std::map<std::string_view, int> dirs {
+        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }, { "peers", DIR_PEERS}, { "metrics", DIR_METRICS }
+    };
+    return dirs;
+}
+
+void Server::set_status(Response& r, int code, const char* message) {
+    r.code = code;
+    r.message = message;
+    if (code != 200) {
+        r.body.clear();
     }
 }
 
@@ -109,142 +150,224 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
         return false;
     }
 
+    Connection& c = it->second;
+    if (c.pending.size() >= MAX_PIPELINED_REQUESTS) {
+        LOG_DEBUG() << STS << "-peer " << io::Address::from_u64(id) << " : too many pipelined requests";
+        _connections.erase(id);
+        return false;
+    }
+
+    uint64_t seq = c.firstSeq + c.pending.size();
+    c.pending.emplace_back();
+    Response& r = c.pending.back();
+    r.keepalive = (msg.msg->get_header("Connection") != "close");
+
     const std::string& path = msg.msg->get_path();
+    HttpUrl url;
+
+    if (!url.parse(path, get_dirs())) {
+        set_status(r, 404, "Not Found");
+        r.ready = true;
+    } else if (!_acl.check(c.conn->peer_address())) {
+        set_status(r, 403, "Forbidden");
+        r.ready = true;
+    } else if (try_serve_here(url, r)) {
+        set_status(r, 200, "OK");
+        r.ready = true;
+    } else {
+        _toNode->send([this, id, seq, path, keepalive = r.keepalive]() {
+            // node thread
+            HttpUrl url;
+            Response r;
+            if (url.parse(path, get_dirs())) {
+                process_request(url, r);
+            } else {
+                set_status(r, 404, "Not Found");
+            }
+            r.ready = true;
+            r.keepalive = keepalive;
 
-    static const std::map<std::string_view, int> dirs {
-        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }, { "peers", DIR_PEERS}
-    };
+            _toHttp->send([this, id, seq, r{ std::move(r) }]() mutable {
+                on_response(id, seq, std::move(r));
+            });
+        });
+    }
 
-    const HttpConnection::Ptr& conn = it->second;
-
-    bool (Server::*func)(const HttpConnection::Ptr&) = 0;
-
-    if (_currentUrl.parse(path, dirs)) {
-        switch (_currentUrl.dir) {
-            case DIR_STATUS:
-                func = &Server::send_status;
-                break;
-            case DIR_BLOCK:
-                func = &Server::send_block;
-                break;
-            case DIR_BLOCKS:
-                func = &Server::send_blocks;
-                break;
-            case DIR_PEERS:
-                func = &Server::send_peers;
-                break;
-            default:
-                break;
-        }
+    return flush_responses(c);
+}
+
+bool Server::try_serve_here(const HttpUrl& url, Response& r) {
+    switch (url.dir) {
+        case DIR_BLOCK:
+            if (url.has_arg("hash")) {
+                ByteBuffer hash;
+                return url.get_hex_arg("hash", hash) && _backend.get_block_by_hash_reader(r.body, hash);
+            }
+            if (url.has_arg("kernel")) {
+                ByteBuffer kernel;
+                return url.get_hex_arg("kernel", kernel) && _backend.get_block_by_kernel_reader(r.body, kernel);
+            }
+            {
+                auto height = url.get_int_arg("height", 0);
+                return _backend.get_block_cached(r.body, height) || _backend.get_block_reader(r.body, height);
+            }
+        case DIR_BLOCKS:
+            {
+                auto start = url.get_int_arg("height", 0);
+                auto n = url.get_int_arg("n", 0);
+                if (start <= 0 || n < 0) {
+                    return false;
+                }
+                return _backend.get_blocks_cached(r.body, start, n) || _backend.get_blocks_reader(r.body, start, n);
+            }
+        default:
+            return false;
     }
+}
 
-    bool keepalive = false;
+void Server::on_response(uint64_t id, uint64_t seq, Response&& r) {
+    auto it = _connections.find(id);
+    if (it == _connections.end()) return;
+
+    Connection& c = it->second;
+    assert(seq >= c.firstSeq && seq < c.firstSeq + c.pending.size());
+    c.pending[seq - c.firstSeq] = std::move(r);
+
+    flush_responses(c);
+}
+
+bool Server::flush_responses(Connection& c) {
+    assert(c.conn);
+    uint64_t id = c.conn->id();
+
+    while (!c.pending.empty() && c.pending.front().ready) {
+        Response& r = c.pending.front();
+
+        size_t bodySize = 0;
+        for (const auto& f : r.body) { bodySize += f.size; }
+
+        bool ok = _msgCreator.create_response(
+            _headers,
+            r.code,
+            r.message,
+            0, //headers,
+            0, //sizeof(headers) / sizeof(HeaderPair),
+            1,
+            r.contentType,
+            bodySize
+        );
 
-    if (func) {
-        //bool validKey = _acl.check(_currentUrl.args["m"], _currentUrl.args["n"], _currentUrl.args["h"]);
-        bool validKey = _acl.check(conn->peer_address());
-        if (!validKey) {
-            send(conn, 403, "Forbidden");
+        if (ok) {
+            auto result = c.conn->write_msg(_headers);
+            if (result && bodySize > 0) {
+                result = c.conn->write_msg(r.body);
+            }
+            if (!result) ok = false;
         } else {
-            keepalive = (this->*func)(conn);
+            LOG_ERROR() << STS << "cannot create response";
+        }
+
+        _headers.clear();
+
+        bool keepalive = ok && (r.code == 200) && r.keepalive;
+
+        c.pending.pop_front();
+        c.firstSeq++;
+
+        if (!keepalive) {
+            c.conn->shutdown();
+            _connections.erase(id);
+            return false;
         }
-    } else {
-        send(conn, 404, "Not Found");
     }
 
-    if (!keepalive) {
-        conn->shutdown();
-        _connections.erase(it);
+    return true;
+}
+
+void Server::process_request(const HttpUrl& url, Response& r) {
+    switch (url.dir) {
+        case DIR_STATUS:
+            send_status(url, r);
+            break;
+        case DIR_BLOCK:
+            send_block(url, r);
+            break;
+        case DIR_BLOCKS:
+            send_blocks(url, r);
+            break;
+        case DIR_PEERS:
+            send_peers(url, r);
+            break;
+        case DIR_METRICS:
+            send_metrics(url, r);
+            break;
+        default:
+            set_status(r, 404, "Not Found");
+            break;
     }
-    return keepalive;
 }
 
-bool Server::send_status(const HttpConnection::Ptr& conn) {
-    _body.clear();
-    if (!_backend.get_status(_body)) {
-        return send(conn, 500, "Internal error #1");
+void Server::send_status(const HttpUrl&, Response& r) {
+    if (!_backend.get_status(r.body)) {
+        return set_status(r, 500, "Internal error #1");
     }
-    return send(conn, 200, "OK");
+    set_status(r, 200, "OK");
 }
 
-bool Server::send_block(const HttpConnection::Ptr &conn) {
+void Server::send_block(const HttpUrl& url, Response& r) {
 
-    if (_currentUrl.has_arg("hash"))
+    if (url.has_arg("hash"))
     {
         ByteBuffer hash;
 
-        if (!_currentUrl.get_hex_arg("hash", hash) || !_backend.get_block_by_hash(_body, hash)) {
-            return send(conn, 500, "Internal error #2");
+        if (!url.get_hex_arg("hash", hash) || !_backend.get_block_by_hash(r.body, hash)) {
+            return set_status(r, 500, "Internal error #2");
         }
     }
-    else if (_currentUrl.has_arg("kernel"))
+    else if (url.has_arg("kernel"))
     {
         ByteBuffer kernel;
 
-        if (!_currentUrl.get_hex_arg("kernel", kernel) || !_backend.get_block_by_kernel(_body, kernel)) {
-            return send(conn, 500, "Internal error #2");
+        if (!url.get_hex_arg("kernel", kernel) || !_backend.get_block_by_kernel(r.body, kernel)) {
+            return set_status(r, 500, "Internal error #2");
         }
     }
     else 
     {
-        auto height = _currentUrl.get_int_arg("height", 0);
-        if (!_backend.get_block(_body, height)) {
-            return send(conn, 500, "Internal error #2");
+        auto height = url.get_int_arg("height", 0);
+        if (!_backend.get_block(r.body, height)) {
+            return set_status(r, 500, "Internal error #2");
         }
     }
 
-    return send(conn, 200, "OK");
+    set_status(r, 200, "OK");
 }
 
-bool Server::send_blocks(const HttpConnection::Ptr& conn) {
-    auto start = _currentUrl.get_int_arg("height", 0);
-    auto n = _currentUrl.get_int_arg("n", 0);
+void Server::send_blocks(const HttpUrl& url, Response& r) {
+    auto start = url.get_int_arg("height", 0);
+    auto n = url.get_int_arg("n", 0);
     if (start <= 0 || n < 0) {
-        return send(conn, 400, "Bad request");
+        return set_status(r, 400, "Bad request");
     }
-    if (!_backend.get_blocks(_body, start, n)) {
-        return send(conn, 500, "Internal error #3");
+    if (!_backend.get_blocks(r.body, start, n)) {
+        return set_status(r, 500, "Internal error #3");
     }
-    return send(conn, 200, "OK");
+    set_status(r, 200, "OK");
 }
 
-bool Server::send_peers(const HttpConnection::Ptr& conn) {
-    if (!_backend.get_peers(_body)) {
-        return send(conn, 500, "Internal error #3");
+void Server::send_peers(const HttpUrl&, Response& r) {
+    if (!_backend.get_peers(r.body)) {
+        return set_status(r, 500, "Internal error #3");
     }
-    return send(conn, 200, "OK");
+    set_status(r, 200, "OK");
 }
 
-bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message) {
-    assert(conn);
-
-    size_t bodySize = 0;
-    for (const auto& f : _body) { bodySize += f.size; }
-
-    bool ok = _msgCreator.create_response(
-        _headers,
-        code,
-        message,
-        0, //headers,
-        0, //sizeof(headers) / sizeof(HeaderPair),
-        1,
-        "application/json",
-        bodySize
-    );
-
-    if (ok) {
-        auto result = conn->write_msg(_headers);
-        if (result && bodySize > 0) {
-            result = conn->write_msg(_body);
-        }
-        if (!result) ok = false;
-    } else {
-        LOG_ERROR() << STS << "cannot create response";
+void Server::send_metrics(const HttpUrl&, Response& r) {
+    if (!_backend.get_metrics(r.body)) {
+        return set_status(r, 500, "Internal error #4");
     }
-
-    _headers.clear();
-    _body.clear();
-    return (ok && code == 200);
+    r.contentType = "text/plain; version=0.0.4";
+    set_status(r, 200, "OK");
 }
 
 Server::IPAccessControl::IPAccessControl(const std::string &ipsFileName) :
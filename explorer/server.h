@@ -16,17 +16,23 @@
 #include "http/http_msg_creator.h"
 #include "utility/io/tcpserver.h"
 #include "utility/io/coarsetimer.h"
+#include "utility/message_queue.h"
 #include "utility/helpers.h"
 #include <string_view>
 #include <set>
+#include <deque>
+#include <thread>
 
 namespace beam { namespace explorer {
 
 struct IAdapter;
 
+/// HTTP i/o runs in its own thread. Requests that can't be served from the adapter's
+/// response cache or its read-only DB connection are forwarded to the node (reactor) thread, responses are sent back in order
 class Server {
 public:
     Server(IAdapter& adapter, io::Reactor& reactor, io::Address bindAddress, const std::string& keysFileName, const std::vector<uint32_t>& whitelist);
+    ~Server();
 
 private:
     class IPAccessControl {
@@ -43,31 +49,63 @@ private:
         std::set<uint32_t> _ips;
     };
 
+    using Task = std::function<void()>;
+
+    struct Response {
+        bool ready = false;
+        int code = 0;
+        const char* message = nullptr;
+        bool keepalive = true;
+        const char* contentType = "application/json";
+        io::SerializedMsg body;
+    };
+
+    /// Pipelined requests are answered in the order of arrival
+    struct Connection {
+        HttpConnection::Ptr conn;
+        uint64_t firstSeq = 0; // seq of pending.front()
+        std::deque<Response> pending;
+    };
+
     void start_server();
     void refresh_acl();
 
     void on_stream_accepted(io::TcpStream::Ptr&& newStream, io::ErrorCode errorCode);
 
+    // http thread
     bool on_request(uint64_t id, const HttpMsgReader::Message& msg);
-    bool send_status(const HttpConnection::Ptr& conn);
-    bool send_block(const HttpConnection::Ptr& conn);
-    bool send_blocks(const HttpConnection::Ptr& conn);
-    bool send_peers(const HttpConnection::Ptr& conn);
-    bool send(const HttpConnection::Ptr& conn, int code, const char* message);
+    bool try_serve_here(const HttpUrl& url, Response& r);
+    void on_response(uint64_t id, uint64_t seq, Response&& r);
+    bool flush_responses(Connection& c);
+
+    // node thread
+    void process_request(const HttpUrl& url, Response& r);
+    void send_status(const HttpUrl& url, Response& r);
+    void send_block(const HttpUrl& url, Response& r);
+    void send_blocks(const HttpUrl& url, Response& r);
+    void send_peers(const HttpUrl& url, Response& r);
+    void send_metrics(const HttpUrl& url, Response& r);
+
+    static const std::map<std::string_view, int>& get_dirs();
+    static void set_status(Response& r, int code, const char* message);
 
-    HttpMsgCreator _msgCreator;
     IAdapter& _backend;
-    io::Reactor& _reactor;
-    io::MultipleTimers _timers;
+    std::unique_ptr<RX<Task>> _nodeRx;
+    std::unique_ptr<TX<Task>> _toNode;
+
+    io::Reactor::Ptr _reactor;
+    std::unique_ptr<io::MultipleTimers> _timers;
+    std::unique_ptr<RX<Task>> _httpRx;
+    std::unique_ptr<TX<Task>> _toHttp;
     io::Address _bindAddress;
     io::TcpServer::Ptr _server;
-    std::map<uint64_t, HttpConnection::Ptr> _connections;
-    HttpUrl _currentUrl;
+    std::map<uint64_t, Connection> _connections;
+    HttpMsgCreator _msgCreator;
     io::SerializedMsg _headers;
-    io::SerializedMsg _body;
     //AccessControl _acl;
     IPAccessControl _acl;
     std::vector<uint32_t> _whitelist;
+    std::thread _thread;
 };
 
 }} //namespaces
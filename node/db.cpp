@@ -13,9 +13,16 @@
 // limitations under the License.
 
 #include "db.h"
+#include "node_metrics.h"
 #include "../core/peer_manager.h"
 #include "../utility/logger.h"
 
+#ifndef WIN32
+#	include <fcntl.h>
+#	include <sys/file.h>
+#	include <unistd.h>
+#endif // WIN32
+
 namespace beam {
 
 
@@ -83,6 +90,12 @@ namespace beam {
 #define TblTxo_ID				"ID"
 #define TblTxo_Value			"Value"
 #define TblTxo_SpendHeight		"SpendHeight"
+#define TblTxo_Pos				"Pos"
+#define TblTxo_Size				"Size"
+
+#define TblTxoSegs				"TxoLogSegments"
+#define TblTxoSegs_ID			"ID"
+#define TblTxoSegs_Live			"Live"
 
 #define TblStreams				"Streams"
 #define TblStream_ID			"ID"
@@ -101,6 +114,12 @@ namespace beam {
 
 NodeDB::NodeDB()
 	:m_pDb(NULL)
+#ifdef WIN32
+	,m_hLock(INVALID_HANDLE_VALUE)
+#else // WIN32
+	,m_hLock(-1)
+#endif // WIN32
+	,m_StreamsStampReset(false)
 {
 	ZeroObject(m_pPrep);
 }
@@ -147,6 +166,8 @@ void NodeDB::Statement::Close()
 
 void NodeDB::Close()
 {
+	m_StreamsMapped.Close(); // if it's dirty - will be rebuilt on the next open
+
 	if (m_pDb)
 	{
 		for (size_t i = 0; i < _countof(m_pPrep); i++)
@@ -155,11 +176,52 @@ void NodeDB::Close()
         BEAM_VERIFY(SQLITE_OK == sqlite3_close(m_pDb));
 		m_pDb = NULL;
 	}
+
+	UnlockWriter();
+}
+
+void NodeDB::LockWriter(const char* szPath)
+{
+	std::string sPath = std::string(szPath) + "-lock";
+
+#ifdef WIN32
+	m_hLock = CreateFileW(Utf8toUtf16(sPath).c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	if (INVALID_HANDLE_VALUE == m_hLock)
+		ThrowError("DB is locked by another process");
+#else // WIN32
+	m_hLock = open(sPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	if (-1 == m_hLock)
+		ThrowError("DB lock file can't be opened");
+
+	if (flock(m_hLock, LOCK_EX | LOCK_NB))
+	{
+		UnlockWriter();
+		ThrowError("DB is locked by another process");
+	}
+#endif // WIN32
+}
+
+void NodeDB::UnlockWriter()
+{
+#ifdef WIN32
+	if (INVALID_HANDLE_VALUE != m_hLock)
+	{
+		CloseHandle(m_hLock);
+		m_hLock = INVALID_HANDLE_VALUE;
+	}
+#else // WIN32
+	if (-1 != m_hLock)
+	{
+		close(m_hLock); // releases the lock
+		m_hLock = -1;
+	}
+#endif // WIN32
 }
 
 NodeDB::Recordset::Recordset()
 	:m_pStmt(nullptr)
 	,m_pDB(nullptr)
+	,m_Query(Query::count)
 {
 }
 
@@ -172,6 +234,7 @@ NodeDB::Recordset::Recordset(NodeDB& db, Query::Enum val, const char* sql)
 void NodeDB::Recordset::InitInternal(NodeDB& db, Query::Enum val, const char* sql)
 {
 	m_pDB = &db;
+	m_Query = val;
 	m_pStmt = db.get_Statement(val, sql);
 }
 
@@ -197,7 +260,7 @@ void NodeDB::Recordset::Reset(NodeDB& db, Query::Enum val, const char* sql)
 
 bool NodeDB::Recordset::Step()
 {
-	return m_pDB->ExecStep(m_pStmt);
+	return m_pDB->ExecStep(m_pStmt, m_Query);
 }
 
 void NodeDB::Recordset::StepStrict()
@@ -208,7 +271,7 @@ void NodeDB::Recordset::StepStrict()
 
 bool NodeDB::Recordset::StepModifySafe()
 {
-	int nVal = m_pDB->ExecStepRaw(m_pStmt);
+	int nVal = m_pDB->ExecStepRaw(m_pStmt, m_Query);
 	switch (nVal)
 	{
 
@@ -318,13 +381,57 @@ const void* NodeDB::Recordset::get_BlobStrict(int col, uint32_t n)
 	return x.p;
 }
 
+void NodeDB::Profile::SetDefault()
+{
+	*this = Profile();
+}
+
+void NodeDB::Profile::SetWal()
+{
+	SetDefault();
+	m_Wal = true;
+	m_PageSize = 0x2000;
+	m_CacheSize = -0x10000; // 64MB
+	m_MmapSize = uint64_t(1) << 30;
+	m_Synchronous = 1; // in WAL mode it's still consistent, only the last commits may be lost on power failure
+}
+
+void NodeDB::Profile::SetWalFast()
+{
+	SetWal();
+	m_Synchronous = 0;
+}
+
+bool NodeDB::Profile::Set(const std::string& s)
+{
+	if (s == "default")
+		SetDefault();
+	else if (s == "wal")
+		SetWal();
+	else if (s == "wal_fast")
+		SetWalFast();
+	else
+		return false;
+
+	return true;
+}
+
 void NodeDB::Open(const char* szPath)
 {
+	Open(szPath, Profile());
+}
+
+void NodeDB::Open(const char* szPath, const Profile& prof)
+{
+	if (prof.m_Wal)
+		LockWriter(szPath);
+
 	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_CREATE, NULL));
 	// Attempt to fix the "busy" error when PC goes to sleep and then awakes. Try the busy handler with non-zero timeout (maybe a single retry would be enough)
 	sqlite3_busy_timeout(m_pDb, 5000);
 
-	ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+	// In WAL mode the exclusive locking would prevent other connections from reading. The writer is guarded by LockWriter then
+	ExecTextOut(prof.m_Wal ? "PRAGMA locking_mode = NORMAL" : "PRAGMA locking_mode = EXCLUSIVE");
 	ExecTextOut("PRAGMA journal_size_limit=1048576"); // limit journal file, otherwise it may remain huge even after tx commit, until the app is closed
 
 	bool bCreate;
@@ -334,7 +441,24 @@ void NodeDB::Open(const char* szPath)
 		bCreate = !rs.Step();
 	}
 
-	const uint64_t nVersionTop = 21;
+	if (bCreate)
+		ExecQuick("PRAGMA auto_vacuum = INCREMENTAL"); // must be set before the DB header is written, i.e. before switching to WAL or creating tables
+
+	if (prof.m_PageSize)
+		ExecQuick(("PRAGMA page_size = " + std::to_string(prof.m_PageSize)).c_str()); // before switching to WAL
+
+	ExecTextOut(prof.m_Wal ? "PRAGMA journal_mode = WAL" : "PRAGMA journal_mode = DELETE"); // persistent, so reset explicitly
+
+	if (prof.m_Wal)
+		ExecTextOut(("PRAGMA wal_autocheckpoint = " + std::to_string(prof.m_AutoCheckpoint)).c_str());
+	if (prof.m_CacheSize)
+		ExecQuick(("PRAGMA cache_size = " + std::to_string(prof.m_CacheSize)).c_str());
+	if (prof.m_MmapSize)
+		ExecTextOut(("PRAGMA mmap_size = " + std::to_string(prof.m_MmapSize)).c_str());
+	if (prof.m_Synchronous >= 0)
+		ExecQuick(("PRAGMA synchronous = " + std::to_string(prof.m_Synchronous)).c_str());
+
+	const uint64_t nVersionTop = 22;
 
 	Transaction t(*this);
 
@@ -366,6 +490,11 @@ void NodeDB::Open(const char* szPath)
 
 			LOG_INFO() << "DB migrate from" << 20;
 			MigrateFrom20();
+			// no break;
+
+		case 21: // Txo values stored in the table
+			LOG_INFO() << "DB migrate from" << 21;
+			MigrateFrom21();
 
 			ParamIntSet(ParamID::DbVer, nVersionTop);
 			// no break;
@@ -385,6 +514,20 @@ void NodeDB::Open(const char* szPath)
 	t.Commit();
 }
 
+void NodeDB::OpenReader(const char* szPath)
+{
+	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL));
+	sqlite3_busy_timeout(m_pDb, 5000);
+}
+
+bool NodeDB::Checkpoint()
+{
+	int nLog = 0, nCkpt = 0;
+	TestRet(sqlite3_wal_checkpoint_v2(m_pDb, nullptr, SQLITE_CHECKPOINT_PASSIVE, &nLog, &nCkpt));
+
+	return (nLog == nCkpt); // both are -1 if not in WAL mode
+}
+
 void NodeDB::CheckIntegrity()
 {
 	std::string s = ExecTextOut("PRAGMA integrity_check");
@@ -481,12 +624,24 @@ void NodeDB::Create()
 
 	ExecQuick("CREATE INDEX [Idx" TblDummy "H] ON [" TblDummy "] ([" TblDummy_SpendHeight "])");
 
+	CreateTableTxo();
+	CreateTables20();
+}
+
+void NodeDB::CreateTableTxo()
+{
 	ExecQuick("CREATE TABLE [" TblTxo "] ("
 		"[" TblTxo_ID				"] INTEGER NOT NULL PRIMARY KEY,"
-		"[" TblTxo_Value			"] BLOB NOT NULL,"
-		"[" TblTxo_SpendHeight		"] INTEGER)");
+		"[" TblTxo_Value			"] BLOB,"
+		"[" TblTxo_SpendHeight		"] INTEGER,"
+		"[" TblTxo_Pos				"] INTEGER,"
+		"[" TblTxo_Size				"] INTEGER)");
 
-	CreateTables20();
+	ExecQuick("CREATE INDEX [Idx" TblTxo "Pos] ON [" TblTxo "] ([" TblTxo_Pos "]);");
+
+	ExecQuick("CREATE TABLE [" TblTxoSegs "] ("
+		"[" TblTxoSegs_ID			"] INTEGER NOT NULL PRIMARY KEY,"
+		"[" TblTxoSegs_Live			"] INTEGER NOT NULL)");
 }
 
 void NodeDB::CreateTables20()
@@ -511,9 +666,36 @@ void NodeDB::CreateTables20()
 
 void NodeDB::Vacuum()
 {
+	// takes effect for the existing DBs only after the full vacuum
+	ExecQuick("PRAGMA auto_vacuum = INCREMENTAL");
 	ExecQuick("VACUUM");
 }
 
+bool NodeDB::IsVacuumIncremental()
+{
+	return std::stoul(ExecTextOut("PRAGMA auto_vacuum")) == 2;
+}
+
+bool NodeDB::VacuumIncremental(uint32_t nPagesMax, uint32_t& nPagesDone)
+{
+	nPagesDone = 0;
+
+	if (!IsVacuumIncremental())
+		return false;
+
+	uint32_t nFree0 = std::stoul(ExecTextOut("PRAGMA freelist_count"));
+	if (!nFree0)
+		return false;
+
+	std::string sSql = "PRAGMA incremental_vacuum(" + std::to_string(nPagesMax) + ")";
+	ExecQuick(sSql.c_str());
+
+	uint32_t nFree1 = std::stoul(ExecTextOut("PRAGMA freelist_count"));
+	nPagesDone = (nFree0 > nFree1) ? (nFree0 - nFree1) : 0;
+
+	return nFree1 && nPagesDone;
+}
+
 void NodeDB::ExecQuick(const char* szSql)
 {
 	int n = sqlite3_total_changes(m_pDb);
@@ -542,11 +724,13 @@ std::string NodeDB::ExecTextOut(const char* szSql)
 	return sRes;
 }
 
-int NodeDB::ExecStepRaw(sqlite3_stmt* pStmt)
+int NodeDB::ExecStepRaw(sqlite3_stmt* pStmt, uint32_t iQuery /* = Query::count */)
 {
 	int n = sqlite3_total_changes(m_pDb);
 
+	metrics::Stopwatch sw;
 	int nVal = sqlite3_step(pStmt);
+	NodeMetrics::get().OnDbStep(iQuery, sw.get_us());
 
 	if (sqlite3_total_changes(m_pDb) != n)
 		OnModified();
@@ -554,9 +738,9 @@ int NodeDB::ExecStepRaw(sqlite3_stmt* pStmt)
 	return nVal;
 }
 
-bool NodeDB::ExecStep(sqlite3_stmt* pStmt)
+bool NodeDB::ExecStep(sqlite3_stmt* pStmt, uint32_t iQuery /* = Query::count */)
 {
-	int nVal = ExecStepRaw(pStmt);
+	int nVal = ExecStepRaw(pStmt, iQuery);
 	switch (nVal)
 	{
 
@@ -582,7 +766,7 @@ bool NodeDB::ExecStep(sqlite3_stmt* pStmt)
 
 bool NodeDB::ExecStep(Query::Enum val, const char* sql)
 {
-	return ExecStep(get_Statement(val, sql));
+	return ExecStep(get_Statement(val, sql), val);
 
 }
 
@@ -653,6 +837,19 @@ void NodeDB::ParamIntSet(uint32_t ID, uint64_t val)
 	ParamSet(ID, &val, nullptr);
 }
 
+void NodeDB::ParamStampUpdate(uint32_t ID, Merkle::Hash& hv)
+{
+	Blob blob(hv);
+
+	if (ParamGet(ID, nullptr, &blob)) {
+		ECC::Hash::Processor() << hv >> hv;
+	} else {
+		ECC::GenRandom(hv);
+	}
+
+	ParamSet(ID, nullptr, &blob);
+}
+
 bool NodeDB::ParamGet(uint32_t ID, uint64_t* p0, Blob* p1, ByteBuffer* p2 /* = NULL */)
 {
 	Recordset rs(*this, Query::ParamGet, "SELECT " TblParams_Int "," TblParams_Blob " FROM " TblParams " WHERE " TblParams_ID "=?");
@@ -714,16 +911,33 @@ void NodeDB::Transaction::Start(NodeDB& db)
 void NodeDB::Transaction::Commit()
 {
 	assert(m_pDB);
-	m_pDB->ExecStep(Query::Commit, "COMMIT");
+	NodeDB& db = *m_pDB;
+
+	StreamsMapped::Stamp us;
+	bool bFlushStreams = db.m_StreamsMapped.IsDirty();
+	if (bFlushStreams)
+		db.ParamStampUpdate(ParamID::StreamsStamp, us);
+
+	db.ExecStep(Query::Commit, "COMMIT");
 	m_pDB = NULL;
+	db.m_StreamsStampReset = false;
+
+	if (bFlushStreams)
+		db.m_StreamsMapped.FlushStrict(us);
 }
 
 void NodeDB::Transaction::Rollback()
 {
 	if (m_pDB)
 	{
-		m_pDB->ExecStep(Query::Rollback, "ROLLBACK");
+		NodeDB& db = *m_pDB;
+
+		db.ExecStep(Query::Rollback, "ROLLBACK");
 		m_pDB = nullptr;
+		db.m_StreamsStampReset = false;
+
+		if (db.m_StreamsMapped.IsDirty())
+			db.StreamsImageClose(); // its changes can't be reverted
 	}
 }
 
@@ -2097,27 +2311,165 @@ Height NodeDB::FindBlock(const Blob& hash)
     return h;
 }
 
+namespace
+{
+	// "prefix item,item,...,item suffix"
+	std::string MakeBatchSql(const char* szPrefix, const char* szItem, uint32_t nItems, const char* szSuffix)
+	{
+		std::string s = szPrefix;
+		for (uint32_t i = 0; i < nItems; i++)
+		{
+			if (i)
+				s += ',';
+			s += szItem;
+		}
+		s += szSuffix;
+		return s;
+	}
+}
+
+#define TblTxo_AddPrefix "INSERT INTO " TblTxo "(" TblTxo_ID "," TblTxo_Value "," TblTxo_Pos "," TblTxo_Size ") VALUES"
+
 void NodeDB::TxoAdd(TxoID id, const Blob& b)
 {
-	Recordset rs(*this, Query::TxoAdd, "INSERT INTO " TblTxo "(" TblTxo_ID "," TblTxo_Value ") VALUES(?,?)");
-	rs.put(0, id);
-	rs.put(1, b);
-	rs.Step();
+	TxoAdd(id, &b, 1);
+}
+
+void NodeDB::TxoAdd(TxoID id0, const Blob* pVals, uint32_t nCount)
+{
+	// append all the large values to the log at once
+	uint64_t pos0 = ParamIntGetDef(ParamID::TxoLogSize);
+	uint64_t pos = pos0;
+
+	for (uint32_t i = 0; i < nCount; i++)
+		if (pVals[i].n > s_TxoInlineMax)
+			pos += pVals[i].n;
+
+	if (pos > pos0)
+	{
+		TxoLogGrow(pos, pos0);
+		pos = pos0;
+	}
+
+	static_assert(Query::TxoAdd + s_TxoBatchLog == Query::TxoAdd32);
+
+	struct SqlBatch
+	{
+		std::string m_p[s_TxoBatchLog + 1];
+
+		SqlBatch()
+		{
+			for (uint32_t k = 0; k <= s_TxoBatchLog; k++)
+				m_p[k] = MakeBatchSql(TblTxo_AddPrefix, "(?,?,?,?)", 1U << k, "");
+		}
+	};
+
+	static const SqlBatch s_Sql;
+
+	Recordset rs;
+	TxoLogDelta d;
+
+	for (uint32_t i = 0; i < nCount; )
+	{
+		// the largest statement that fits, at most s_TxoBatchLog+1 statements for the remainder
+		uint32_t k = s_TxoBatchLog;
+		while ((1U << k) > nCount - i)
+			k--;
+
+		uint32_t nRows = 1U << k;
+		rs.Reset(*this, static_cast<Query::Enum>(Query::TxoAdd + k), s_Sql.m_p[k].c_str());
+
+		for (uint32_t iRow = 0; iRow < nRows; iRow++, i++)
+		{
+			const Blob& b = pVals[i];
+			int iCol = iRow * 4;
+
+			rs.put(iCol, id0 + i);
+
+			if (b.n <= s_TxoInlineMax)
+				rs.put(iCol + 1, b);
+			else
+			{
+				StreamIO(StreamType::TxoLog, pos, reinterpret_cast<uint8_t*>(Cast::NotConst(b.p)), b.n, true);
+				rs.put(iCol + 2, pos);
+				rs.put(iCol + 3, b.n);
+				TxoLogRef(d, pos, b.n, true);
+				pos += b.n;
+			}
+		}
+
+		rs.Step();
+	}
+
+	TxoLogApply(d);
 }
 
 void NodeDB::TxoDel(TxoID id)
 {
+	TxoLogDelta d;
+	uint64_t pos;
+	uint32_t n;
+	if (TxoLogGetPos(id, pos, n))
+		TxoLogRef(d, pos, n, false);
+
 	Recordset rs(*this, Query::TxoDel, "DELETE FROM " TblTxo " WHERE " TblTxo_ID "=?");
 	rs.put(0, id);
 	rs.Step();
 	TestChanged1Row();
+
+	TxoLogApply(d);
 }
 
 void NodeDB::TxoDelFrom(TxoID id)
 {
-	Recordset rs(*this, Query::TxoDelFrom, "DELETE FROM " TblTxo " WHERE " TblTxo_ID ">=?");
+	TxoLogDelta d;
+
+	Recordset rs(*this, Query::TxoLogEnumFrom, "SELECT " TblTxo_Pos "," TblTxo_Size " FROM " TblTxo " WHERE " TblTxo_ID ">=? AND " TblTxo_Pos " IS NOT NULL");
+	rs.put(0, id);
+	while (rs.Step())
+	{
+		uint64_t pos;
+		uint32_t n;
+		rs.get(0, pos);
+		rs.get(1, n);
+		TxoLogRef(d, pos, n, false);
+	}
+
+	rs.Reset(*this, Query::TxoDelFrom, "DELETE FROM " TblTxo " WHERE " TblTxo_ID ">=?");
 	rs.put(0, id);
 	rs.Step();
+
+	TxoLogApply(d);
+
+	// cut the log after the last referenced value
+	uint64_t nSize = ParamIntGetDef(ParamID::TxoLogSize);
+	uint64_t nSize1 = 0;
+
+	rs.Reset(*this, Query::TxoLogMax, "SELECT " TblTxo_Pos "," TblTxo_Size " FROM " TblTxo " WHERE " TblTxo_Pos " IS NOT NULL ORDER BY " TblTxo_Pos " DESC LIMIT 1");
+	if (rs.Step())
+	{
+		uint64_t pos;
+		uint32_t n;
+		rs.get(0, pos);
+		rs.get(1, n);
+		nSize1 = pos + n;
+	}
+
+	if (nSize1 < nSize)
+	{
+		// the segments above may already be erased
+		std::vector<uint64_t> v;
+
+		rs.Reset(*this, Query::TxoSegEnumFrom, "SELECT " TblTxoSegs_ID " FROM " TblTxoSegs " WHERE " TblTxoSegs_ID ">=?");
+		rs.put(0, (nSize1 + s_StreamBlob - 1) / s_StreamBlob);
+		while (rs.Step())
+			rs.get(0, v.emplace_back());
+
+		for (size_t i = 0; i < v.size(); i++)
+			TxoLogEraseSegment(v[i]);
+
+		ParamIntSet(ParamID::TxoLogSize, nSize1);
+	}
 }
 
 void NodeDB::TxoSetSpent(TxoID id, Height h)
@@ -2131,9 +2483,41 @@ void NodeDB::TxoSetSpent(TxoID id, Height h)
 	TestChanged1Row();
 }
 
+void NodeDB::TxoSetSpent(const TxoID* pIDs, uint32_t nCount, Height h)
+{
+	// ascending order, for the locality of the index updates
+	std::vector<TxoID> v(pIDs, pIDs + nCount);
+	std::sort(v.begin(), v.end());
+
+	const uint32_t nBatch = 1U << s_TxoBatchLog;
+	static const std::string s_SqlBatch = MakeBatchSql("UPDATE " TblTxo " SET " TblTxo_SpendHeight "=? WHERE " TblTxo_ID " IN(", "?", nBatch, ")");
+
+	for (uint32_t i = 0; i < nCount; )
+	{
+		Recordset rs(*this, Query::TxoSetSpentBatch, s_SqlBatch.c_str());
+		if (MaxHeight != h)
+			rs.put(0, h);
+
+		// the last chunk is padded by repeating its last ID, duplicates in IN() don't matter
+		uint32_t nRows = std::min(nBatch, nCount - i);
+		for (uint32_t iRow = 0; iRow < nBatch; iRow++)
+			rs.put(iRow + 1, v[i + std::min(iRow, nRows - 1)]);
+
+		rs.Step();
+
+		if (static_cast<int>(nRows) != get_RowsChanged())
+			ThrowError("batch change failed");
+
+		i += nRows;
+	}
+}
+
+#define TblTxo_WalkerFields TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight "," TblTxo_Pos "," TblTxo_Size
+
 void NodeDB::EnumTxos(WalkerTxo& wlk, TxoID id0)
 {
-	wlk.m_Rs.Reset(*this, Query::TxoEnum, "SELECT " TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight " FROM " TblTxo " WHERE " TblTxo_ID ">=? ORDER BY " TblTxo_ID);
+	wlk.m_pDB = this;
+	wlk.m_Rs.Reset(*this, Query::TxoEnum, "SELECT " TblTxo_WalkerFields " FROM " TblTxo " WHERE " TblTxo_ID ">=? ORDER BY " TblTxo_ID);
 	wlk.m_Rs.put(0, id0);
 }
 
@@ -2143,7 +2527,20 @@ bool NodeDB::WalkerTxo::MoveNext()
 		return false;
 
 	m_Rs.get(0, m_ID);
-	m_Rs.get(1, m_Value);
+
+	if (m_Rs.IsNull(1))
+	{
+		uint64_t pos;
+		uint32_t n;
+		m_Rs.get(3, pos);
+		m_Rs.get(4, n);
+
+		assert(m_pDB);
+		m_pDB->TxoLogRead(pos, n, m_Buf);
+		m_Value = Blob(m_Buf);
+	}
+	else
+		m_Rs.get(1, m_Value);
 
 	if (m_Rs.IsNull(2))
 		m_SpendHeight = MaxHeight;
@@ -2155,20 +2552,225 @@ bool NodeDB::WalkerTxo::MoveNext()
 
 void NodeDB::TxoSetValue(TxoID id, const Blob& v)
 {
-	Recordset rs(*this, Query::TxoSetValue, "UPDATE " TblTxo " SET " TblTxo_Value "=? WHERE " TblTxo_ID "=?");
-	rs.put(0, v);
-	rs.put(1, id);
+	TxoLogDelta d;
+	uint64_t pos;
+	uint32_t n;
+	if (TxoLogGetPos(id, pos, n))
+		TxoLogRef(d, pos, n, false); // the previously referenced log space is released
+
+	Recordset rs(*this, Query::TxoSetValue, "UPDATE " TblTxo " SET " TblTxo_Value "=?," TblTxo_Pos "=?," TblTxo_Size "=? WHERE " TblTxo_ID "=?");
+
+	if (v.n <= s_TxoInlineMax)
+		rs.put(0, v);
+	else
+	{
+		rs.put(1, TxoLogAppend(v, d));
+		rs.put(2, v.n);
+	}
+
+	rs.put(3, id);
 	rs.Step();
 	TestChanged1Row();
+
+	TxoLogApply(d);
 }
 
 void NodeDB::TxoGetValue(WalkerTxo& wlk, TxoID id0)
 {
-	wlk.m_Rs.Reset(*this, Query::TxoGetValue, "SELECT " TblTxo_Value " FROM " TblTxo " WHERE " TblTxo_ID "=?");
+	wlk.m_pDB = this;
+	wlk.m_Rs.Reset(*this, Query::TxoGetValue, "SELECT " TblTxo_WalkerFields " FROM " TblTxo " WHERE " TblTxo_ID "=?");
 	wlk.m_Rs.put(0, id0);
 
-	wlk.m_Rs.StepStrict();
-	wlk.m_Rs.get(0, wlk.m_Value);
+	if (!wlk.MoveNext())
+		ThrowError("not found");
+}
+
+const uint32_t NodeDB::s_TxoInlineMax = 0x40; // naked TXOs must fit
+
+void NodeDB::TxoLogRef(TxoLogDelta& d, uint64_t pos, uint32_t nSize, bool bAdd)
+{
+	// a value may span several segments, each one is charged for its part
+	while (nSize)
+	{
+		uint64_t iSegment = pos / s_StreamBlob;
+		uint32_t nPortion = std::min(nSize, static_cast<uint32_t>(s_StreamBlob - pos % s_StreamBlob));
+
+		int64_t& val = d[iSegment];
+		if (bAdd)
+			val += nPortion;
+		else
+			val -= nPortion;
+
+		pos += nPortion;
+		nSize -= nPortion;
+	}
+}
+
+void NodeDB::TxoLogApply(const TxoLogDelta& d)
+{
+	for (auto it = d.begin(); d.end() != it; it++)
+	{
+		if (!it->second)
+			continue;
+
+		Recordset rs(*this, Query::TxoSegAdd, "UPDATE " TblTxoSegs " SET " TblTxoSegs_Live "=" TblTxoSegs_Live "+? WHERE " TblTxoSegs_ID "=?");
+		rs.put(0, static_cast<uint64_t>(it->second)); // bound as int64, negative for the released space
+		rs.put(1, it->first);
+		rs.Step();
+		TestChanged1Row();
+	}
+}
+
+void NodeDB::TxoLogGrow(uint64_t nSize, uint64_t nSize0)
+{
+	assert(nSize > nSize0);
+
+	uint64_t nBlobs0 = (nSize0 + s_StreamBlob - 1) / s_StreamBlob;
+	uint64_t nBlobs1 = (nSize + s_StreamBlob - 1) / s_StreamBlob;
+
+	StreamResize(StreamType::TxoLog, nSize, nSize0);
+	ParamIntSet(ParamID::TxoLogSize, nSize);
+
+	for (; nBlobs0 < nBlobs1; nBlobs0++)
+	{
+		Recordset rs(*this, Query::TxoSegIns, "INSERT INTO " TblTxoSegs "(" TblTxoSegs_ID "," TblTxoSegs_Live ") VALUES (?,0)");
+		rs.put(0, nBlobs0);
+		rs.Step();
+		TestChanged1Row();
+	}
+}
+
+uint64_t NodeDB::TxoLogAppend(const Blob& v, TxoLogDelta& d)
+{
+	uint64_t pos = ParamIntGetDef(ParamID::TxoLogSize);
+
+	TxoLogGrow(pos + v.n, pos);
+	StreamIO(StreamType::TxoLog, pos, reinterpret_cast<uint8_t*>(Cast::NotConst(v.p)), v.n, true);
+	TxoLogRef(d, pos, v.n, true);
+
+	return pos;
+}
+
+bool NodeDB::TxoLogGetPos(TxoID id, uint64_t& pos, uint32_t& nSize)
+{
+	Recordset rs(*this, Query::TxoLogGetPos, "SELECT " TblTxo_Pos "," TblTxo_Size " FROM " TblTxo " WHERE " TblTxo_ID "=?");
+	rs.put(0, id);
+	if (!rs.Step() || rs.IsNull(0))
+		return false;
+
+	rs.get(0, pos);
+	rs.get(1, nSize);
+	return true;
+}
+
+void NodeDB::TxoLogRead(uint64_t pos, uint32_t nSize, ByteBuffer& buf)
+{
+	buf.resize(nSize);
+	if (nSize)
+		StreamIO(StreamType::TxoLog, pos, &buf.front(), nSize, false);
+}
+
+void NodeDB::TxoLogEraseSegment(uint64_t iSegment)
+{
+	StreamCut(StreamType::TxoLog, iSegment, iSegment + 1);
+
+	Recordset rs(*this, Query::TxoSegDel, "DELETE FROM " TblTxoSegs " WHERE " TblTxoSegs_ID "=?");
+	rs.put(0, iSegment);
+	rs.Step();
+	TestChanged1Row();
+}
+
+void NodeDB::TxoLogCompact()
+{
+	// the segment being appended to is never erased or relocated
+	uint64_t iTail = ParamIntGetDef(ParamID::TxoLogSize) / s_StreamBlob;
+
+	// relocate the sparsest segment, if it's sparse enough. Once per call, to limit the amount of work
+	Recordset rs(*this, Query::TxoSegSparsest, "SELECT " TblTxoSegs_ID "," TblTxoSegs_Live " FROM " TblTxoSegs " WHERE " TblTxoSegs_ID "<? AND " TblTxoSegs_Live ">0 ORDER BY " TblTxoSegs_Live " LIMIT 1");
+	rs.put(0, iTail);
+	if (rs.Step())
+	{
+		uint64_t iSegment, nLive;
+		rs.get(0, iSegment);
+		rs.get(1, nLive);
+
+		if (nLive <= s_StreamBlob / 4)
+			TxoLogRelocateSegment(iSegment);
+	}
+
+	// erase all the segments with no referenced values, not only the leading ones
+	std::vector<uint64_t> v;
+
+	rs.Reset(*this, Query::TxoSegEnumDead, "SELECT " TblTxoSegs_ID " FROM " TblTxoSegs " WHERE " TblTxoSegs_ID "<? AND " TblTxoSegs_Live "=0");
+	rs.put(0, iTail);
+	while (rs.Step())
+		rs.get(0, v.emplace_back());
+
+	for (size_t i = 0; i < v.size(); i++)
+		TxoLogEraseSegment(v[i]);
+}
+
+void NodeDB::get_TxoLogStats(TxoLogStats& x)
+{
+	x.m_Size = ParamIntGetDef(ParamID::TxoLogSize);
+
+	Recordset rs(*this, Query::TxoSegStats, "SELECT COUNT(*),SUM(" TblTxoSegs_Live ") FROM " TblTxoSegs);
+	rs.StepStrict();
+	rs.get(0, x.m_Segments);
+
+	x.m_Live = 0;
+	if (!rs.IsNull(1))
+		rs.get(1, x.m_Live);
+}
+
+void NodeDB::TxoLogRelocateSegment(uint64_t iSegment)
+{
+	struct Item
+	{
+		TxoID m_ID;
+		uint64_t m_Pos;
+		uint32_t m_Size;
+	};
+
+	std::vector<Item> v;
+
+	{
+		// values don't overlap, walk down from the segment end until the 1st one that ends before the segment
+		Recordset rs(*this, Query::TxoLogSegment, "SELECT " TblTxo_ID "," TblTxo_Pos "," TblTxo_Size " FROM " TblTxo " WHERE " TblTxo_Pos "<? ORDER BY " TblTxo_Pos " DESC");
+		rs.put(0, (iSegment + 1) * s_StreamBlob);
+
+		while (rs.Step())
+		{
+			Item& x = v.emplace_back();
+			rs.get(0, x.m_ID);
+			rs.get(1, x.m_Pos);
+			rs.get(2, x.m_Size);
+
+			if (x.m_Pos + x.m_Size <= iSegment * s_StreamBlob)
+			{
+				v.pop_back();
+				break;
+			}
+		}
+	}
+
+	TxoLogDelta d;
+	ByteBuffer buf;
+
+	for (size_t i = 0; i < v.size(); i++)
+	{
+		const Item& x = v[i];
+		TxoLogRead(x.m_Pos, x.m_Size, buf);
+		TxoLogRef(d, x.m_Pos, x.m_Size, false);
+
+		Recordset rs(*this, Query::TxoLogSetPos, "UPDATE " TblTxo " SET " TblTxo_Pos "=? WHERE " TblTxo_ID "=?");
+		rs.put(0, TxoLogAppend(Blob(buf), d));
+		rs.put(1, x.m_ID);
+		rs.Step();
+		TestChanged1Row();
+	}
+
+	TxoLogApply(d);
 }
 
 NodeDB::StreamMmr::StreamMmr(NodeDB& db, StreamType::Enum eType, bool bStoreH0)
@@ -2308,6 +2910,18 @@ void NodeDB::StreamResize(StreamType::Enum eType, uint64_t n, uint64_t n0)
 	uint64_t nBlobs0 = (n0 + s_StreamBlob - 1) / s_StreamBlob;
 	uint64_t nBlobs1 = (n + s_StreamBlob - 1) / s_StreamBlob;
 
+	if (nBlobs0 > nBlobs1)
+	{
+		StreamCut(eType, nBlobs1, nBlobs0);
+		return;
+	}
+
+	if (nBlobs0 == nBlobs1)
+		return;
+
+	if (StreamType::IsMapped(eType) && !StreamGrowMapped(eType, nBlobs1, nBlobs0))
+		OnStreamsUnmappedWrite();
+
 	for (; nBlobs0 < nBlobs1; nBlobs0++)
 	{
 		Recordset rs(*this, Query::StreamIns, "INSERT INTO " TblStreams "(" TblStream_ID "," TblStream_Value ") VALUES (?,?)");
@@ -2316,18 +2930,33 @@ void NodeDB::StreamResize(StreamType::Enum eType, uint64_t n, uint64_t n0)
 		rs.Step();
 		TestChanged1Row();
 	}
+}
 
-	if (nBlobs0 > nBlobs1)
+void NodeDB::StreamCut(StreamType::Enum eType, uint64_t nBlob0, uint64_t nBlob1)
+{
+	assert(nBlob0 < nBlob1);
+
+	if (StreamType::IsMapped(eType))
 	{
-		Recordset rs(*this, Query::StreamDel, "DELETE FROM " TblStreams " WHERE " TblStream_ID ">=? AND " TblStream_ID "<?");
-		rs.put(0, StreamType::Key(nBlobs1, eType));
-		rs.put(1, StreamType::Key(nBlobs0, eType));
-		rs.Step();
+		if (m_StreamsMapped.IsOpen())
+		{
+			m_StreamsMapped.OnDirty();
 
-		uint64_t ret = get_RowsChanged();
-		if (ret != nBlobs0 - nBlobs1)
-			ThrowInconsistent();
+			for (uint64_t i = nBlob0; i < nBlob1; i++)
+				m_StreamsMapped.DeleteBlob(eType, i);
+		}
+		else
+			OnStreamsUnmappedWrite();
 	}
+
+	Recordset rs(*this, Query::StreamDel, "DELETE FROM " TblStreams " WHERE " TblStream_ID ">=? AND " TblStream_ID "<?");
+	rs.put(0, StreamType::Key(nBlob0, eType));
+	rs.put(1, StreamType::Key(nBlob1, eType));
+	rs.Step();
+
+	uint64_t ret = get_RowsChanged();
+	if (ret != nBlob1 - nBlob0)
+		ThrowInconsistent();
 }
 
 void NodeDB::ShieldedResize(uint64_t n, uint64_t n0)
@@ -2336,6 +2965,24 @@ void NodeDB::ShieldedResize(uint64_t n, uint64_t n0)
 }
 
 void NodeDB::StreamIO(StreamType::Enum eType, uint64_t pos, uint8_t* p, uint64_t nCount, bool bWrite)
+{
+	if (!StreamType::IsMapped(eType))
+		StreamIODB(eType, pos, p, nCount, bWrite);
+	else if (bWrite)
+	{
+		StreamIODB(eType, pos, p, nCount, true);
+
+		if (!StreamIOMapped(eType, pos, p, nCount, true))
+			OnStreamsUnmappedWrite();
+	}
+	else
+	{
+		if (!StreamIOMapped(eType, pos, p, nCount, false))
+			StreamIODB(eType, pos, p, nCount, false);
+	}
+}
+
+void NodeDB::StreamIODB(StreamType::Enum eType, uint64_t pos, uint8_t* p, uint64_t nCount, bool bWrite)
 {
 	struct Guard
 	{
@@ -2374,6 +3021,257 @@ void NodeDB::StreamIO(StreamType::Enum eType, uint64_t pos, uint8_t* p, uint64_t
 	}
 }
 
+bool NodeDB::StreamIOMapped(StreamType::Enum eType, uint64_t pos, uint8_t* p, uint64_t nCount, bool bWrite)
+{
+	if (!m_StreamsMapped.IsOpen())
+		return false;
+
+	if (bWrite)
+		m_StreamsMapped.OnDirty();
+
+	uint64_t nBlob0 = pos / s_StreamBlob;
+	uint32_t nOffs = static_cast<uint32_t>(pos % s_StreamBlob);
+
+	while (nCount)
+	{
+		uint8_t* pBlob = m_StreamsMapped.get_Blob(eType, nBlob0);
+		if (!pBlob)
+		{
+			// image is inconsistent with the DB
+			StreamsImageClose();
+			return false;
+		}
+
+		uint32_t nPortion = s_StreamBlob - nOffs;
+		if (nPortion > nCount)
+			nPortion = static_cast<uint32_t>(nCount);
+
+		if (bWrite)
+			memcpy(pBlob + nOffs, p, nPortion);
+		else
+			memcpy(p, pBlob + nOffs, nPortion);
+
+		nCount -= nPortion;
+		p += nPortion;
+		nOffs = 0;
+		nBlob0++;
+	}
+
+	return true;
+}
+
+bool NodeDB::StreamGrowMapped(StreamType::Enum eType, uint64_t nBlobs, uint64_t nBlobs0)
+{
+	if (!m_StreamsMapped.IsOpen())
+		return false;
+
+	m_StreamsMapped.OnDirty();
+
+	try
+	{
+		for (; nBlobs0 < nBlobs; nBlobs0++)
+		{
+			if (!m_StreamsMapped.CreateBlob(eType, nBlobs0))
+			{
+				StreamsImageClose();
+				return false;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		ThrowError(e.what()); // promote it
+	}
+
+	return true;
+}
+
+void NodeDB::OnStreamsUnmappedWrite()
+{
+	// the saved image (if any) doesn't reflect this change. Make sure it won't be used
+	if (!m_StreamsStampReset)
+	{
+		ParamSet(ParamID::StreamsStamp, nullptr, nullptr);
+		m_StreamsStampReset = true;
+	}
+}
+
+bool NodeDB::StreamsImageOpen(const char* szPath)
+{
+	StreamsMapped::Stamp us;
+	Blob blob(us);
+
+	if (!ParamGet(ParamID::StreamsStamp, nullptr, &blob))
+	{
+		us = 1U;
+		us.Negate();
+	}
+
+	if (m_StreamsMapped.Open(szPath, us))
+		return true;
+
+	m_StreamsMapped.OnDirty();
+
+	try
+	{
+		Recordset rs(*this, Query::StreamEnum, "SELECT " TblStream_ID "," TblStream_Value " FROM " TblStreams);
+		while (rs.Step())
+		{
+			uint64_t key;
+			rs.get(0, key);
+
+			uint32_t eType = static_cast<uint32_t>(key >> 32);
+			if (eType >= StreamType::count)
+				ThrowInconsistent();
+
+			if (!StreamType::IsMapped(static_cast<StreamType::Enum>(eType)))
+				continue;
+
+			uint8_t* pBlob = m_StreamsMapped.CreateBlob(static_cast<StreamType::Enum>(eType), static_cast<uint32_t>(key));
+			if (!pBlob)
+			{
+				StreamsImageClose();
+				break;
+			}
+
+			memcpy(pBlob, rs.get_BlobStrict(1, s_StreamBlob), s_StreamBlob);
+		}
+	}
+	catch (const CorruptionException&)
+	{
+		throw;
+	}
+	catch (const std::exception& e)
+	{
+		ThrowError(e.what()); // promote it
+	}
+
+	return false;
+}
+
+void NodeDB::StreamsImageClose()
+{
+	if (m_StreamsMapped.IsOpen())
+	{
+		m_StreamsMapped.OnDirty();
+		m_StreamsMapped.Close();
+	}
+}
+
+const uint32_t NodeDB::StreamsMapped::s_DirSize = s_StreamBlob / sizeof(MappedFile::Offset);
+
+bool NodeDB::StreamsMapped::Open(const char* sz, const Stamp& s)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x3C, 0x71, 0xE2, 0x09,
+		0x8B, 0x54, 0xA6, 0x1F,
+		0xD0, 0x2E, 0x97, 0x6B,
+		0x15, 0xC8, 0x4D, 0xF4
+	};
+
+	MappedFile::Defs d;
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 1; // blobs and dirs
+	d.m_nFixedHdr = sizeof(Hdr);
+
+	m_Mapping.Open(sz, d);
+
+	Hdr& h = get_Hdr();
+	if (!h.m_Dirty && (h.m_Stamp == s))
+		return true;
+
+	m_Mapping.Open(sz, d, true); // reset
+	return false;
+}
+
+void NodeDB::StreamsMapped::Close()
+{
+	m_Mapping.Close();
+}
+
+NodeDB::StreamsMapped::Hdr& NodeDB::StreamsMapped::get_Hdr()
+{
+	return *static_cast<Hdr*>(m_Mapping.get_FixedHdr());
+}
+
+bool NodeDB::StreamsMapped::IsDirty()
+{
+	return IsOpen() && get_Hdr().m_Dirty;
+}
+
+void NodeDB::StreamsMapped::OnDirty()
+{
+	get_Hdr().m_Dirty = 1;
+}
+
+void NodeDB::StreamsMapped::FlushStrict(const Stamp& s)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Dirty = 0;
+	h.m_Stamp = s;
+}
+
+MappedFile::Offset* NodeDB::StreamsMapped::get_Dir(StreamType::Enum eType, bool bCreate)
+{
+	if (!get_Hdr().m_pDir[eType])
+	{
+		if (!bCreate)
+			return nullptr;
+
+		void* p = m_Mapping.Allocate(0, s_StreamBlob); // may remap, re-fetch the header
+		memset0(p, s_StreamBlob);
+		get_Hdr().m_pDir[eType] = m_Mapping.get_Offset(p);
+	}
+
+	return &m_Mapping.get_At<MappedFile::Offset>(get_Hdr().m_pDir[eType]);
+}
+
+uint8_t* NodeDB::StreamsMapped::get_Blob(StreamType::Enum eType, uint64_t iBlob)
+{
+	if (iBlob >= s_DirSize)
+		return nullptr;
+
+	MappedFile::Offset* pDir = get_Dir(eType, false);
+	if (!pDir || !pDir[iBlob])
+		return nullptr;
+
+	return &m_Mapping.get_At<uint8_t>(pDir[iBlob]);
+}
+
+uint8_t* NodeDB::StreamsMapped::CreateBlob(StreamType::Enum eType, uint64_t iBlob)
+{
+	if (iBlob >= s_DirSize)
+		return nullptr;
+
+	get_Dir(eType, true);
+
+	uint8_t* p = static_cast<uint8_t*>(m_Mapping.Allocate(0, s_StreamBlob));
+	memset0(p, s_StreamBlob);
+
+	MappedFile::Offset* pDir = get_Dir(eType, false); // re-fetch after allocation
+	assert(!pDir[iBlob]);
+	pDir[iBlob] = m_Mapping.get_Offset(p);
+
+	return p;
+}
+
+void NodeDB::StreamsMapped::DeleteBlob(StreamType::Enum eType, uint64_t iBlob)
+{
+	if (iBlob >= s_DirSize)
+		return;
+
+	MappedFile::Offset* pDir = get_Dir(eType, false);
+	if (pDir && pDir[iBlob])
+	{
+		m_Mapping.Free(0, &m_Mapping.get_At<uint8_t>(pDir[iBlob]));
+		pDir[iBlob] = 0;
+	}
+}
+
 void NodeDB::ShieldeIO(uint64_t pos, ECC::Point::Storage* p, uint64_t nCount, bool bWrite)
 {
 	StreamIO(StreamType::Shielded, pos * sizeof(ECC::Point::Storage), reinterpret_cast<uint8_t*>(p), nCount * sizeof(ECC::Point::Storage), bWrite);
@@ -2640,4 +3538,35 @@ void NodeDB::MigrateFrom20()
 	}
 }
 
+void NodeDB::MigrateFrom21()
+{
+	LOG_INFO() << "Moving TXO values to the log...";
+
+	ExecQuick("ALTER TABLE [" TblTxo "] RENAME TO [" TblTxo "Old]");
+	CreateTableTxo();
+
+	{
+		Recordset rs(*this, Query::TxoEnumMigrate, "SELECT " TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight " FROM " TblTxo "Old ORDER BY " TblTxo_ID);
+		while (rs.Step())
+		{
+			TxoID id;
+			Blob val;
+			rs.get(0, id);
+			rs.get(1, val);
+
+			TxoAdd(id, val);
+
+			if (!rs.IsNull(2))
+			{
+				Height h;
+				rs.get(2, h);
+				TxoSetSpent(id, h);
+			}
+		}
+	}
+
+	m_pPrep[Query::TxoEnumMigrate].Close();
+	ExecQuick("DROP TABLE [" TblTxo "Old]");
+}
+
 } // namespace beam
@@ -16,6 +16,7 @@
 
 #include "core/common.h"
 #include "core/block_crypt.h"
+#include "core/mapped_file.h"
 #include "sqlite/sqlite3.h"
 
 namespace beam {
@@ -59,6 +60,8 @@ public:
 			ShieldedInputs,
 			AssetsCount, // Including unused. The last element is guaranteed to be used.
 			AssetsCountUsed, // num of 'live' assets
+			StreamsStamp,
+			TxoLogSize, // end of the TXO log stream, including the erased segments
 		};
 	};
 
@@ -145,17 +148,37 @@ public:
 			KernelFind,
 			KernelDel,
 			TxoAdd,
+			TxoAdd2, // multi-row variants, must follow TxoAdd, each twice the size of the previous
+			TxoAdd4,
+			TxoAdd8,
+			TxoAdd16,
+			TxoAdd32,
 			TxoDel,
 			TxoDelFrom,
 			TxoSetSpent,
+			TxoSetSpentBatch,
 			TxoEnum,
 			TxoEnumBySpentMigrate,
 			TxoSetValue,
 			TxoGetValue,
+			TxoEnumMigrate,
+			TxoLogMax,
+			TxoLogSegment,
+			TxoLogSetPos,
+			TxoLogGetPos,
+			TxoLogEnumFrom,
+			TxoSegIns,
+			TxoSegAdd,
+			TxoSegDel,
+			TxoSegEnumDead,
+			TxoSegEnumFrom,
+			TxoSegSparsest,
+			TxoSegStats,
 			BlockFind,
 			FindHeightBelow,
 			StreamIns,
 			StreamDel,
+			StreamEnum,
 			EnumSystemStatesBkwd,
 			UniqueIns,
 			UniqueFind,
@@ -186,20 +209,45 @@ public:
 			Shielded,
 			ShieldedMmr,
 			AssetsMmr,
+			TxoLog,
 
 			count
 		};
 
 		static uint64_t Key(uint64_t idx, Enum);
+		static bool IsMapped(Enum e) { return TxoLog != e; } // the TXO log is read from the DB, it's not mirrored by the image
 	};
 
 	NodeDB();
 	virtual ~NodeDB();
 
 	void Close();
+
+	// Storage tuning. Connection-level settings (cache, mmap, synchronous) are applied on each open.
+	// The page size affects only newly created DBs (or the full vacuum in the rollback journal mode).
+	struct Profile
+	{
+		bool m_Wal = false; // WAL journal instead of the rollback one. Readers (see OpenReader) don't block the writer
+		uint32_t m_PageSize = 0; // 0 - sqlite default
+		int32_t m_CacheSize = 0; // as in PRAGMA cache_size: positive - pages, negative - KiB. 0 - sqlite default
+		uint64_t m_MmapSize = 0;
+		int m_Synchronous = -1; // 0 - OFF, 1 - NORMAL, 2 - FULL, 3 - EXTRA. Negative - sqlite default (FULL)
+		uint32_t m_AutoCheckpoint = 0; // WAL only. 0 - disabled, the owner should call Checkpoint() periodically
+
+		void SetDefault(); // rollback journal, exclusive locking, sqlite defaults
+		void SetWal(); // WAL + synchronous NORMAL, larger cache, mmap
+		void SetWalFast(); // WAL + synchronous OFF. Survives the app crash, but not the OS crash or power loss
+		bool Set(const std::string&); // by name: "default", "wal", "wal_fast"
+	};
+
 	void Open(const char* szPath);
+	void Open(const char* szPath, const Profile&);
+	void OpenReader(const char* szPath); // read-only secondary connection. Runs concurrently with the writer in WAL mode
+	bool Checkpoint(); // WAL: passive checkpoint, must be called outside of a transaction. Returns false if some frames remain
 
-	void Vacuum();
+	void Vacuum(); // also switches the DB to the incremental auto-vacuum mode
+	bool VacuumIncremental(uint32_t nPagesMax, uint32_t& nPagesDone); // returns true if more free pages remain
+	bool IsVacuumIncremental(); // auto_vacuum mode is INCREMENTAL
 	void CheckIntegrity();
 
 	virtual void OnModified() {}
@@ -208,6 +256,7 @@ public:
 	{
 		sqlite3_stmt* m_pStmt;
 		NodeDB* m_pDB;
+		Query::Enum m_Query;
 
 		void InitInternal(NodeDB&, Query::Enum, const char*);
 
@@ -278,6 +327,7 @@ public:
 
 	uint64_t ParamIntGetDef(uint32_t ID, uint64_t def = 0);
 	void ParamIntSet(uint32_t ID, uint64_t val);
+	void ParamStampUpdate(uint32_t ID, Merkle::Hash&); // derives the next stamp from the saved one (or random if none), and saves it
 
 	uint64_t InsertState(const Block::SystemState::Full&, const PeerID&); // Fails if state already exists
 
@@ -483,6 +533,10 @@ public:
 	void TxoDelFrom(TxoID);
 	void TxoSetSpent(TxoID, Height);
 
+	// Bulk variants, used per block. Rows are written by multi-row statements, the log-stored values are appended at once.
+	void TxoAdd(TxoID id0, const Blob* pVals, uint32_t nCount); // consecutive IDs, starting from id0
+	void TxoSetSpent(const TxoID*, uint32_t nCount, Height); // applied in ascending ID order
+
 	struct WalkerTxo
 	{
 		Recordset m_Rs;
@@ -490,6 +544,9 @@ public:
 		Blob m_Value;
 		Height m_SpendHeight;
 
+		NodeDB* m_pDB = nullptr;
+		ByteBuffer m_Buf; // for values read from the TXO log
+
 		bool MoveNext();
 	};
 
@@ -497,6 +554,20 @@ public:
 	void TxoSetValue(TxoID, const Blob&);
 	void TxoGetValue(WalkerTxo&, TxoID);
 
+	// TXO values (except small ones, such as naked) are appended to the TXO log stream, the Txo table keeps only their location.
+	// The log is split into segments (stream blobs), each has its count of referenced (live) bytes. Segments with no live bytes
+	// are erased, wherever they are. Sparse ones are relocated to the tail first.
+	void TxoLogCompact();
+
+	struct TxoLogStats
+	{
+		uint64_t m_Size; // end of the log
+		uint64_t m_Segments; // not erased
+		uint64_t m_Live; // referenced bytes
+	};
+
+	void get_TxoLogStats(TxoLogStats&);
+
 	void ShieldedResize(uint64_t n, uint64_t n0);
 	void ShieldedWrite(uint64_t pos, const ECC::Point::Storage*, uint64_t nCount);
 	void ShieldedRead(uint64_t pos, ECC::Point::Storage*, uint64_t nCount);
@@ -512,6 +583,12 @@ public:
 
 	void EnumSystemStatesBkwd(WalkerSystemState&, const StateID&);
 
+	// Optional memory-mapped image of the streams (MMRs and shielded elements), reads are served from it without sqlite blob access.
+	// The DB remains authoritative, the image is bound to it by the StreamsStamp, which is renewed on each commit that modifies it.
+	// On rollback the modified image is discarded, and the DB is used until the next open.
+	bool StreamsImageOpen(const char* szPath); // returns false if the image was rebuilt from the DB
+	void StreamsImageClose();
+
 	class StreamMmr
 		:public Merkle::FlatMmr
 	{
@@ -583,6 +660,17 @@ private:
 
 	sqlite3* m_pDb;
 
+	// In WAL mode the locking is normal (for readers), the writer process is guarded by a lock file instead.
+	// The mapped images (utxo, streams) rely on a single writer
+#ifdef WIN32
+	HANDLE m_hLock;
+#else // WIN32
+	int m_hLock;
+#endif // WIN32
+
+	void LockWriter(const char* szPath);
+	void UnlockWriter();
+
 	struct Statement
 	{
 		sqlite3_stmt* m_pStmt;
@@ -605,8 +693,8 @@ private:
 	void CreateTables20();
 	void ExecQuick(const char*);
 	std::string ExecTextOut(const char*);
-	bool ExecStep(sqlite3_stmt*);
-	int ExecStepRaw(sqlite3_stmt*);
+	bool ExecStep(sqlite3_stmt*, uint32_t iQuery = Query::count);
+	int ExecStepRaw(sqlite3_stmt*, uint32_t iQuery = Query::count); // iQuery is for stats only
 	bool ExecStep(Query::Enum, const char*); // returns true while there's a row
 
 	sqlite3_stmt* get_Statement(Query::Enum, const char*);
@@ -625,14 +713,75 @@ private:
 
 	void MigrateFrom18();
 	void MigrateFrom20();
+	void MigrateFrom21();
+	void CreateTableTxo();
 
 	static const uint32_t s_StreamBlob;
 
 	void StreamIO(StreamType::Enum, uint64_t pos, uint8_t*, uint64_t nCount, bool bWrite);
 	void StreamResize(StreamType::Enum, uint64_t n, uint64_t n0);
+	void StreamIODB(StreamType::Enum, uint64_t pos, uint8_t*, uint64_t nCount, bool bWrite);
+	bool StreamIOMapped(StreamType::Enum, uint64_t pos, uint8_t*, uint64_t nCount, bool bWrite);
+	bool StreamGrowMapped(StreamType::Enum, uint64_t nBlobs, uint64_t nBlobs0);
+	void StreamCut(StreamType::Enum, uint64_t nBlob0, uint64_t nBlob1); // erase blobs [nBlob0, nBlob1)
+	void OnStreamsUnmappedWrite();
+
+	class StreamsMapped
+	{
+		MappedFile m_Mapping;
+
+		MappedFile::Offset* get_Dir(StreamType::Enum, bool bCreate);
+
+	public:
+		typedef Merkle::Hash Stamp;
+
+		~StreamsMapped() { Close(); }
+
+		bool Open(const char* sz, const Stamp&);
+		bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+		void Close();
+
+		bool IsDirty();
+		void OnDirty();
+		void FlushStrict(const Stamp&);
+
+		static const uint32_t s_DirSize; // max blobs per stream
+
+		uint8_t* get_Blob(StreamType::Enum, uint64_t iBlob); // nullptr if missing
+		uint8_t* CreateBlob(StreamType::Enum, uint64_t iBlob); // zero-initialized. nullptr if beyond the dir size
+		void DeleteBlob(StreamType::Enum, uint64_t iBlob);
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			MappedFile::Offset m_pDir[StreamType::count];
+			MappedFile::Offset m_Dirty; // boolean, just aligned
+			Stamp m_Stamp;
+		};
+#pragma pack(pop)
+
+		Hdr& get_Hdr();
+	};
+
+	StreamsMapped m_StreamsMapped;
+	bool m_StreamsStampReset; // set once the stamp is invalidated in the current transaction
 
 	void ShieldeIO(uint64_t pos, ECC::Point::Storage*, uint64_t nCount, bool bWrite);
 
+	static const uint32_t s_TxoInlineMax; // larger values go to the log
+	static const uint32_t s_TxoBatchLog = 5; // max rows per multi-row statement is 2^s_TxoBatchLog
+
+	typedef std::map<uint64_t, int64_t> TxoLogDelta; // segment -> change of its live bytes
+	static void TxoLogRef(TxoLogDelta&, uint64_t pos, uint32_t nSize, bool bAdd);
+	void TxoLogApply(const TxoLogDelta&);
+
+	void TxoLogGrow(uint64_t nSize, uint64_t nSize0);
+	uint64_t TxoLogAppend(const Blob&, TxoLogDelta&); // returns the position
+	bool TxoLogGetPos(TxoID, uint64_t& pos, uint32_t& nSize); // false if the value is inline
+	void TxoLogRead(uint64_t pos, uint32_t nSize, ByteBuffer&);
+	void TxoLogEraseSegment(uint64_t);
+	void TxoLogRelocateSegment(uint64_t);
+
 	static const Asset::ID s_AssetEmpty0;
 	void AssetInsertRaw(Asset::ID, const Asset::Full*);
 	void AssetDeleteRaw(Asset::ID);
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "node.h"
+#include "node_metrics.h"
 #include "../core/serialization_adapters.h"
 #include "../core/proto.h"
 #include "../core/ecc_native.h"
@@ -404,7 +405,7 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 	}
 	else
 	{
-		if (m_nTasksPackHdr >= proto::g_HdrPackMaxSize)
+		if (m_nTasksPackHdr >= m_Cfg.m_MaxConcurrentHdrsRequest)
 			return false; // too many hdrs requested
 
         if (nBlocks)
@@ -420,7 +421,7 @@ bool Node::TryAssignTask(Task& t, Peer& p)
 		if (nPackSize > dh)
 			nPackSize = (uint32_t) dh;
 
-		std::setmin(nPackSize, proto::g_HdrPackMaxSize - m_nTasksPackHdr);
+		std::setmin(nPackSize, m_Cfg.m_MaxConcurrentHdrsRequest - m_nTasksPackHdr);
 
         proto::GetHdrPack msg;
         msg.m_Top = t.m_Key.first;
@@ -564,7 +565,7 @@ void Node::Processor::DeleteOutdated()
 
 void Node::Processor::OnNewState()
 {
-    m_Cwp.Reset();
+    ResetCwp();
 
 	if (!IsTreasuryHandled())
         return;
@@ -665,6 +666,10 @@ void Node::Processor::OnRolledBack()
 {
     LOG_INFO() << "Rolled back to: " << m_Cursor.m_ID;
 
+	// the chainwork grows along the active branch, the states above the cursor are reverted
+	m_mapCwpStates.erase(m_mapCwpStates.upper_bound(m_Cursor.m_Full.m_ChainWork), m_mapCwpStates.end());
+	NodeMetrics::get().m_CwpStates.Set(m_mapCwpStates.size());
+
 	// Delete shielded txs which referenced shielded outputs which were reverted
 	TxPool::Fluff& txp = get_ParentObj().m_TxPool;
 	for (TxPool::Fluff::Queue::iterator it = txp.m_Queue.begin(); txp.m_Queue.end() != it; )
@@ -723,6 +728,25 @@ void Node::Processor::OnModified()
     }
 }
 
+void Node::Processor::OnPruneIncomplete()
+{
+	if (!m_bPrunePending)
+	{
+		if (!m_pPruneTimer)
+			m_pPruneTimer = io::Timer::create(io::Reactor::get_Current());
+
+		m_pPruneTimer->start(get_ParentObj().m_Cfg.m_Timeout.m_PruneBatch_ms, false, [this]() { OnPruneTimer(); });
+
+		m_bPrunePending = true;
+	}
+}
+
+void Node::Processor::OnPruneTimer()
+{
+	m_bPrunePending = false;
+	PruneOld(); // the DB is flushed by the regular timer, between the passes
+}
+
 void Node::Processor::TryGoUpAsync()
 {
 	if (!m_bGoUpPending)
@@ -749,12 +773,18 @@ void Node::Processor::Stop()
     m_ExecutorMT.Stop();
     m_bGoUpPending = false;
     m_bFlushPending = false;
+    m_bPrunePending = false;
 
     if (m_pGoUpTimer)
     {
         m_pGoUpTimer->cancel();
     }
 
+    if (m_pPruneTimer)
+    {
+        m_pPruneTimer->cancel();
+    }
+
     if (m_pFlushTimer)
     {
         m_pFlushTimer->cancel();
@@ -861,6 +891,7 @@ void Node::Keys::SetSingleKey(const Key::IKdf::Ptr& pKdf)
 void Node::Initialize(IExternalPOW* externalPOW)
 {
     m_Processor.m_Horizon = m_Cfg.m_Horizon;
+    m_Processor.m_Prune = m_Cfg.m_Prune;
     m_Processor.Initialize(m_Cfg.m_sPathLocal.c_str(), m_Cfg.m_ProcessorParams);
 
 	if (m_Cfg.m_ProcessorParams.m_EraseSelfID)
@@ -913,6 +944,18 @@ const PeerManager::AddrSet& Node::get_AcessiblePeerAddrs() const
     return m_PeerMan.get_Addrs();
 }
 
+void Node::UpdateMetrics()
+{
+	NodeMetrics& m = NodeMetrics::get();
+
+	m.m_ExecutorQueue.Set(m_Processor.m_ExecutorMT.get_Pending());
+	m.m_TxPoolFluff.Set(m_TxPool.m_setTxs.size());
+	m.m_TxPoolStem.Set(m_Dandelion.m_setProfit.size());
+	m.m_BbsMsgs.Set(m_Bbs.m_Totals.m_Count);
+	m.m_BbsSize.Set(m_Bbs.m_Totals.m_Size);
+	m.m_Peers.Set(m_lstPeers.size());
+}
+
 void Node::InitKeys()
 {
 	if (m_Keys.m_pOwner)
@@ -1131,6 +1174,11 @@ void Node::Peer::GenerateSChannelNonce(ECC::Scalar::Native& nonce)
     m_This.NextNonce(nonce);
 }
 
+void Node::Peer::OnTraffic(uint8_t nCode, uint32_t nSize, bool bOut)
+{
+	NodeMetrics::get().OnTraffic(nCode, nSize, bOut);
+}
+
 void Node::Peer::OnConnectedSecure()
 {
     LOG_INFO() << "Peer " << m_RemoteAddr << " Connected";
@@ -1531,6 +1579,7 @@ void Node::Peer::OnMsg(proto::NewTip&& msg)
         case NodeProcessor::DataStatus::Accepted:
 			// don't give explicit reward for this header. Instead - most likely we'll request this block from that peer, and it'll have a chance to boost its rating
             m_This.RefreshCongestions();
+            MaybeRequestHdrAnchors();
             break; // since we made OnPeerInsane handling asynchronous - no need to return rapidly
 
         case NodeProcessor::DataStatus::Unreachable:
@@ -1682,37 +1731,122 @@ bool Node::DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>& v, const pr
 		s1.m_ChainWork = s0.m_ChainWork + s1.m_PoW.m_Difficulty;
 	}
 
+	metrics::Timer tm(NodeMetrics::get().m_HdrPackVerify);
+
+	// Cheap checks first. Headers that are already known were verified when inserted, skip their PoW.
+	// Packs from different peers overlap, and packs may be re-requested after a peer is dropped
+	std::vector<uint32_t> vPoW;
+	vPoW.reserve(v.size());
+
+	NodeDB& db = m_Processor.get_DB();
+
+	for (uint32_t i = 0; i < v.size(); i++)
+	{
+		const Block::SystemState::Full& s = v[i];
+		if (!s.IsSane())
+			return false;
+
+		Block::SystemState::ID id;
+		id.m_Height = s.m_Height;
+		if (i + 1 < v.size())
+			id.m_Hash = v[i + 1].m_Prev; // already evaluated
+		else
+			s.get_Hash(id.m_Hash);
+
+		if (!db.StateFindSafe(id))
+			vPoW.push_back(i);
+	}
+
+	if (vPoW.empty())
+		return true;
+
+	// Threads pick small chunks, so that the load is balanced, and all of them stop soon after the 1st failure
 	struct MyTask
 		:public Executor::TaskSync
 	{
 		const Block::SystemState::Full* m_pV;
+		const uint32_t* m_pIdx;
 		uint32_t m_Count;
-		bool m_Valid;
+		std::atomic<uint32_t> m_iNext;
+		std::atomic<bool> m_Valid;
 
 		virtual ~MyTask() {}
 
-		virtual void Exec(Executor::Context& ctx) override
+		virtual void Exec(Executor::Context&) override
 		{
-            uint32_t i0, nCount;
-            ctx.get_Portion(i0, nCount, m_Count);
-            nCount += i0;
+			const uint32_t nChunk = 8;
+
+			while (m_Valid)
+			{
+				uint32_t i0 = m_iNext.fetch_add(nChunk);
+				if (i0 >= m_Count)
+					break;
 
-			for (; i0 < nCount; i0++)
-				if (!m_pV[i0].IsValid())
-					m_Valid = false;
+				uint32_t i1 = std::min(i0 + nChunk, m_Count);
+				for (; i0 < i1; i0++)
+				{
+					if (!m_pV[m_pIdx[i0]].IsValidPoW())
+					{
+						m_Valid = false;
+						break;
+					}
+				}
+			}
 		}
 	};
 
-    MyTask t;
-    t.m_pV = &v.front();
-    t.m_Count = static_cast<uint32_t>(v.size());
-    t.m_Valid = true;
+	MyTask t;
+	t.m_pV = &v.front();
+	t.m_pIdx = &vPoW.front();
+	t.m_Count = static_cast<uint32_t>(vPoW.size());
+	t.m_iNext = 0;
+	t.m_Valid = true;
 
-    m_Processor.m_ExecutorMT.ExecAll(t);
+	m_Processor.m_ExecutorMT.ExecAll(t);
 
 	return t.m_Valid;
 }
 
+bool Node::IsChainWorkConsistent(const std::vector<Block::SystemState::Full>& v)
+{
+	// Header packs may arrive out-of-order (from different peers, between the anchors). Make sure the pack joins its already-known neighbors properly
+	NodeDB& db = m_Processor.get_DB();
+
+	const Block::SystemState::Full& sLo = v.front();
+	if (sLo.m_Height > Rules::HeightGenesis)
+	{
+		Block::SystemState::ID id;
+		id.m_Height = sLo.m_Height - 1;
+		id.m_Hash = sLo.m_Prev;
+
+		uint64_t rowPrev = db.StateFindSafe(id);
+		if (rowPrev)
+		{
+			Difficulty::Raw wrk;
+			db.get_ChainWork(rowPrev, wrk);
+
+			if (wrk + sLo.m_PoW.m_Difficulty != sLo.m_ChainWork)
+				return false;
+		}
+	}
+
+	const Block::SystemState::Full& sHi = v.back();
+	Merkle::Hash hv;
+	sHi.get_Hash(hv);
+
+	NodeDB::WalkerState ws;
+	for (db.EnumStatesAt(ws, sHi.m_Height + 1); ws.MoveNext(); )
+	{
+		Block::SystemState::Full s;
+		db.get_State(ws.m_Sid.m_Row, s);
+
+		if ((s.m_Prev == hv) && (sHi.m_ChainWork + s.m_PoW.m_Difficulty != s.m_ChainWork))
+			return false;
+	}
+
+	return true;
+}
+
 void Node::Peer::OnMsg(proto::HdrPack&& msg)
 {
     Task& t = get_FirstTask();
@@ -1732,6 +1866,9 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
 	if (idLast != t.m_Key.first)
 		ThrowUnexpected();
 
+	if (!m_This.IsChainWorkConsistent(v))
+		ThrowUnexpected();
+
     for (size_t i = 0; i < v.size(); i++)
     {
         NodeProcessor::DataStatus::Enum eStatus = m_This.m_Processor.OnStateSilent(v[i], m_pInfo->m_ID.m_Key, idLast, true);
@@ -2000,6 +2137,15 @@ void Node::Peer::OnMsg(proto::NewTransaction&& msg)
 }
 
 uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx)
+{
+	metrics::Timer tm(NodeMetrics::get().m_TxValidate);
+
+	uint8_t nCode = ValidateTxInternal(ctx, tx);
+	NodeMetrics::get().OnTxStatus(nCode);
+	return nCode;
+}
+
+uint8_t Node::ValidateTxInternal(Transaction::Context& ctx, const Transaction& tx)
 {
 	ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
 
@@ -2117,10 +2263,12 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 	ptx->get_Reader().AddStats(s);
 	if (!(s.m_Inputs + s.m_Outputs) || !s.m_Kernels) {
 		// stupid compiler insists on parentheses here!
+		NodeMetrics::get().OnTxStatus(proto::TxStatus::TooSmall);
 		return proto::TxStatus::TooSmall;
 	}
 
     if ((s.m_InputsShielded > Rules::get().Shielded.MaxIns) || (s.m_OutputsShielded > Rules::get().Shielded.MaxOuts)) {
+        NodeMetrics::get().OnTxStatus(proto::TxStatus::LimitExceeded);
         return proto::TxStatus::LimitExceeded;
     }
 
@@ -2149,6 +2297,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 		{
 			LogTxStem(*ptx, "obscured by another tx. Deleting");
 			LogTxStem(*pElem->m_pValue, "Remaining");
+			NodeMetrics::get().OnTxStatus(proto::TxStatus::Obscured);
 			return proto::TxStatus::Obscured; // the new tx is reduced, drop it
 		}
 
@@ -3037,6 +3186,12 @@ void Node::Peer::OnMsg(proto::GetShieldedList&& msg)
 	Send(msgOut);
 }
 
+void Node::Processor::ResetCwp()
+{
+    m_Cwp.Reset();
+    m_mapCwpCropped.clear();
+}
+
 bool Node::Processor::BuildCwp()
 {
     if (!m_Cwp.IsEmpty())
@@ -3045,6 +3200,8 @@ bool Node::Processor::BuildCwp()
     if (m_Cursor.m_Full.m_Height < Rules::HeightGenesis)
         return false;
 
+    metrics::Timer tm(NodeMetrics::get().m_CwpBuild);
+
     struct Source
         :public Block::ChainWorkProof::ISource
     {
@@ -3056,8 +3213,24 @@ bool Node::Processor::BuildCwp()
 
         virtual void get_StateAt(Block::SystemState::Full& s, const Difficulty::Raw& d) override
         {
+            // the sampling depends on the tip, but the consecutive proofs mostly hit the same states, especially toward the end
+            auto& m = m_Proc.m_mapCwpStates; // alias
+            auto it = m.upper_bound(d);
+            if ((m.end() != it) && (it->second.m_ChainWork - it->second.m_PoW.m_Difficulty <= d))
+            {
+                s = it->second;
+                return;
+            }
+
             uint64_t rowid = m_Proc.get_DB().FindStateWorkGreater(d);
             m_Proc.get_DB().get_State(rowid, s);
+
+            const size_t nMaxStates = 0x4000;
+            if (m.size() >= nMaxStates)
+                m.clear();
+
+            m[s.m_ChainWork] = s;
+            NodeMetrics::get().m_CwpStates.Set(m.size());
         }
 
         virtual void get_Proof(Merkle::IProofBuilder& bld, Height h) override
@@ -3081,15 +3254,106 @@ void Node::Peer::OnMsg(proto::GetProofChainWork&& msg)
     proto::ProofChainWork msgOut;
 
     Processor& p = m_This.m_Processor;
-    if (!p.IsFastSync() && p.BuildCwp())
+    if (!p.IsFastSync())
     {
-        msgOut.m_Proof.m_LowerBound = msg.m_LowerBound;
-        BEAM_VERIFY(msgOut.m_Proof.Crop(p.m_Cwp));
+        const Block::ChainWorkProof* pCwp = p.get_CwpCropped(msg.m_LowerBound);
+        if (pCwp)
+            msgOut.m_Proof = *pCwp;
     }
 
     Send(msgOut);
 }
 
+const Block::ChainWorkProof* Node::Processor::get_CwpCropped(const Difficulty::Raw& lowerBound)
+{
+    if (!BuildCwp())
+        return nullptr;
+
+    auto it = m_mapCwpCropped.find(lowerBound);
+    if (m_mapCwpCropped.end() != it)
+    {
+        NodeMetrics::get().m_CwpCached.Inc();
+        return &it->second;
+    }
+
+    NodeMetrics::get().m_CwpCropped.Inc();
+
+    const size_t nMaxCropped = 0x20;
+    if (m_mapCwpCropped.size() >= nMaxCropped)
+        m_mapCwpCropped.erase(m_mapCwpCropped.begin()); // the lowest bound, i.e. the largest proof
+
+    Block::ChainWorkProof& cwp = m_mapCwpCropped[lowerBound];
+    cwp.m_LowerBound = lowerBound;
+    BEAM_VERIFY(cwp.Crop(m_Cwp));
+
+    return &cwp;
+}
+
+void Node::Peer::MaybeRequestHdrAnchors()
+{
+	if ((Flags::CwpPending & m_Flags) || !m_This.m_Cfg.m_HdrAnchorsMinGap)
+		return;
+
+	Processor& p = m_This.m_Processor;
+
+	Height h0 = std::max(p.get_DB().get_HeightBelow(m_Tip.m_Height), p.m_Cursor.m_ID.m_Height);
+	if (m_Tip.m_Height <= h0 + m_This.m_Cfg.m_HdrAnchorsMinGap)
+		return; // the gap is small, sequential download is good enough
+
+	proto::GetProofChainWork msg;
+	msg.m_LowerBound = p.m_Cursor.m_Full.m_ChainWork;
+	Send(msg);
+
+	m_Flags |= Flags::CwpPending;
+}
+
+void Node::Peer::OnMsg(proto::ProofChainWork&& msg)
+{
+	if (!(Flags::CwpPending & m_Flags))
+		ThrowUnexpected();
+
+	m_Flags &= ~Flags::CwpPending;
+
+	if (msg.m_Proof.IsEmpty())
+		return; // peer is in fast-sync mode
+
+	Block::SystemState::Full sTip;
+	if (!msg.m_Proof.IsValid(&sTip))
+		ThrowUnexpected();
+
+	// All the states in the proof are proven to belong to the same chain, and their PoW is already verified.
+	// Use a subset of them as anchors: the header ranges between them will be requested in parallel.
+	std::vector<Block::SystemState::Full> v;
+	msg.m_Proof.UnpackStates(v);
+
+	Processor& p = m_This.m_Processor;
+	Height hPrev = p.m_Cursor.m_ID.m_Height;
+	uint32_t nAnchors = 0;
+
+	for (size_t i = 0; i < v.size(); i++)
+	{
+		const Block::SystemState::Full& s = v[i];
+		bool bTip = (v.size() == i + 1);
+
+		if (!bTip && (s.m_Height < hPrev + proto::g_HdrPackMaxSize))
+			continue;
+
+		Block::SystemState::ID id;
+		if (NodeProcessor::DataStatus::Accepted == p.OnStateSilent(s, m_pInfo->m_ID.m_Key, id, true))
+			nAnchors++;
+
+		hPrev = s.m_Height;
+	}
+
+	LOG_INFO() << "Peer " << m_RemoteAddr << " Hdr anchors: " << nAnchors;
+
+	if (nAnchors)
+	{
+		m_This.RefreshCongestions();
+		m_This.UpdateSyncStatus();
+	}
+}
+
 void Node::Peer::OnMsg(proto::PeerInfoSelf&& msg)
 {
     m_Port = msg.m_Port;
@@ -57,6 +57,7 @@ struct Node
 
 		std::string m_sPathLocal;
 		NodeProcessor::Horizon m_Horizon;
+		NodeProcessor::PruneParams m_Prune;
 
 		struct Timeout {
 			uint32_t m_GetState_ms	= 1000 * 5;
@@ -67,9 +68,15 @@ struct Node
 			uint32_t m_TopPeersUpd_ms = 1000 * 60 * 10; // once in 10 minutes
 			uint32_t m_PeersUpdate_ms	= 1000; // reconsider every second
 			uint32_t m_PeersDbFlush_ms = 1000 * 60; // 1 minute
+			uint32_t m_PruneBatch_ms = 100; // pause between the background pruning passes
 		} m_Timeout;
 
 		uint32_t m_MaxConcurrentBlocksRequest = 18;
+		uint32_t m_MaxConcurrentHdrsRequest = proto::g_HdrPackMaxSize * 4; // may be split across several peers
+
+		// If the gap in headers wrt remote tip exceeds this - request the chainwork proof, and use its states as anchors,
+		// so that header ranges between them can be downloaded in parallel. Set to 0 to disable
+		uint32_t m_HdrAnchorsMinGap = proto::g_HdrPackMaxSize * 2;
 		uint32_t m_MaxPoolTransactions = 100 * 1000;
 		uint32_t m_MiningThreads = 0; // by default disabled
 
@@ -190,6 +197,8 @@ struct Node
 	uint32_t get_AcessiblePeerCount() const; // all the peers with known addresses. Including temporarily banned
     const PeerManager::AddrSet& get_AcessiblePeerAddrs() const;
 
+	void UpdateMetrics(); // sample the pool sizes and etc. into NodeMetrics
+
 	bool m_UpdatedFromPeers = false;
 	bool m_PostStartSynced = false;
 
@@ -197,6 +206,7 @@ struct Node
 	void PrintTxos();
 
 	bool DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>&, const proto::HdrPack&);
+	bool IsChainWorkConsistent(const std::vector<Block::SystemState::Full>&); // wrt already known neighbors
 
 private:
 
@@ -209,6 +219,7 @@ private:
 		void OnNewState() override;
 		void OnRolledBack() override;
 		void OnModified() override;
+		void OnPruneIncomplete() override;
 		Key::IPKdf* get_ViewerKey() override;
 		const ShieldedTxo::Viewer* get_ViewerShieldedKey() override;
 		void OnEvent(Height, const proto::Event::Base&) override;
@@ -233,6 +244,14 @@ private:
 		Block::ChainWorkProof m_Cwp; // cached
 		bool BuildCwp();
 
+		// Cropped copies of m_Cwp by the requested lower bound, reset with it. Clients that connect in a burst mostly request the same ones
+		std::map<Difficulty::Raw, Block::ChainWorkProof> m_mapCwpCropped;
+		const Block::ChainWorkProof* get_CwpCropped(const Difficulty::Raw& lowerBound);
+
+		// Active states sampled by the previous proofs, by their chainwork. Survive the tip changes, reverted ones are erased on rollback
+		std::map<Difficulty::Raw, Block::SystemState::Full> m_mapCwpStates;
+		void ResetCwp();
+
 		void GenerateProofStateStrict(Merkle::HardProof&, Height);
 		void GenerateProofShielded(Merkle::Proof&, const uintBigFor<TxoID>::Type& mmrIdx);
 
@@ -246,6 +265,10 @@ private:
 		void TryGoUpAsync();
 		void OnGoUpTimer();
 
+		bool m_bPrunePending = false;
+		io::Timer::Ptr m_pPruneTimer;
+		void OnPruneTimer();
+
 		std::deque<PeerID> m_lstInsanePeers;
 		io::AsyncEvent::Ptr m_pAsyncPeerInsane;
 		void FlushInsanePeers();
@@ -360,6 +383,7 @@ private:
 	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*);
 
 	uint8_t ValidateTx(Transaction::Context&, const Transaction&); // complete validation
+	uint8_t ValidateTxInternal(Transaction::Context&, const Transaction&);
 	void LogTx(const Transaction&, uint8_t nStatus, const Transaction::KeyType&);
 	void LogTxStem(const Transaction&, const char* szTxt);
 
@@ -466,6 +490,7 @@ private:
 			static const uint16_t Chocking		= 0x200;
 			static const uint16_t Viewer		= 0x400;
 			static const uint16_t Accepted		= 0x800;
+			static const uint16_t CwpPending	= 0x1000;
 		};
 
 		uint16_t m_Flags;
@@ -503,6 +528,7 @@ private:
 		void BroadcastBbs(Bbs::Subscription&);
 		void OnChocking();
 		void SetTxCursor(TxPool::Fluff::Element*);
+		void MaybeRequestHdrAnchors();
 		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive);
 
 		bool IsChocking(size_t nExtra = 0);
@@ -518,6 +544,7 @@ private:
 		// proto::NodeConnection
 		virtual void OnConnectedSecure() override;
 		virtual void OnDisconnect(const DisconnectReason&) override;
+		virtual void OnTraffic(uint8_t nCode, uint32_t nSize, bool bOut) override;
 		virtual void GenerateSChannelNonce(ECC::Scalar::Native&) override; // Must be overridden to support SChannel
 		// login
 		virtual void SetupLogin(proto::Login&) override;
@@ -549,6 +576,7 @@ private:
 		virtual void OnMsg(proto::GetProofAsset&&) override;
 		virtual void OnMsg(proto::GetShieldedList&&) override;
 		virtual void OnMsg(proto::GetProofChainWork&&) override;
+		virtual void OnMsg(proto::ProofChainWork&&) override;
 		virtual void OnMsg(proto::PeerInfoSelf&&) override;
 		virtual void OnMsg(proto::PeerInfo&&) override;
 		virtual void OnMsg(proto::GetExternalAddr&&) override;
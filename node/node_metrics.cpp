@@ -0,0 +1,98 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "node_metrics.h"
+#include "../core/proto.h"
+
+namespace beam {
+
+NodeMetrics& NodeMetrics::get()
+{
+	static NodeMetrics s_Metrics;
+	return s_Metrics;
+}
+
+NodeMetrics::NodeMetrics()
+{
+	metrics::Registry& r = metrics::Registry::get();
+
+	r.Add("beam_node_block_handle_us", "Block handling time, including deserialization and verification", m_BlockHandle);
+	r.Add("beam_node_block_interpret_us", "Block interpretation time (HandleValidatedBlock)", m_BlockInterpret);
+	r.Add("beam_node_db_commit_us", "DB and UTXO image commit time", m_DbCommit);
+	r.Add("beam_node_db_checkpoint_us", "WAL checkpoint time", m_DbCheckpoint);
+	r.Add("beam_node_blocks", "Handled blocks", m_BlocksOk, "status=\"ok\"");
+	r.Add("beam_node_blocks", nullptr, m_BlocksInvalid, "status=\"invalid\"");
+
+	r.Add("beam_node_prune_batch_us", "Pruning pass time", m_PruneBatch);
+	r.Add("beam_node_prune_elements", "Pruned blocks and TXOs", m_PruneElements);
+	r.Add("beam_node_prune_backlog", "Heights yet to be pruned", m_PruneBacklog);
+	r.Add("beam_node_vacuum_pages", "DB pages released by the incremental vacuum", m_VacuumPages);
+
+	r.Add("beam_node_cwp_build_us", "Chainwork proof build time", m_CwpBuild);
+	r.Add("beam_node_cwp_served", "Served chainwork proofs", m_CwpCropped, "cache=\"miss\"");
+	r.Add("beam_node_cwp_served", nullptr, m_CwpCached, "cache=\"hit\"");
+	r.Add("beam_node_cwp_states", "Sampled states kept for the chainwork proofs", m_CwpStates);
+
+	r.Add("beam_node_hdr_pack_verify_us", "Header pack decoding and PoW verification time", m_HdrPackVerify);
+
+	r.Add("beam_node_tx_validate_us", "Tx validation time", m_TxValidate);
+
+	static const struct {
+		uint8_t m_Code;
+		const char* m_szLabel;
+	} s_pTxStatus[] = {
+		{ proto::TxStatus::Unspecified, "status=\"Unspecified\"" },
+		{ proto::TxStatus::Ok, "status=\"Ok\"" },
+		{ proto::TxStatus::TooSmall, "status=\"TooSmall\"" },
+		{ proto::TxStatus::Obscured, "status=\"Obscured\"" },
+		{ proto::TxStatus::Invalid, "status=\"Invalid\"" },
+		{ proto::TxStatus::InvalidContext, "status=\"InvalidContext\"" },
+		{ proto::TxStatus::LowFee, "status=\"LowFee\"" },
+		{ proto::TxStatus::LimitExceeded, "status=\"LimitExceeded\"" },
+		{ proto::TxStatus::InvalidInput, "status=\"InvalidInput\"" },
+	};
+
+	for (size_t i = 0; i < _countof(s_pTxStatus); i++)
+		r.Add("beam_node_tx_status", i ? nullptr : "Tx admission results", m_pTxStatus[s_pTxStatus[i].m_Code], s_pTxStatus[i].m_szLabel);
+
+#define THE_MACRO(code, msg) r.Add("beam_node_msgs_in", nullptr, m_pMsgsIn[code], "msg=\"" #msg "\"");
+	BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+#define THE_MACRO(code, msg) r.Add("beam_node_bytes_in", nullptr, m_pBytesIn[code], "msg=\"" #msg "\"");
+	BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+#define THE_MACRO(code, msg) r.Add("beam_node_msgs_out", nullptr, m_pMsgsOut[code], "msg=\"" #msg "\"");
+	BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+#define THE_MACRO(code, msg) r.Add("beam_node_bytes_out", nullptr, m_pBytesOut[code], "msg=\"" #msg "\"");
+	BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
+	r.Add("beam_node_db_step_us", "SQLite statement step time", m_DbStep);
+
+	// per-query stats are labeled by the NodeDB::Query index
+	for (uint32_t i = 0; i < NodeDB::Query::count; i++)
+		r.Add("beam_node_db_query_steps", nullptr, m_pDbQueryCount[i], ("query=\"" + std::to_string(i) + '"').c_str());
+	for (uint32_t i = 0; i < NodeDB::Query::count; i++)
+		r.Add("beam_node_db_query_us", nullptr, m_pDbQueryTime[i], ("query=\"" + std::to_string(i) + '"').c_str());
+
+	r.Add("beam_node_executor_queue", "Tasks pending in the verification executor", m_ExecutorQueue);
+	r.Add("beam_node_txpool_fluff", "Transactions in the fluff pool", m_TxPoolFluff);
+	r.Add("beam_node_txpool_stem", "Transactions in the dandelion stem pool", m_TxPoolStem);
+	r.Add("beam_node_bbs_msgs", "BBS messages stored", m_BbsMsgs);
+	r.Add("beam_node_bbs_bytes", "BBS messages total size", m_BbsSize);
+	r.Add("beam_node_peers", "Connected peers", m_Peers);
+}
+
+} // namespace beam
@@ -0,0 +1,102 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "../utility/metrics.h"
+#include "db.h"
+
+namespace beam {
+
+// Process-wide node metrics. Timings are in microseconds.
+struct NodeMetrics
+{
+	// block processing
+	metrics::Histogram m_BlockHandle;
+	metrics::Histogram m_BlockInterpret;
+	metrics::Histogram m_DbCommit;
+	metrics::Histogram m_DbCheckpoint;
+	metrics::Counter m_BlocksOk;
+	metrics::Counter m_BlocksInvalid;
+
+	// pruning (see NodeProcessor::PruneOld)
+	metrics::Histogram m_PruneBatch;
+	metrics::Counter m_PruneElements;
+	metrics::Gauge m_PruneBacklog; // heights deferred to the next passes
+	metrics::Counter m_VacuumPages;
+
+	// chainwork proofs
+	metrics::Histogram m_CwpBuild;
+	metrics::Counter m_CwpCropped; // cropped for the requested lower bound
+	metrics::Counter m_CwpCached; // served as-is
+	metrics::Gauge m_CwpStates; // active states sampled by the proofs, kept for the next ones
+
+	// header packs
+	metrics::Histogram m_HdrPackVerify;
+
+	// tx admission
+	metrics::Histogram m_TxValidate;
+
+	struct TxStatus {
+		static const uint8_t s_Max = 0x20; // larger codes are accounted as Unspecified
+	};
+	metrics::Counter m_pTxStatus[TxStatus::s_Max];
+
+	// peer traffic, by message code
+	metrics::Counter m_pMsgsIn[0x100];
+	metrics::Counter m_pBytesIn[0x100];
+	metrics::Counter m_pMsgsOut[0x100];
+	metrics::Counter m_pBytesOut[0x100];
+
+	// sqlite statements
+	metrics::Histogram m_DbStep;
+	metrics::Counter m_pDbQueryCount[NodeDB::Query::count];
+	metrics::Counter m_pDbQueryTime[NodeDB::Query::count];
+
+	// sampled on demand (see Node::UpdateMetrics)
+	metrics::Gauge m_ExecutorQueue;
+	metrics::Gauge m_TxPoolFluff;
+	metrics::Gauge m_TxPoolStem;
+	metrics::Gauge m_BbsMsgs;
+	metrics::Gauge m_BbsSize;
+	metrics::Gauge m_Peers;
+
+	static NodeMetrics& get();
+
+	void OnTxStatus(uint8_t nStatus)
+	{
+		m_pTxStatus[(nStatus < TxStatus::s_Max) ? nStatus : 0].Inc();
+	}
+
+	void OnTraffic(uint8_t nCode, uint32_t nSize, bool bOut)
+	{
+		(bOut ? m_pMsgsOut : m_pMsgsIn)[nCode].Inc();
+		(bOut ? m_pBytesOut : m_pBytesIn)[nCode].Inc(nSize);
+	}
+
+	void OnDbStep(uint32_t iQuery, uint64_t us)
+	{
+		m_DbStep.Add(us);
+		if (iQuery < NodeDB::Query::count)
+		{
+			m_pDbQueryCount[iQuery].Inc();
+			m_pDbQueryTime[iQuery].Inc(us);
+		}
+	}
+
+private:
+	NodeMetrics();
+};
+
+} // namespace beam
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "processor.h"
+#include "node_metrics.h"
 #include "../core/treasury.h"
 #include "../core/shielded.h"
 #include "../core/serialization_adapters.h"
@@ -86,9 +87,15 @@ void NodeProcessor::Initialize(const char* szPath)
 
 void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 {
-	m_DB.Open(szPath);
+	m_DB.Open(szPath, sp.m_DbProfile);
 	m_DbTx.Start(m_DB);
 
+	m_bDbCheckpoint = sp.m_DbProfile.m_Wal && !sp.m_DbProfile.m_AutoCheckpoint;
+	m_DbCheckpoint_ms = sp.m_DbCheckpoint_ms;
+	m_tDbCheckpoint_ms = GetTime_ms();
+
+	InitializeStreams(szPath);
+
 	if (sp.m_CheckIntegrity)
 	{
 		LOG_INFO() << "DB integrity check...";
@@ -203,6 +210,17 @@ void NodeProcessor::InitializeUtxos(const char* sz)
 	}
 }
 
+void NodeProcessor::InitializeStreams(const char* sz)
+{
+	std::string sPath;
+	get_StreamsMappingPath(sPath, sz);
+
+	if (m_DB.StreamsImageOpen(sPath.c_str()))
+		LOG_INFO() << "Streams image found";
+	else
+		LOG_INFO() << "Streams image rebuilt";
+}
+
 bool NodeProcessor::TestDefinition()
 {
 	if ((m_Cursor.m_ID.m_Height < Rules::HeightGenesis) || (m_Cursor.m_ID.m_Height < m_SyncData.m_TxoLo))
@@ -234,9 +252,9 @@ int My_strcmpi(const char* sz1, const char* sz2)
 	return 0;
 }
 
-void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+void get_ImagePath(std::string& sPath, const char* sz, const char* szImage)
 {
-	// derive UTXO path from db path
+	// derive image path from db path
 	sPath = sz;
 
 	static const char szSufix[] = ".db";
@@ -245,7 +263,17 @@ void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
 	if ((sPath.size() >= nSufix) && !My_strcmpi(sPath.c_str() + sPath.size() - nSufix, szSufix))
 		sPath.resize(sPath.size() - nSufix);
 
-	sPath += "-utxo-image.bin";
+	sPath += szImage;
+}
+
+void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+{
+	get_ImagePath(sPath, sz, "-utxo-image.bin");
+}
+
+void NodeProcessor::get_StreamsMappingPath(std::string& sPath, const char* sz)
+{
+	get_ImagePath(sPath, sz, "-streams-image.bin");
 }
 
 bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset)
@@ -312,24 +340,16 @@ NodeProcessor::~NodeProcessor()
 
 void NodeProcessor::CommitUtxosAndDB()
 {
+	metrics::Timer tm(NodeMetrics::get().m_DbCommit);
+
 	UtxoTreeMapped::Stamp us;
 
 	bool bFlushUtxos = (m_Utxos.IsOpen() && m_Utxos.get_Hdr().m_Dirty);
 
 	if (bFlushUtxos)
-	{
-		Blob blob(us);
-
-		if (m_DB.ParamGet(NodeDB::ParamID::UtxoStamp, nullptr, &blob)) {
-			ECC::Hash::Processor() << us >> us;
-		} else {
-			ECC::GenRandom(us);
-		}
+		m_DB.ParamStampUpdate(NodeDB::ParamID::UtxoStamp, us);
 
-		m_DB.ParamSet(NodeDB::ParamID::UtxoStamp, nullptr, &blob);
-	}
-
-	m_DbTx.Commit();
+	m_DbTx.Commit(); // flushes the streams image as well
 
 	if (bFlushUtxos)
 		m_Utxos.FlushStrict(us);
@@ -352,10 +372,33 @@ void NodeProcessor::CommitDB()
 	if (m_DbTx.IsInProgress())
 	{
 		CommitUtxosAndDB();
+
+		if (m_bDbCheckpoint && (GetTime_ms() - m_tDbCheckpoint_ms >= m_DbCheckpoint_ms))
+			CheckpointInternal();
+
 		m_DbTx.Start(m_DB);
 	}
 }
 
+void NodeProcessor::CheckpointDB()
+{
+	bool bTx = m_DbTx.IsInProgress();
+	if (bTx)
+		CommitUtxosAndDB();
+
+	CheckpointInternal();
+
+	if (bTx)
+		m_DbTx.Start(m_DB);
+}
+
+void NodeProcessor::CheckpointInternal()
+{
+	metrics::Timer tm(NodeMetrics::get().m_DbCheckpoint);
+	m_DB.Checkpoint();
+	m_tDbCheckpoint_ms = GetTime_ms();
+}
+
 void NodeProcessor::InitCursor(bool bMovingUp)
 {
 	if (m_Cursor.m_Sid.m_Height >= Rules::HeightGenesis)
@@ -1402,12 +1445,11 @@ void NodeProcessor::TryGoUp()
 		bDirty = true;
 	}
 
-	if (bDirty)
-	{
-		PruneOld();
-		if (m_Cursor.m_Sid.m_Row != rowid)
-			OnNewState();
-	}
+	if (bDirty || m_bPruneBacklog)
+		PruneOld(); // also continues the deferred pruning, if any
+
+	if (bDirty && (m_Cursor.m_Sid.m_Row != rowid))
+		OnNewState();
 }
 
 void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
@@ -1446,6 +1488,7 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 
 		if (!HandleBlock(sidFwd, s, mbc))
 		{
+			NodeMetrics::get().m_BlocksInvalid.Inc();
 			bContextFail = mbc.m_bFail = true;
 
 			if (m_Cursor.m_ID.m_Height + 1 == m_SyncData.m_TxoLo)
@@ -1454,6 +1497,8 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 			break;
 		}
 
+		NodeMetrics::get().m_BlocksOk.Inc();
+
 		// Update mmr and cursor
 		if (m_Cursor.m_ID.m_Height >= Rules::HeightGenesis)
 			m_Mmr.m_States.Append(m_Cursor.m_ID.m_Hash);
@@ -1615,12 +1660,25 @@ void NodeProcessor::DeleteBlock(uint64_t row)
 	m_DB.SetStateNotFunctional(row);
 }
 
+static Height ClampPruneBatch(Height hTrg, Height hPos, Height nBatch, Height& nBacklog)
+{
+	assert(hTrg > hPos);
+	if (!nBatch || (hTrg - hPos <= nBatch))
+		return hTrg;
+
+	nBacklog += hTrg - hPos - nBatch;
+	return hPos + nBatch;
+}
+
 Height NodeProcessor::PruneOld()
 {
 	if (IsFastSync())
 		return 0; // don't remove anything while in fast-sync mode
 
-	Height hRet = 0;
+	NodeMetrics& nm = NodeMetrics::get();
+	metrics::Timer tm(nm.m_PruneBatch);
+
+	Height hRet = 0, nBacklog = 0;
 
 	if (m_Cursor.m_Sid.m_Height > m_Horizon.m_Branching + Rules::HeightGenesis - 1)
 	{
@@ -1650,14 +1708,41 @@ Height NodeProcessor::PruneOld()
 		}
 	}
 
+	// Each stage is limited to m_Prune.m_BatchHeights, so that the archive-to-pruned transition (or a horizon change)
+	// is spread across many passes instead of stalling the block processing
 	if (IsBigger2(m_Cursor.m_Sid.m_Height, m_Extra.m_Fossil, (Height) Rules::get().MaxRollback))
-		hRet += RaiseFossil(m_Cursor.m_Sid.m_Height - Rules::get().MaxRollback);
+		hRet += RaiseFossil(ClampPruneBatch(m_Cursor.m_Sid.m_Height - Rules::get().MaxRollback, m_Extra.m_Fossil, m_Prune.m_BatchHeights, nBacklog));
+
+	Height hTxos = 0;
 
 	if (IsBigger2(m_Cursor.m_Sid.m_Height, m_Extra.m_TxoLo, m_Horizon.m_Local.Lo))
-		hRet += RaiseTxoLo(m_Cursor.m_Sid.m_Height - m_Horizon.m_Local.Lo);
+		hTxos += RaiseTxoLo(ClampPruneBatch(m_Cursor.m_Sid.m_Height - m_Horizon.m_Local.Lo, m_Extra.m_TxoLo, m_Prune.m_BatchHeights, nBacklog));
 
 	if (IsBigger2(m_Cursor.m_Sid.m_Height, m_Extra.m_TxoHi, m_Horizon.m_Local.Hi))
-		hRet += RaiseTxoHi(m_Cursor.m_Sid.m_Height - m_Horizon.m_Local.Hi);
+		hTxos += RaiseTxoHi(ClampPruneBatch(m_Cursor.m_Sid.m_Height - m_Horizon.m_Local.Hi, m_Extra.m_TxoHi, m_Prune.m_BatchHeights, nBacklog));
+
+	if (hTxos)
+	{
+		m_DB.TxoLogCompact(); // release the log segments that are no more referenced
+		hRet += hTxos;
+	}
+
+	bool bIncomplete = (nBacklog > 0);
+
+	if (m_Prune.m_VacuumPages)
+	{
+		uint32_t nPages = 0;
+		if (m_DB.VacuumIncremental(m_Prune.m_VacuumPages, nPages))
+			bIncomplete = true; // more free pages remain
+		nm.m_VacuumPages.Inc(nPages);
+	}
+
+	nm.m_PruneElements.Inc(hRet);
+	nm.m_PruneBacklog.Set(nBacklog);
+
+	m_bPruneBacklog = bIncomplete;
+	if (bIncomplete)
+		OnPruneIncomplete();
 
 	return hRet;
 }
@@ -2020,6 +2105,42 @@ struct NodeProcessor::BlockInterpretCtx
 	void EnsureAssetsUsed(NodeDB&);
 };
 
+// Serializes the outputs back-to-back, and adds them to the DB in a single bulk write
+struct TxoWriter
+{
+	Serializer m_Ser;
+	std::vector<uint32_t> m_vSizes;
+	size_t m_nSize = 0; // Serializer::buffer() can't be called while it's empty
+
+	void Add(const Output& x)
+	{
+		m_Ser & x;
+
+		size_t n = m_Ser.buffer().second;
+		m_vSizes.push_back(static_cast<uint32_t>(n - m_nSize));
+		m_nSize = n;
+	}
+
+	void Flush(NodeDB& db, TxoID id0)
+	{
+		if (m_vSizes.empty())
+			return;
+
+		// the buffer is final, make the blobs only now
+		std::vector<Blob> vVals;
+		vVals.reserve(m_vSizes.size());
+
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(m_Ser.buffer().first);
+		for (size_t i = 0; i < m_vSizes.size(); p += m_vSizes[i++])
+			vVals.emplace_back(p, m_vSizes[i]);
+
+		db.TxoAdd(id0, &vVals.front(), static_cast<uint32_t>(vVals.size()));
+		m_vSizes.clear();
+		m_Ser.reset();
+		m_nSize = 0;
+	}
+};
+
 bool NodeProcessor::HandleTreasury(const Blob& blob)
 {
 	assert(!IsTreasuryHandled());
@@ -2073,21 +2194,16 @@ bool NodeProcessor::HandleTreasury(const Blob& blob)
 		}
 	}
 
-	Serializer ser;
-	TxoID id0 = 0;
+	TxoWriter wr;
 
 	for (size_t iG = 0; iG < td.m_vGroups.size(); iG++)
 	{
-		for (size_t i = 0; i < td.m_vGroups[iG].m_Data.m_vOutputs.size(); i++, id0++)
-		{
-			ser.reset();
-			ser & *td.m_vGroups[iG].m_Data.m_vOutputs[i];
-
-			SerializeBuffer sb = ser.buffer();
-			m_DB.TxoAdd(id0, Blob(sb.first, static_cast<uint32_t>(sb.second)));
-		}
+		for (size_t i = 0; i < td.m_vGroups[iG].m_Data.m_vOutputs.size(); i++)
+			wr.Add(*td.m_vGroups[iG].m_Data.m_vOutputs[i]);
 	}
 
+	wr.Flush(m_DB, 0);
+
 	return true;
 }
 
@@ -2120,6 +2236,8 @@ struct NodeProcessor::KrnFlyMmr
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemState::Full& s, MultiblockContext& mbc)
 {
+	metrics::Timer tm(NodeMetrics::get().m_BlockHandle);
+
 	ByteBuffer bbP, bbE;
 	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE, nullptr);
 
@@ -2127,6 +2245,7 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 	Block::Body& block = pShared->m_Body;
 
 	try {
+		Arena::Scope scope; // the block elements are released together with the block
 		Deserializer der;
 		der.reset(bbP);
 		der & Cast::Down<Block::BodyBase>(block);
@@ -2195,7 +2314,11 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 
 	bic.m_StoreShieldedOutput = true;
 
-	bool bOk = HandleValidatedBlock(block, bic);
+	bool bOk;
+	{
+		metrics::Timer tmInterpret(NodeMetrics::get().m_BlockInterpret);
+		bOk = HandleValidatedBlock(block, bic);
+	}
 	if (!bOk)
 	{
 		assert(bFirstTime);
@@ -2255,7 +2378,7 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 			if (!m_DB.get_Prev(row))
 				OnCorrupted();
 
-			AdjustOffset(offsAcc, row, true);
+			AdjustOffset(m_DB, offsAcc, row, true);
 		}
 
 		Blob blobExtra(offsAcc.m_Value);
@@ -2265,15 +2388,21 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 		std::vector<NodeDB::StateInput> v;
 		v.reserve(block.m_vInputs.size());
 
+		std::vector<TxoID> vSpent;
+		vSpent.reserve(block.m_vInputs.size());
+
 		for (size_t i = 0; i < block.m_vInputs.size(); i++)
 		{
 			const Input& x = *block.m_vInputs[i];
-			m_DB.TxoSetSpent(x.m_Internal.m_ID, sid.m_Height);
+			vSpent.push_back(x.m_Internal.m_ID);
 			v.emplace_back().Set(x.m_Internal.m_ID, x.m_Commitment);
 		}
 
 		if (!v.empty())
+		{
+			m_DB.TxoSetSpent(&vSpent.front(), static_cast<uint32_t>(vSpent.size()), sid.m_Height);
 			m_DB.set_StateInputs(sid.m_Row, &v.front(), v.size());
+		}
 
 		// recognize all
 		for (size_t i = 0; i < block.m_vInputs.size(); i++)
@@ -2299,20 +2428,14 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 			nOuts; // supporess unused var warning in release
 		}
 
-		Serializer ser;
+		TxoWriter wr;
 		bbP.clear();
-		ser.swap_buf(bbP);
+		wr.m_Ser.swap_buf(bbP);
 
 		for (size_t i = 0; i < block.m_vOutputs.size(); i++)
-		{
-			const Output& x = *block.m_vOutputs[i];
-
-			ser.reset();
-			ser & x;
+			wr.Add(*block.m_vOutputs[i]);
 
-			SerializeBuffer sb = ser.buffer();
-			m_DB.TxoAdd(id0++, Blob(sb.first, static_cast<uint32_t>(sb.second)));
-		}
+		wr.Flush(m_DB, id0);
 
 		m_RecentStates.Push(sid.m_Row, s);
 	}
@@ -2320,10 +2443,10 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemS
 	return bOk;
 }
 
-void NodeProcessor::AdjustOffset(ECC::Scalar& offs, uint64_t rowid, bool bAdd)
+void NodeProcessor::AdjustOffset(NodeDB& db, ECC::Scalar& offs, uint64_t rowid, bool bAdd)
 {
 	ECC::Scalar offsPrev;
-	if (!m_DB.get_StateExtra(rowid, offsPrev))
+	if (!db.get_StateExtra(rowid, offsPrev))
 		OnCorrupted();
 
 	ECC::Scalar::Native s(offsPrev);
@@ -3539,14 +3662,14 @@ bool NodeProcessor::ValidateUniqueNoDup(BlockInterpretCtx& bic, const Blob& key)
 	return true;
 }
 
-void NodeProcessor::ToInputWithMaturity(Input& inp, TxoID id)
+void NodeProcessor::ToInputWithMaturity(NodeDB& db, Input& inp, TxoID id)
 {
 	// awkward and relatively used, but this is not used frequently.
 	// NodeDB::StateInput doesn't contain the maturity of the spent UTXO. Hence we reconstruct it
 	// We find the original UTXO height, and then decode the UTXO body, and check its additional maturity factors (coinbase, incubation)
 
 	NodeDB::WalkerTxo wlk;
-	m_DB.TxoGetValue(wlk, id);
+	db.TxoGetValue(wlk, id);
 
 	uint8_t pNaked[s_TxoNakedMax];
 	Blob val = wlk.m_Value;
@@ -3562,7 +3685,7 @@ void NodeProcessor::ToInputWithMaturity(Input& inp, TxoID id)
 	inp.m_Internal.m_ID = id;
 
 	NodeDB::StateID sidPrev;
-	m_DB.FindStateByTxoID(sidPrev, id); // relatively heavy operation: search for the original txo height
+	db.FindStateByTxoID(sidPrev, id); // relatively heavy operation: search for the original txo height
 
 	inp.m_Internal.m_Maturity = outp.get_MinMaturity(sidPrev.m_Height);
 }
@@ -3578,11 +3701,15 @@ void NodeProcessor::RollbackTo(Height h)
 	TxoID id0 = get_TxosBefore(h + 1);
 
 	// undo inputs
+	std::vector<TxoID> vUnspent;
+
 	for (NodeDB::StateID sid = m_Cursor.m_Sid; sid.m_Height > h; )
 	{
 		std::vector<NodeDB::StateInput> v;
 		m_DB.get_StateInputs(sid.m_Row, v);
 
+		vUnspent.clear();
+
 		BlockInterpretCtx bic(sid.m_Height, false);
 		for (size_t i = 0; i < v.size(); i++)
 		{
@@ -3591,14 +3718,17 @@ void NodeProcessor::RollbackTo(Height h)
 				continue; // created and spent within this range - skip it
 
 			Input inp;
-			ToInputWithMaturity(inp, id);
+			ToInputWithMaturity(m_DB, inp, id);
 
 			if (!HandleBlockElement(inp, bic))
 				OnCorrupted();
 
-			m_DB.TxoSetSpent(id, MaxHeight);
+			vUnspent.push_back(id);
 		}
 
+		if (!vUnspent.empty())
+			m_DB.TxoSetSpent(&vUnspent.front(), static_cast<uint32_t>(vUnspent.size()), MaxHeight);
+
 		m_DB.set_StateInputs(sid.m_Row, nullptr, 0);
 
 		if (!m_DB.get_Prev(sid))
@@ -3638,6 +3768,7 @@ void NodeProcessor::RollbackTo(Height h)
 		bbR.clear();
 		m_DB.GetStateBlock(m_Cursor.m_Sid.m_Row, nullptr, &bbE, &bbR);
 
+		Arena::Scope scope;
 		Deserializer der;
 		der.reset(bbE);
 		der & Cast::Down<TxVectors::Eternal>(txve);
@@ -4415,9 +4546,19 @@ bool NodeProcessor::ValidateAndSummarize(TxBase::Context& ctx, const TxBase& txb
 }
 
 bool NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::StateID& sid)
+{
+	return ExtractBlockWithExtra(BlockSource(*this), block, sid);
+}
+
+bool NodeProcessor::ExtractBlockWithExtra(NodeDB& db, Block::Body& block, const NodeDB::StateID& sid)
+{
+	return ExtractBlockWithExtra(BlockSource(db), block, sid);
+}
+
+bool NodeProcessor::ExtractBlockWithExtra(const BlockSource& src, Block::Body& block, const NodeDB::StateID& sid)
 {
 	ByteBuffer bbE;
-	if (!GetBlockInternal(sid, &bbE, nullptr, 0, 0, 0, false, &block))
+	if (!GetBlockInternal(src, sid, &bbE, nullptr, 0, 0, 0, false, &block))
 		return false;
 
 	Deserializer der;
@@ -4428,7 +4569,7 @@ bool NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::Stat
 	for (size_t i = 0; i < block.m_vInputs.size(); i++)
 	{
 		Input& inp = *block.m_vInputs[i];
-		ToInputWithMaturity(inp, inp.m_Internal.m_ID);
+		ToInputWithMaturity(src.m_DB, inp, inp.m_Internal.m_ID);
 	}
 
 	return true;
@@ -4507,6 +4648,7 @@ bool NodeProcessor::EnumKernels(IKrnWalker& wlkKrn, const HeightRange& hr)
 		uint64_t row = FindActiveAtStrict(wlkKrn.m_Height);
 		m_DB.GetStateBlock(row, nullptr, &bbE, nullptr);
 
+		Arena::Scope scope;
 		Deserializer der;
 		der.reset(bbE);
 		der & txve;
@@ -4606,11 +4748,42 @@ void NodeProcessor::InitializeUtxos()
 
 bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive)
 {
-	return GetBlockInternal(sid, pEthernal, pPerishable, h0, hLo1, hHi1, bActive, nullptr);
+	return GetBlockInternal(BlockSource(*this), sid, pEthernal, pPerishable, h0, hLo1, hHi1, bActive, nullptr);
 }
 
-bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive, Block::Body* pBody)
+NodeProcessor::BlockSource::BlockSource(NodeProcessor& p)
+	:m_DB(p.m_DB)
+	,m_TxosTreasury(p.m_Extra.m_TxosTreasury)
+	,m_TxoLo(p.m_Extra.m_TxoLo)
+	,m_TxoHi(p.m_Extra.m_TxoHi)
+	,m_hMax(p.IsFastSync() ? p.m_Cursor.m_ID.m_Height : MaxHeight)
 {
+}
+
+NodeProcessor::BlockSource::BlockSource(NodeDB& db)
+	:m_DB(db)
+{
+	// same as the processor loads them on init
+	if (Rules::get().TreasuryChecksum == Zero)
+		m_TxosTreasury = 1;
+	else
+	{
+		m_TxosTreasury = 0;
+		db.ParamGet(NodeDB::ParamID::Treasury, &m_TxosTreasury, nullptr, nullptr);
+	}
+
+	m_TxoLo = db.ParamIntGetDef(NodeDB::ParamID::HeightTxoLo, Rules::HeightGenesis - 1);
+	m_TxoHi = db.ParamIntGetDef(NodeDB::ParamID::HeightTxoHi, Rules::HeightGenesis - 1);
+
+	NodeDB::StateID sid;
+	db.get_Cursor(sid);
+	m_hMax = sid.m_Height; // active states are never above it
+}
+
+bool NodeProcessor::GetBlockInternal(const BlockSource& src, const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive, Block::Body* pBody)
+{
+	NodeDB& db = src.m_DB; // alias
+
 	// h0 - current peer Height
 	// hLo1 - HorizonLo that peer needs after the sync
 	// hHi1 - HorizonL1 that peer needs after the sync
@@ -4629,48 +4802,55 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 
 	std::setmax(hHi1, sid.m_Height); // valid block can't spend its own output. Hence this means full block should be transferred
 
-	if (m_Extra.m_TxoHi > hHi1)
+	if (src.m_TxoHi > hHi1)
 		return false;
 
 	std::setmax(hLo1, sid.m_Height - 1);
-	if (m_Extra.m_TxoLo > hLo1)
+	if (src.m_TxoLo > hLo1)
 		return false;
 
-	if ((h0 >= Rules::HeightGenesis) && (m_Extra.m_TxoLo > sid.m_Height))
+	if ((h0 >= Rules::HeightGenesis) && (src.m_TxoLo > sid.m_Height))
 		return false; // we don't have any info for the range [Rules::HeightGenesis, h0].
 
 	// in case we're during sync - make sure we don't return non-full blocks as-is
-	if (IsFastSync() && (sid.m_Height > m_Cursor.m_ID.m_Height))
+	if (sid.m_Height > src.m_hMax)
 		return false;
 
 	bool bFullBlock = (sid.m_Height >= hHi1) && (sid.m_Height > hLo1) && !pBody;
-	m_DB.GetStateBlock(sid.m_Row, bFullBlock ? pPerishable : nullptr, pEthernal, nullptr);
+	db.GetStateBlock(sid.m_Row, bFullBlock ? pPerishable : nullptr, pEthernal, nullptr);
 
 	if (!pBody && !(pPerishable && pPerishable->empty()))
 		return true;
 
 	// re-create it from Txos
-	if (!bActive && !(m_DB.GetStateFlags(sid.m_Row) & NodeDB::StateFlags::Active))
+	if (!bActive && !(db.GetStateFlags(sid.m_Row) & NodeDB::StateFlags::Active))
 		return false; // only active states are supported
 
-	TxoID idInpCut = get_TxosBefore(h0 + 1);
+	TxoID idInpCut = src.m_TxosTreasury; // TXOs before h0 + 1
+	if (h0 >= Rules::HeightGenesis)
+	{
+		idInpCut = db.get_StateTxos(db.FindActiveStateStrict(h0));
+		if (MaxHeight == idInpCut)
+			OnCorrupted();
+	}
+
 	TxoID id0;
 
-	TxoID id1 = m_DB.get_StateTxos(sid.m_Row);
+	TxoID id1 = db.get_StateTxos(sid.m_Row);
 
 	ByteBuffer bbBlob;
 	TxBase txb;
-	if (!m_DB.get_StateExtra(sid.m_Row, txb.m_Offset))
+	if (!db.get_StateExtra(sid.m_Row, txb.m_Offset))
 		OnCorrupted();
 
 	uint64_t rowid = sid.m_Row;
-	if (m_DB.get_Prev(rowid))
+	if (db.get_Prev(rowid))
 	{
-		AdjustOffset(txb.m_Offset, rowid, false);
-		id0 = m_DB.get_StateTxos(rowid);
+		AdjustOffset(db, txb.m_Offset, rowid, false);
+		id0 = db.get_StateTxos(rowid);
 	}
 	else
-		id0 = m_Extra.m_TxosTreasury;
+		id0 = src.m_TxosTreasury;
 
 	Serializer ser;
 	if (pBody)
@@ -4682,7 +4862,7 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 
 	// inputs
 	std::vector<NodeDB::StateInput> v;
-	m_DB.get_StateInputs(sid.m_Row, v);
+	db.get_StateInputs(sid.m_Row, v);
 
 	for (uint32_t iCycle = 0; ; iCycle++)
 	{
@@ -4735,7 +4915,7 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 		pBody->m_vOutputs.reserve(static_cast<size_t>(id1 - id0 - 1)); // num of original outputs
 
 	NodeDB::WalkerTxo wlk;
-	for (m_DB.EnumTxos(wlk, id0); wlk.MoveNext(); )
+	for (db.EnumTxos(wlk, id0); wlk.MoveNext(); )
 	{
 		if (wlk.m_ID >= id1)
 			break;
@@ -45,7 +45,6 @@ class NodeProcessor
 	struct MultiAssetContext;
 
 	void RollbackTo(Height);
-	Height PruneOld();
 	Height RaiseFossil(Height);
 	Height RaiseTxoLo(Height);
 	Height RaiseTxoHi(Height);
@@ -98,13 +97,14 @@ class NodeProcessor
 	static void TxoToNaked(uint8_t* pBuf, Blob&);
 	static bool TxoIsNaked(const Blob&);
 
-	void ToInputWithMaturity(Input&, TxoID);
+	static void ToInputWithMaturity(NodeDB&, Input&, TxoID);
 
 	TxoID get_TxosBefore(Height);
-	void AdjustOffset(ECC::Scalar&, uint64_t rowid, bool bAdd);
+	static void AdjustOffset(NodeDB&, ECC::Scalar&, uint64_t rowid, bool bAdd);
 
 	void InitCursor(bool bMovingUp);
 	bool InitUtxoMapping(const char*, bool bForceReset);
+	void InitializeStreams(const char*);
 	void InitializeUtxos(const char*);
 	static void OnCorrupted();
 
@@ -169,12 +169,15 @@ public:
 		bool m_Vacuum = false;
 		bool m_ResetSelfID = false;
 		bool m_EraseSelfID = false;
+		NodeDB::Profile m_DbProfile;
+		uint32_t m_DbCheckpoint_ms = 1000 * 10; // WAL without the auto-checkpoint: min interval between the checkpoints, run after the commits
 	};
 
 	void Initialize(const char* szPath);
 	void Initialize(const char* szPath, const StartParams&);
 
 	static void get_UtxoMappingPath(std::string&, const char*);
+	static void get_StreamsMappingPath(std::string&, const char*);
 
 	NodeProcessor();
 	virtual ~NodeProcessor();
@@ -201,6 +204,17 @@ public:
 
 	} m_Horizon;
 
+	struct PruneParams
+	{
+		// Max heights processed per pass by each stage (fossil, TxoLo, TxoHi). The rest is deferred to the next passes,
+		// see OnPruneIncomplete. 0 - unlimited
+		Height m_BatchHeights = 500;
+		uint32_t m_VacuumPages = 1024; // free pages returned by the incremental vacuum per pass. 0 - disabled
+
+	} m_Prune;
+
+	Height PruneOld(); // a single bounded pass. Returns the num of pruned elements
+
 	struct Cursor
 	{
 		// frequently used data
@@ -241,6 +255,8 @@ public:
 	void LogSyncData();
 
 	bool ExtractBlockWithExtra(Block::Body&, const NodeDB::StateID&);
+	// Same for a connection used without the processor (see NodeDB::OpenReader). Sees only the committed data, the horizons are read from the DB
+	static bool ExtractBlockWithExtra(NodeDB&, Block::Body&, const NodeDB::StateID&);
 
 	struct DataStatus {
 		enum Enum {
@@ -306,6 +322,7 @@ public:
 	Height get_ProofKernel(Merkle::Proof&, TxKernel::Ptr*, const Merkle::Hash& idKrn);
 
 	void CommitDB();
+	void CheckpointDB(); // commits, and runs the WAL checkpoint now. Otherwise CommitDB runs it periodically (see StartParams::m_DbCheckpoint_ms)
 
 	void EnumCongestions();
 	const uint64_t* get_CachedRows(const NodeDB::StateID&, Height nCountExtra); // retval valid till next call to this func, or to EnumCongestions()
@@ -323,6 +340,7 @@ public:
 	virtual void OnNewState() {}
 	virtual void OnRolledBack() {}
 	virtual void OnModified() {}
+	virtual void OnPruneIncomplete() {} // PruneOld should be called again (preferably not immediately)
 	virtual void InitializeUtxosProgress(uint64_t done, uint64_t total) {}
 
 	struct MyExecutor
@@ -506,7 +524,29 @@ private:
 	size_t GenerateNewBlockInternal(BlockContext&, BlockInterpretCtx&);
 	void GenerateNewHdr(BlockContext&);
 	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bAlreadyChecked);
-	bool GetBlockInternal(const NodeDB::StateID&, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive, Block::Body*);
+
+	// What's needed to re-create the blocks, besides the DB
+	struct BlockSource
+	{
+		NodeDB& m_DB;
+		TxoID m_TxosTreasury;
+		Height m_TxoLo;
+		Height m_TxoHi;
+		Height m_hMax; // blocks above may be incomplete (fast sync)
+
+		BlockSource(NodeProcessor&);
+		BlockSource(NodeDB&);
+	};
+
+	static bool GetBlockInternal(const BlockSource&, const NodeDB::StateID&, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive, Block::Body*);
+	static bool ExtractBlockWithExtra(const BlockSource&, Block::Body&, const NodeDB::StateID&);
+
+	bool m_bDbCheckpoint = false; // WAL with the manual checkpoints, see StartParams::m_DbCheckpoint_ms
+	uint32_t m_DbCheckpoint_ms = 0;
+	uint32_t m_tDbCheckpoint_ms = 0;
+	void CheckpointInternal();
+
+	bool m_bPruneBacklog = false; // the last PruneOld pass was incomplete, TryGoUp continues it
 
 	template <typename TKey, typename TEvt>
 	bool FindEvent(const TKey&, TEvt&);
@@ -17,6 +17,7 @@
 #include "../node.h"
 #include "../db.h"
 #include "../processor.h"
+#include "../node_metrics.h"
 #include "../../core/fly_client.h"
 #include "../../core/serialization_adapters.h"
 #include "../../core/treasury.h"
@@ -587,6 +588,132 @@ namespace beam
 		db.ShieldedResize(1, nShielded);
 		db.ShieldedResize(0, 1);
 
+		// Txo log
+		std::map<TxoID, ByteBuffer> mapTxos;
+
+		auto fnVerifyTxos = [&db, &mapTxos]()
+		{
+			NodeDB::WalkerTxo wlk;
+			auto it = mapTxos.begin();
+			for (db.EnumTxos(wlk, 0); wlk.MoveNext(); it++)
+			{
+				verify_test(it != mapTxos.end());
+				verify_test(wlk.m_ID == it->first);
+				verify_test(wlk.m_Value.n == it->second.size());
+				verify_test(!memcmp(wlk.m_Value.p, &it->second.front(), wlk.m_Value.n));
+			}
+			verify_test(it == mapTxos.end());
+
+			NodeDB::TxoLogStats st;
+			db.get_TxoLogStats(st);
+
+			uint64_t nLive = 0;
+			for (it = mapTxos.begin(); mapTxos.end() != it; it++)
+				if (it->second.size() > 100) // otherwise inline
+					nLive += it->second.size();
+
+			verify_test(st.m_Live == nLive);
+			return st;
+		};
+
+		const TxoID nTxos = 8000;
+		std::vector<Blob> vBatch;
+
+		for (TxoID id = 1; id <= nTxos; id++)
+		{
+			ByteBuffer& buf = mapTxos[id];
+			buf.resize((id % 10) ? (600 + id % 200) : 20); // some are small enough to be stored inline
+			for (size_t i = 0; i < buf.size(); i++)
+				buf[i] = static_cast<uint8_t>(id + i);
+
+			if (id <= nTxos / 2)
+				db.TxoAdd(id, buf);
+			else
+			{
+				// the rest in batches of varying sizes, some of them not multiple of the statement size
+				vBatch.push_back(buf);
+				if ((vBatch.size() == id % 97) || (nTxos == id))
+				{
+					db.TxoAdd(id + 1 - vBatch.size(), &vBatch.front(), static_cast<uint32_t>(vBatch.size()));
+					vBatch.clear();
+				}
+			}
+		}
+		fnVerifyTxos();
+
+		{
+			std::vector<TxoID> vSpent;
+			for (TxoID id = nTxos; id > 1000; id -= 3)
+				vSpent.push_back(id); // descending, should be sorted internally
+
+			db.TxoSetSpent(&vSpent.front(), static_cast<uint32_t>(vSpent.size()), 17);
+
+			NodeDB::WalkerTxo wlk;
+			for (db.EnumTxos(wlk, 0); wlk.MoveNext(); )
+				verify_test(wlk.m_SpendHeight == (((wlk.m_ID > 1000) && !((nTxos - wlk.m_ID) % 3)) ? 17 : MaxHeight));
+
+			db.TxoSetSpent(&vSpent.front(), static_cast<uint32_t>(vSpent.size()), MaxHeight);
+
+			for (db.EnumTxos(wlk, 0); wlk.MoveNext(); )
+				verify_test(MaxHeight == wlk.m_SpendHeight);
+		}
+
+		auto fnReleaseTxos = [&db, &mapTxos](TxoID id0, TxoID id1, bool bLeaveSome)
+		{
+			for (TxoID id = id0; id < id1; id++)
+			{
+				if (bLeaveSome && (1 == id % 100))
+					continue;
+
+				if (id % 3)
+				{
+					db.TxoDel(id);
+					mapTxos.erase(id);
+				}
+				else
+				{
+					ByteBuffer& buf = mapTxos[id];
+					buf.resize(33); // as if naked
+					db.TxoSetValue(id, buf);
+				}
+			}
+		};
+
+		NodeDB::TxoLogStats st0 = fnVerifyTxos();
+		verify_test(st0.m_Segments >= 4);
+
+		// release the middle of the log. The dense head must not block the erasure of the dead segments behind it
+		fnReleaseTxos(2000, 6000, false);
+		NodeDB::TxoLogStats st1 = fnVerifyTxos();
+		verify_test(st1.m_Segments == st0.m_Segments);
+
+		db.TxoLogCompact();
+		st1 = fnVerifyTxos();
+		verify_test(st1.m_Segments < st0.m_Segments);
+
+		// leave the head sparse, it should be relocated and erased
+		fnReleaseTxos(1, 2000, true);
+		NodeDB::TxoLogStats st2 = fnVerifyTxos();
+		verify_test(st2.m_Segments == st1.m_Segments);
+		verify_test(st2.m_Size == st1.m_Size);
+
+		db.TxoLogCompact();
+		st2 = fnVerifyTxos();
+		verify_test(st2.m_Size > st1.m_Size); // relocated
+		verify_test(st2.m_Segments <= st1.m_Segments);
+
+		db.TxoDelFrom(7000);
+		mapTxos.erase(mapTxos.find(7000), mapTxos.end());
+		fnVerifyTxos();
+
+		db.TxoLogCompact();
+		fnVerifyTxos();
+
+		db.TxoDelFrom(1);
+		mapTxos.clear();
+		st2 = fnVerifyTxos();
+		verify_test(!st2.m_Segments && !st2.m_Size);
+
 		ECC::uintBig k1 = 223U;
 		Blob val(nullptr, 0);
 
@@ -696,7 +823,93 @@ namespace beam
 		{
 			NodeDB db;
 			db.Open(g_sz); // test to open already-existing DB
+			verify_test(db.IsVacuumIncremental());
+		}
+
+		{
+			DeleteFile(g_sz2);
+
+			NodeDB::Profile prof;
+			prof.SetWal();
+
+			NodeDB db;
+			db.Open(g_sz2, prof); // new DB in WAL mode
+			verify_test(db.IsVacuumIncremental());
+		}
+		DeleteFile(g_sz2);
+
+		// streams image
+		std::string sPath;
+		NodeProcessor::get_StreamsMappingPath(sPath, g_sz);
+		DeleteFile(sPath.c_str());
+
+		const TxoID nShielded = 16 * 1024 * 3 + 5;
+		const TxoID nPos = 16 * 1024 * 2 - 2; // crosses the blob boundary
+
+		StoragePts pts;
+		pts.Init();
+
+		{
+			NodeDB db;
+			db.Open(g_sz);
+			verify_test(!db.StreamsImageOpen(sPath.c_str())); // created
+
+			NodeDB::Transaction tr(db);
+			db.ShieldedResize(nShielded, 0);
+			db.ShieldedWrite(nPos, pts.m_pArr, _countof(pts.m_pArr));
+			tr.Commit();
+		}
+
+		{
+			NodeDB db;
+			db.Open(g_sz);
+			verify_test(db.StreamsImageOpen(sPath.c_str())); // must be reused
+
+			StoragePts pts2;
+			db.ShieldedRead(nPos, pts2.m_pArr, _countof(pts2.m_pArr));
+			verify_test(pts2.IsValid(0, _countof(pts2.m_pArr), 0));
+
+			// modify and roll back. The image must be discarded
+			NodeDB::Transaction tr(db);
+			ZeroObject(pts2.m_pArr);
+			db.ShieldedWrite(nPos, pts2.m_pArr, _countof(pts2.m_pArr));
+			tr.Rollback();
+
+			db.ShieldedRead(nPos, pts2.m_pArr, _countof(pts2.m_pArr));
+			verify_test(pts2.IsValid(0, _countof(pts2.m_pArr), 0));
+		}
+
+		{
+			NodeDB db;
+			db.Open(g_sz);
+			verify_test(!db.StreamsImageOpen(sPath.c_str())); // rebuilt
+
+			StoragePts pts2;
+			db.ShieldedRead(nPos, pts2.m_pArr, _countof(pts2.m_pArr));
+			verify_test(pts2.IsValid(0, _countof(pts2.m_pArr), 0));
+
+			NodeDB::Transaction tr(db);
+			db.ShieldedResize(0, nShielded);
+			tr.Commit();
 		}
+
+		{
+			// modified without the image
+			NodeDB db;
+			db.Open(g_sz);
+
+			NodeDB::Transaction tr(db);
+			db.ShieldedResize(1, 0);
+			tr.Commit();
+
+			verify_test(!db.StreamsImageOpen(sPath.c_str()));
+
+			tr.Start(db);
+			db.ShieldedResize(0, 1);
+			tr.Commit();
+		}
+
+		DeleteFile(sPath.c_str());
 	}
 
 	struct MiniWallet
@@ -1000,6 +1213,141 @@ namespace beam
 
 	}
 
+	void TestNodeProcessorPrune()
+	{
+		// archive -> pruned transition, in bounded passes
+		struct MyNodeProcessor
+			:public NodeProcessor
+		{
+			uint32_t m_nIncomplete = 0;
+			virtual void OnPruneIncomplete() override { m_nIncomplete++; }
+		};
+
+		MyNodeProcessor np;
+		np.m_Horizon.m_Branching = 12;
+		np.m_Horizon.m_Sync.Hi = 12;
+		np.m_Horizon.m_Sync.Lo = 15;
+		np.m_Horizon.m_Local = np.m_Horizon.m_Sync;
+		np.m_Prune.m_BatchHeights = 7;
+
+		np.Initialize(g_sz); // performs the 1st pass, and TryGoUp continues it
+		const Height h = np.m_Cursor.m_ID.m_Height;
+		verify_test(h > 50);
+
+		verify_test(np.m_nIncomplete == 2);
+		verify_test(np.m_Extra.m_TxoLo == 14);
+
+		np.TryGoUp(); // no new blocks, yet the deferred pruning must go on
+		verify_test(np.m_nIncomplete == 3);
+		verify_test(np.m_Extra.m_TxoLo == 21);
+
+		uint32_t nPasses = 3;
+		for (; np.m_nIncomplete; nPasses++)
+		{
+			verify_test(nPasses < 100);
+			np.m_nIncomplete = 0;
+			np.PruneOld();
+		}
+
+		verify_test(nPasses >= (h - 12) / 7);
+		verify_test(np.m_Extra.m_Fossil == h - Rules::get().MaxRollback);
+		verify_test(np.m_Extra.m_TxoHi == h - 12);
+		verify_test(np.m_Extra.m_TxoLo == h - 15);
+
+		verify_test(!np.PruneOld()); // nothing left
+		verify_test(!np.m_nIncomplete);
+	}
+
+	void TestNodeProcessorProfiles(const std::vector<BlockPlus::Ptr>& blockChain)
+	{
+		static const char* s_pProfiles[] = { "default", "wal", "wal_fast" };
+
+		for (size_t iProf = 0; iProf < _countof(s_pProfiles); iProf++)
+		{
+			DeleteFile(g_sz);
+
+			NodeProcessor::StartParams sp;
+			verify_test(sp.m_DbProfile.Set(s_pProfiles[iProf]));
+			sp.m_DbCheckpoint_ms = 0; // on every commit
+
+			NodeProcessor np;
+			np.Initialize(g_sz, sp);
+			verify_test(np.get_DB().IsVacuumIncremental()); // must be set for the new DB in any journal mode
+			np.OnTreasury(g_Treasury);
+
+			uint64_t nCheckpoints = NodeMetrics::get().m_DbCheckpoint.get_Count();
+
+			PeerID peer;
+			ZeroObject(peer);
+
+			for (size_t i = 0; i < blockChain.size(); i++)
+			{
+				const BlockPlus& bp = *blockChain[i];
+				Block::SystemState::ID id;
+				bp.m_Hdr.get_ID(id);
+
+				np.OnState(bp.m_Hdr, peer);
+				np.OnBlock(id, bp.m_BodyP, bp.m_BodyE, peer);
+				np.TryGoUp();
+				np.CommitDB();
+			}
+
+			verify_test(np.m_Cursor.m_ID.m_Height == blockChain.size());
+
+			// the processor checkpoints the WAL by itself, without the node
+			nCheckpoints = NodeMetrics::get().m_DbCheckpoint.get_Count() - nCheckpoints;
+			verify_test(nCheckpoints == (sp.m_DbProfile.m_Wal ? blockChain.size() : 0));
+
+			if (sp.m_DbProfile.m_Wal)
+			{
+				// no other writer, even though the locking is normal
+				bool bLocked = false;
+				try {
+					NodeDB db2;
+					db2.Open(g_sz, sp.m_DbProfile);
+				}
+				catch (const CorruptionException&) {
+					bLocked = true;
+				}
+				verify_test(bLocked);
+
+				// the secondary reader sees the committed state, and doesn't block the writer
+				NodeDB dbR;
+				dbR.OpenReader(g_sz);
+
+				NodeDB::StateID sid;
+				dbR.get_Cursor(sid);
+				verify_test(sid.m_Height == np.m_Cursor.m_Sid.m_Height);
+
+				// the blocks it re-creates are the same as the processor's
+				for (Height h = Rules::HeightGenesis; h <= sid.m_Height; h++)
+				{
+					NodeDB::StateID sidBlock;
+					sidBlock.m_Height = h;
+					sidBlock.m_Row = dbR.FindActiveStateStrict(h);
+
+					Block::Body block, blockR;
+					verify_test(np.ExtractBlockWithExtra(block, sidBlock));
+					verify_test(NodeProcessor::ExtractBlockWithExtra(dbR, blockR, sidBlock));
+
+					Serializer ser, serR;
+					ser & block;
+					serR & blockR;
+					verify_test(ser.buffer().second && (ser.buffer().second == serR.buffer().second));
+					verify_test(!memcmp(ser.buffer().first, serR.buffer().first, ser.buffer().second));
+
+					for (size_t i = 0; i < blockR.m_vInputs.size(); i++)
+						verify_test(blockR.m_vInputs[i]->m_Internal.m_Maturity == block.m_vInputs[i]->m_Internal.m_Maturity);
+				}
+
+				np.get_DB().ParamIntSet(NodeDB::ParamID::LastRecoveryHeight, 7); // not committed yet
+				verify_test(!dbR.ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight));
+
+				np.CheckpointDB();
+				verify_test(dbR.ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight) == 7);
+			}
+		}
+	}
 
 	void TestNodeProcessor2(std::vector<BlockPlus::Ptr>& blockChain)
 	{
@@ -1578,6 +1926,221 @@ namespace beam
 		DeleteFile(g_sz3);
 	}
 
+	void TestNodeHdrAnchors(const std::vector<BlockPlus::Ptr>& blockChain, uint32_t nMinGap)
+	{
+		// Node1 (empty) syncs from Node0. It should request the chainwork proof for the header anchors only if the gap exceeds nMinGap
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node, node2;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+
+		ECC::SetRandom(node);
+		node.Initialize();
+
+		PeerID peer;
+		ZeroObject(peer);
+
+		for (size_t i = 0; i < blockChain.size(); i++)
+		{
+			const BlockPlus& bp = *blockChain[i];
+
+			Block::SystemState::ID id;
+			bp.m_Hdr.get_ID(id);
+
+			node.get_Processor().OnState(bp.m_Hdr, peer);
+			node.get_Processor().OnBlock(id, bp.m_BodyP, bp.m_BodyE, peer);
+			node.get_Processor().TryGoUp();
+		}
+
+		verify_test(node.get_Processor().m_Cursor.m_ID.m_Height == blockChain.size());
+
+		node2.m_Cfg.m_sPathLocal = g_sz2;
+		node2.m_Cfg.m_Treasury = g_Treasury;
+		node2.m_Cfg.m_HdrAnchorsMinGap = nMinGap;
+		node2.m_Cfg.m_Connect.resize(1);
+		node2.m_Cfg.m_Connect[0].resolve("127.0.0.1");
+		node2.m_Cfg.m_Connect[0].port(g_Port);
+
+		ECC::SetRandom(node2);
+		node2.Initialize();
+
+		const NodeMetrics& nm = NodeMetrics::get();
+		uint64_t nCwp0 = nm.m_CwpCached.get() + nm.m_CwpCropped.get();
+
+		uint32_t nCycles = 0;
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(100, true, [&]() {
+			if ((node2.get_Processor().m_Cursor.m_ID == node.get_Processor().m_Cursor.m_ID) || (++nCycles > 300))
+				io::Reactor::get_Current().stop();
+		});
+
+		pReactor->run();
+
+		verify_test(node2.get_Processor().m_Cursor.m_ID == node.get_Processor().m_Cursor.m_ID);
+
+		uint64_t nCwp = nm.m_CwpCached.get() + nm.m_CwpCropped.get() - nCwp0;
+		verify_test(nCwp == ((blockChain.size() > nMinGap) ? 1U : 0U));
+	}
+
+	void TestNodeCwpCache(const std::vector<BlockPlus::Ptr>& blockChain)
+	{
+		// The active states sampled by the chainwork proofs survive the tip changes, and the reverted ones are erased on rollback
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+
+		ECC::SetRandom(node);
+		node.Initialize();
+
+		PeerID peer;
+		ZeroObject(peer);
+
+		for (size_t i = 0; i < blockChain.size(); i++)
+		{
+			const BlockPlus& bp = *blockChain[i];
+			Block::SystemState::ID id;
+			bp.m_Hdr.get_ID(id);
+
+			node.get_Processor().OnState(bp.m_Hdr, peer);
+			node.get_Processor().OnBlock(id, bp.m_BodyP, bp.m_BodyE, peer);
+			node.get_Processor().TryGoUp();
+		}
+
+		// Generates at least nMin blocks on top of blockChain, until the branch is heavier than the current node tip, and feeds them to the node.
+		// The new blocks have much lower difficulty than the original ones (mined back-to-back), hence both the branches are generated here
+		auto fnExtend = [&node, &blockChain, &peer](uint32_t nMin)
+		{
+			DeleteFile(g_sz2);
+
+			NodeProcessor np;
+			np.Initialize(g_sz2);
+			np.OnTreasury(g_Treasury);
+
+			for (size_t i = 0; i < blockChain.size(); i++)
+			{
+				const BlockPlus& bp = *blockChain[i];
+				Block::SystemState::ID id;
+				bp.m_Hdr.get_ID(id);
+
+				np.OnState(bp.m_Hdr, peer);
+				np.OnBlock(id, bp.m_BodyP, bp.m_BodyE, peer);
+				np.TryGoUp();
+			}
+
+			Key::IKdf::Ptr pKdf;
+			ECC::SetRandom(pKdf);
+
+			const Difficulty::Raw wrk = node.get_Processor().m_Cursor.m_Full.m_ChainWork; // must be exceeded
+
+			for (uint32_t i = 0; (i < nMin) || (np.m_Cursor.m_Full.m_ChainWork <= wrk); i++)
+			{
+				verify_test(i < 100);
+
+				TxPool::Fluff txPool; // empty, no transactions
+				NodeProcessor::BlockContext bc(txPool, 0, *pKdf, *pKdf);
+				verify_test(np.GenerateNewBlock(bc));
+
+				Block::SystemState::ID id;
+				bc.m_Hdr.get_ID(id);
+
+				np.OnState(bc.m_Hdr, peer);
+				np.OnBlock(id, bc.m_BodyP, bc.m_BodyE, peer);
+				np.TryGoUp();
+
+				node.get_Processor().OnState(bc.m_Hdr, peer);
+				node.get_Processor().OnBlock(id, bc.m_BodyP, bc.m_BodyE, peer);
+				node.get_Processor().TryGoUp();
+			}
+
+			verify_test(node.get_Processor().m_Cursor.m_ID == np.m_Cursor.m_ID);
+		};
+
+		struct MyClient
+			:public proto::NodeConnection
+		{
+			uint32_t m_nPending = 0;
+
+			virtual void OnConnectedSecure() override {
+				io::Reactor::get_Current().stop();
+			}
+
+			virtual void OnDisconnect(const DisconnectReason&) override {
+				fail_test("OnDisconnect");
+				io::Reactor::get_Current().stop();
+			}
+
+			virtual void OnMsg(proto::ProofChainWork&& msg) override
+			{
+				verify_test(m_nPending);
+				verify_test(msg.m_Proof.IsValid());
+				if (!--m_nPending)
+					io::Reactor::get_Current().stop();
+			}
+		};
+
+		MyClient cl;
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		auto fnRun = [&pReactor, &pTimer]()
+		{
+			pTimer->start(1000 * 30, false, []() {
+				fail_test("Timeout");
+				io::Reactor::get_Current().stop();
+			});
+			pReactor->run();
+			pTimer->cancel();
+		};
+
+		auto fnRequest = [&cl, &fnRun]()
+		{
+			proto::GetProofChainWork msg;
+			cl.Send(msg);
+			cl.m_nPending++;
+			fnRun();
+		};
+
+		io::Address addr;
+		addr.resolve("127.0.0.1");
+		addr.port(g_Port);
+
+		cl.Connect(addr);
+		fnRun();
+
+		const NodeMetrics& nm = NodeMetrics::get();
+
+		fnRequest();
+		int64_t nStates = nm.m_CwpStates.get();
+		verify_test(nStates > 0);
+
+		// new tips, the proof is rebuilt from the same states
+		const Height hFork = node.get_Processor().m_Cursor.m_ID.m_Height;
+		fnExtend(3);
+		verify_test(node.get_Processor().m_Cursor.m_ID.m_Height > hFork);
+		verify_test(nm.m_CwpStates.get() == nStates);
+
+		fnRequest();
+		nStates = nm.m_CwpStates.get();
+
+		// a heavier branch from the same fork point (within MaxRollback)
+		fnExtend(0);
+
+		// the states sampled above the fork are gone, only the active ones below it remain
+		verify_test(nm.m_CwpStates.get() < nStates);
+		verify_test(nm.m_CwpStates.get() <= static_cast<int64_t>(hFork));
+
+		fnRequest();
+		verify_test(nm.m_CwpStates.get() > 0);
+	}
+
 
 
 	void TestNodeClientProto()
@@ -1621,6 +2184,9 @@ namespace beam
 			std::list<uint32_t> m_queProofsStateExpected;
 			std::list<uint32_t> m_queProofsKrnExpected;
 			uint32_t m_nChainWorkProofsPending = 0;
+			uint32_t m_nChainWorkProofs = 0;
+			uint64_t m_nCwpCached = 0; // metrics at login, the peer nodes request them too
+			uint64_t m_nCwpCropped = 0;
 			uint32_t m_nBbsMsgsPending = 0;
 			uint32_t m_nRecoveryPending = 0;
 
@@ -1653,6 +2219,10 @@ namespace beam
 				SetTimer(90 * 1000);
 				SendLogin();
 
+				const NodeMetrics& nm = NodeMetrics::get();
+				m_nCwpCached = nm.m_CwpCached.get();
+				m_nCwpCropped = nm.m_CwpCropped.get();
+
 				Send(proto::GetExternalAddr(Zero));
 			}
 
@@ -1992,6 +2562,8 @@ namespace beam
 				t.Test(IsHeightReached(), "Blockchain height didn't reach target");
 				t.Test(IsAllProofsReceived(), "some proofs missing");
 				t.Test(IsAllBbsReceived(), "some BBS messages missing");
+				t.Test(NodeMetrics::get().m_CwpCached.get() > m_nCwpCached, "chainwork proofs not served from the cache");
+				t.Test(NodeMetrics::get().m_CwpCropped.get() > m_nCwpCropped, "chainwork proofs not cropped");
 				t.Test(IsAllRecoveryReceived(), "some recovery messages missing");
 				t.Test(m_Assets.m_ID != 0, "CA not created");
 				t.Test(m_Assets.m_Recognized, "CA output not recognized");
@@ -2109,9 +2681,18 @@ namespace beam
 				}
 
 				{
+					// the cropped proofs are reset on the new tip
 					proto::GetProofChainWork msgOut2;
 					Send(msgOut2);
-					m_nChainWorkProofsPending++;
+					Send(msgOut2); // same bound, served from the cache
+					m_nChainWorkProofsPending += 2;
+
+					if (m_vStates.size() > 1)
+					{
+						msgOut2.m_LowerBound = m_vStates[m_vStates.size() / 2].m_ChainWork;
+						Send(msgOut2);
+						m_nChainWorkProofsPending++;
+					}
 				}
 
 				proto::NewTransaction msgTx;
@@ -2363,6 +2944,11 @@ namespace beam
 				verify_test(m_nChainWorkProofsPending);
 				verify_test(!m_vStates.empty() && (msg.m_Proof.m_Heading.m_Prefix.m_Height + msg.m_Proof.m_Heading.m_vElements.size() - 1 == m_vStates.back().m_Height));
 				verify_test(msg.m_Proof.IsValid());
+
+				// each request is either cropped, or served from the cache
+				const NodeMetrics& nm = NodeMetrics::get();
+				verify_test(nm.m_CwpCached.get() + nm.m_CwpCropped.get() >= m_nCwpCached + m_nCwpCropped + ++m_nChainWorkProofs);
+
 				m_nChainWorkProofsPending--;
 			}
 
@@ -2989,6 +3575,20 @@ void TestAll()
 
 			std::vector<beam::BlockPlus::Ptr> blockChain;
 			beam::TestNodeProcessor1(blockChain);
+			beam::TestNodeProcessorPrune();
+			beam::TestNodeProcessorProfiles(blockChain);
+			beam::DeleteFile(beam::g_sz);
+			beam::DeleteFile(beam::g_sz2);
+
+			beam::TestNodeHdrAnchors(blockChain, 8);
+			beam::DeleteFile(beam::g_sz);
+			beam::DeleteFile(beam::g_sz2);
+
+			beam::TestNodeHdrAnchors(blockChain, static_cast<uint32_t>(blockChain.size()));
+			beam::DeleteFile(beam::g_sz);
+			beam::DeleteFile(beam::g_sz2);
+
+			beam::TestNodeCwpCache(blockChain);
 			beam::DeleteFile(beam::g_sz);
 			beam::DeleteFile(beam::g_sz2);
 
@@ -3031,6 +3631,8 @@ void TestAll()
 		std::string sPath;
 		beam::NodeProcessor::get_UtxoMappingPath(sPath, beam::g_sz);
 		beam::DeleteFile(sPath.c_str());
+		beam::NodeProcessor::get_StreamsMappingPath(sPath, beam::g_sz);
+		beam::DeleteFile(sPath.c_str());
 
 		beam::Node node;
 		node.m_Cfg.m_sPathLocal = beam::g_sz;
@@ -17,6 +17,8 @@
 #include "3rdparty/crypto/equihashR.h"
 #include "wallet/unittests/test_helpers.h"
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
 WALLET_TEST_INIT
 using namespace std;
@@ -89,9 +91,162 @@ void TestArrayExpanding()
     TestArrayExpanding(96, 5);
 }
 
-int main()
+void InitBaseState(EquihashR<150, 5, 3>& eh, eh_HashState& state, size_t nInput)
 {
+    eh.InitialiseState(state);
+
+    vector<uint8_t> input(nInput);
+    for (size_t i = 0; i < nInput; ++i)
+        input[i] = uint8_t(i * 7 + 3);
+    blake2b_update(&state, input.data(), input.size());
+}
+
+void GenerateHashRef(const eh_HashState& base_state, eh_index g, unsigned char* hash, size_t hLen, size_t N, size_t R)
+{
+    // the original one-leaf-at-a-time version
+    uint32_t myHash[16] = { 0 };
+    for (eh_index g2 = g & ~0xFU; g2 <= g; g2++)
+    {
+        uint32_t tmpHash[16] = { 0 };
+        eh_HashState state = base_state;
+        eh_index lei = g2;
+        blake2b_update(&state, (const unsigned char*)&lei, sizeof(eh_index));
+        blake2b_final(&state, (unsigned char*)&tmpHash[0], static_cast<uint8_t>(hLen));
+
+        for (uint32_t idx = 0; idx < 16; idx++)
+            myHash[idx] += tmpHash[idx];
+    }
+
+    memcpy(hash, &myHash[0], hLen);
+
+    // see ZeroizeUnusedBits
+    const size_t step = (N + 7) / 8;
+    for (size_t i = step - 1; i < hLen; i += step)
+        hash[i] &= 0xff << (8 - N % 8);
+    for (size_t i = 0; i < hLen; i += step)
+        hash[i] &= 0xff >> (2 * R);
+}
+
+void TestHashLanes()
+{
+    cout << "Test multi-lane leaf hashing, SIMD width " << blake2b_lanes_width() << "...\n";
+
+    EquihashR<150, 5, 3> eh;
+    const size_t hLen = 57; // (512 / N) * GetSizeInBytes(N)
+
+    for (int iSimd = 0; iSimd < 2; iSimd++)
+    {
+        blake2b_lanes_enable_simd(!!iSimd);
+
+        // different prefix lengths, including the ones that don't leave room for the index (fallback)
+        for (size_t nInput = 0; nInput <= 140; nInput += 7)
+        {
+            eh_HashState state;
+            InitBaseState(eh, state, nInput);
+
+            blake2b_lanes_ctx ctx;
+            bool bLanes = InitHashLanes(state, ctx);
+            size_t nBuffered = (nInput > 128) ? (nInput - 128) : nInput; // blake2b compresses a full block only when more data follows
+            WALLET_CHECK(bLanes == (nBuffered + sizeof(eh_index) <= 128));
+
+            if (bLanes)
+            {
+                for (size_t nLanes = 1; nLanes <= 9; nLanes++)
+                {
+                    uint32_t pIdx[9];
+                    uint8_t pOut[9 * 64];
+                    for (size_t i = 0; i < nLanes; i++)
+                        pIdx[i] = uint32_t(0x1234567 * (i + nInput));
+
+                    blake2b_lanes_final_u32(&ctx, pIdx, nLanes, pOut, hLen);
+
+                    for (size_t i = 0; i < nLanes; i++)
+                    {
+                        uint8_t pRef[64];
+                        eh_HashState s2 = state;
+                        blake2b_update(&s2, (const uint8_t*)&pIdx[i], sizeof(pIdx[i]));
+                        blake2b_final(&s2, pRef, uint8_t(hLen));
+                        WALLET_CHECK(!memcmp(pRef, pOut + i * hLen, hLen));
+                    }
+                }
+            }
+
+            const eh_index g0 = 13, nCount = 40;
+            vector<uint8_t> hashes(nCount * hLen);
+            GenerateHashes(state, g0, nCount, hashes.data(), hLen, 150, 3);
+
+            for (eh_index i = 0; i < nCount; i++)
+            {
+                uint8_t pRef[64];
+                GenerateHashRef(state, g0 + i, pRef, hLen, 150, 3);
+                WALLET_CHECK(!memcmp(pRef, hashes.data() + i * hLen, hLen));
+            }
+        }
+    }
+
+    blake2b_lanes_enable_simd(true);
+}
+
+void BenchmarkHashLanes()
+{
+    EquihashR<150, 5, 3> eh;
+    eh_HashState state;
+
+    const size_t hLen = 57;
+    const eh_index nCount = 1 << 16;
+    vector<uint8_t> hashes(16 * hLen);
+
+    // a valid solution, so that the verification goes through all the collision tests
+    uint8_t pInput[32];
+    for (size_t i = 0; i < sizeof(pInput); i++)
+        pInput[i] = uint8_t(i * 7 + 3);
+
+    const beam::Height h = beam::Rules::get().pForks[1].m_Height; // BeamHash II
+
+    beam::Block::PoW pow;
+    ZeroObject(pow);
+    WALLET_CHECK(pow.Solve(pInput, sizeof(pInput), h));
+    WALLET_CHECK(pow.IsValid(pInput, sizeof(pInput), h));
+
+    eh.InitialiseState(state);
+    blake2b_update(&state, pInput, sizeof(pInput));
+    blake2b_update(&state, pow.m_Nonce.m_pData, pow.m_Nonce.nBytes);
+
+    vector<unsigned char> soln(pow.m_Indices.begin(), pow.m_Indices.end());
+
+    for (int iSimd = 0; iSimd < 2; iSimd++)
+    {
+        blake2b_lanes_enable_simd(!!iSimd);
+
+        auto t0 = chrono::steady_clock::now();
+        for (eh_index g = 0; g < nCount; g += 16)
+            GenerateHashes(state, g, 16, hashes.data(), hLen, 150, 3);
+        auto t1 = chrono::steady_clock::now();
+
+        const uint32_t nVerify = 2000;
+        for (uint32_t i = 0; i < nVerify; i++)
+            WALLET_CHECK(eh.IsValidSolution(state, soln));
+        auto t2 = chrono::steady_clock::now();
+
+        double dt1 = chrono::duration<double>(t1 - t0).count();
+        double dt2 = chrono::duration<double>(t2 - t1).count();
+
+        cout << "BeamHash leaves, SIMD width " << blake2b_lanes_width() << ": " << uint64_t(nCount / dt1) << " hashes/s, "
+            << uint64_t(nVerify / dt2) << " verifications/s\n";
+    }
+
+    blake2b_lanes_enable_simd(true);
+}
+
+int main(int argc, char* argv[])
+{
+    bool bBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
     TestArrayExpanding();
+    TestHashLanes();
+
+    if (bBenchmark)
+        BenchmarkHashLanes();
     
     // commented since it doesn't complete in 10 minutes and failes auto tests
 /*
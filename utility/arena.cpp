@@ -0,0 +1,131 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "arena.h"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+namespace beam
+{
+#ifndef NDEBUG
+	Arena::Stats Arena::s_Stats;
+#	define ARENA_STAT_INC(name) s_Stats.name.Inc()
+#else // NDEBUG
+#	define ARENA_STAT_INC(name)
+#endif // NDEBUG
+
+	struct Arena::Chunk
+	{
+		std::atomic<uint32_t> m_Refs; // objects, plus the owning scope (if still active)
+	};
+
+	struct Arena::Hdr
+	{
+		Chunk* m_pChunk; // null if allocated on the heap
+		uint64_t m_Reserved; // keep the payload 16-byte aligned
+	};
+
+	namespace
+	{
+		const size_t s_Align = 16;
+
+		size_t AlignUp(size_t n)
+		{
+			return (n + s_Align - 1) & ~(s_Align - 1);
+		}
+
+		thread_local Arena::Scope* g_pScope = nullptr;
+	}
+
+	void Arena::ReleaseChunk(Chunk* p) noexcept
+	{
+		if (1 == p->m_Refs.fetch_sub(1, std::memory_order_acq_rel))
+		{
+			p->~Chunk();
+			::operator delete(p);
+		}
+	}
+
+	void* Arena::Allocate(size_t n)
+	{
+		static_assert(sizeof(Hdr) == s_Align, "");
+		n = AlignUp(n) + sizeof(Hdr);
+
+		Scope* pScope = g_pScope;
+		Hdr* pHdr;
+
+		if (pScope && (n <= s_ObjMax))
+		{
+			if (!pScope->m_pChunk || (pScope->m_Pos + n > s_ChunkSize))
+			{
+				Chunk* pChunk = new (::operator new(s_ChunkSize)) Chunk;
+				pChunk->m_Refs.store(1, std::memory_order_relaxed);
+				ARENA_STAT_INC(m_Chunks);
+
+				if (pScope->m_pChunk)
+					ReleaseChunk(pScope->m_pChunk);
+
+				pScope->m_pChunk = pChunk;
+				pScope->m_Pos = AlignUp(sizeof(Chunk));
+			}
+
+			pHdr = reinterpret_cast<Hdr*>(reinterpret_cast<uint8_t*>(pScope->m_pChunk) + pScope->m_Pos);
+			pScope->m_Pos += n;
+
+			pHdr->m_pChunk = pScope->m_pChunk;
+			pHdr->m_pChunk->m_Refs.fetch_add(1, std::memory_order_relaxed);
+			ARENA_STAT_INC(m_Allocs);
+		}
+		else
+		{
+			pHdr = static_cast<Hdr*>(::operator new(n));
+			pHdr->m_pChunk = nullptr;
+			ARENA_STAT_INC(m_AllocsHeap);
+		}
+
+		return pHdr + 1;
+	}
+
+	void Arena::Free(void* p) noexcept
+	{
+		if (!p)
+			return;
+
+		Hdr* pHdr = static_cast<Hdr*>(p) - 1;
+		if (pHdr->m_pChunk)
+			ReleaseChunk(pHdr->m_pChunk);
+		else
+			::operator delete(pHdr);
+	}
+
+	/////////////////////////////
+	// Scope
+	Arena::Scope::Scope()
+		:m_pPrev(g_pScope)
+	{
+		g_pScope = this;
+	}
+
+	Arena::Scope::~Scope()
+	{
+		assert(this == g_pScope);
+		g_pScope = m_pPrev;
+
+		if (m_pChunk)
+			ReleaseChunk(m_pChunk);
+	}
+
+} // namespace beam
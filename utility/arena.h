@@ -0,0 +1,76 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#ifndef NDEBUG
+#	include "metrics.h"
+#endif // NDEBUG
+
+namespace beam
+{
+	// Allocator for groups of small objects that are created together and usually die together, such as
+	// the elements of a deserialized block. While a Scope is active on the current thread, allocations are carved
+	// from large chunks. A chunk is released once its scope is over and all the objects allocated from it are freed
+	// (which may happen on any thread). Outside of a scope, and for large objects, it falls back to the heap.
+	class Arena
+	{
+		struct Chunk;
+		struct Hdr;
+
+		static void ReleaseChunk(Chunk*) noexcept;
+
+	public:
+		static const size_t s_ChunkSize = 0x10000;
+		static const size_t s_ObjMax = s_ChunkSize / 8; // larger objects go to the heap
+
+		static void* Allocate(size_t);
+		static void Free(void*) noexcept;
+
+		class Scope
+		{
+			friend class Arena;
+			Scope* m_pPrev;
+			Chunk* m_pChunk = nullptr;
+			size_t m_Pos = 0;
+
+		public:
+			Scope();
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			void operator = (const Scope&) = delete;
+		};
+
+#ifndef NDEBUG
+		// Debug builds only, not to burden the allocation path with the shared counters
+		struct Stats
+		{
+			metrics::Counter m_Allocs; // served by the arena
+			metrics::Counter m_AllocsHeap; // outside of a scope, or too large
+			metrics::Counter m_Chunks;
+		};
+
+		static Stats s_Stats;
+#endif // NDEBUG
+	};
+
+} // namespace beam
+
+// Class-level allocation operators for the types that should be served by the arena
+#define BEAM_ARENA_ALLOCATED \
+	static void* operator new(size_t n) { return beam::Arena::Allocate(n); } \
+	static void operator delete(void* p) noexcept { beam::Arena::Free(p); }
@@ -165,6 +165,7 @@ namespace beam
         const char* PRINT_TXO = "print_txo";
         const char* CHECKDB = "check_db";
         const char* VACUUM = "vacuum";
+        const char* DB_PROFILE = "db_profile";
         const char* CRASH = "crash";
         const char* INIT = "init";
         const char* RESTORE = "restore";
@@ -201,6 +202,7 @@ namespace beam
         const char* LOG_DEBUG = "debug";
         const char* LOG_VERBOSE = "verbose";
         const char* LOG_CLEANUP_DAYS = "log_cleanup_days";
+        const char* LOG_ASYNC = "log_async";
         const char* LOG_UTXOS = "log_utxos";
         const char* VERSION = "version";
         const char* VERSION_FULL = "version,v";
@@ -315,6 +317,7 @@ namespace beam
             (cli::LOG_LEVEL, po::value<string>(), "log level [info|debug|verbose]")
             (cli::FILE_LOG_LEVEL, po::value<string>(), "file log level [info|debug|verbose]")
             (cli::LOG_CLEANUP_DAYS, po::value<uint32_t>()->default_value(5), "old logfiles cleanup period(days)")
+            (cli::LOG_ASYNC, po::value<bool>()->default_value(false), "write log files from a background thread")
             (cli::VERSION_FULL, "return project version")
             (cli::GIT_COMMIT_HASH, "return commit hash");
 
@@ -335,6 +338,7 @@ namespace beam
             (cli::PRINT_TXO, po::value<bool>()->default_value(false), "Print TXO movements (create/spend) recognized by the owner key.")
             (cli::CHECKDB, po::value<bool>()->default_value(false), "DB integrity check")
             (cli::VACUUM, po::value<bool>()->default_value(false), "DB vacuum (compact)")
+            (cli::DB_PROFILE, po::value<string>()->default_value("default"), "DB storage profile: default, wal, wal_fast")
             (cli::BBS_ENABLE, po::value<bool>()->default_value(true), "Enable SBBS messaging")
             (cli::CRASH, po::value<int>()->default_value(0), "Induce crash (test proper handling)")
             (cli::OWNER_KEY, po::value<string>(), "Owner viewer key")
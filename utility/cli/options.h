@@ -66,6 +66,7 @@ namespace beam
         extern const char* PRINT_TXO;
         extern const char* CHECKDB;
         extern const char* VACUUM;
+        extern const char* DB_PROFILE;
         extern const char* CRASH;
         extern const char* INIT;
         extern const char* RESTORE;
@@ -102,6 +103,7 @@ namespace beam
         extern const char* LOG_DEBUG;
         extern const char* LOG_VERBOSE;
         extern const char* LOG_CLEANUP_DAYS;
+        extern const char* LOG_ASYNC;
         extern const char* LOG_UTXOS;
         extern const char* VERSION;
         extern const char* VERSION_FULL;
@@ -166,6 +166,12 @@ namespace beam
 		m_NewTask.notify_one();
 	}
 
+	uint32_t ExecutorMT::get_Pending()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		return static_cast<uint32_t>(m_queTasks.size());
+	}
+
 	uint32_t ExecutorMT::Flush(uint32_t nMaxTasks)
 	{
 		InitSafe();
@@ -80,6 +80,8 @@ namespace beam
 		~ExecutorMT() { Stop(); }
 		void Stop();
 
+		uint32_t get_Pending(); // queued tasks, not picked by the threads yet
+
 	protected:
 
 		virtual void RunThread(uint32_t) = 0; // override this, create the appropriate context, and call the next
@@ -36,6 +36,20 @@ namespace {
         io::FragmentWriter& fw;
     };
 
+    struct StringOutputAdapter : nlohmann::detail::output_adapter_protocol<char> {
+        StringOutputAdapter(std::string& _str) : str(_str) {}
+
+        void write_character(char c) override {
+            str.push_back(c);
+        }
+
+        void write_characters(const char* s, std::size_t length) override {
+            str.append(s, length);
+        }
+
+        std::string& str;
+    };
+
 } //namespace
 
 bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o) {
@@ -55,6 +69,96 @@ bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o) {
     return result;
 }
 
-} //namespace
+struct JsonStreamWriter::Impl {
+    explicit Impl(nlohmann::detail::output_adapter_t<char> a) :
+        adapter(a),
+        serializer(a, ' ')
+    {}
+
+    nlohmann::detail::output_adapter_t<char> adapter;
+    nlohmann::detail::serializer<json> serializer;
+};
 
+JsonStreamWriter::JsonStreamWriter(io::FragmentWriter& fw) :
+    _impl(std::make_unique<Impl>(std::make_shared<JsonOutputAdapter>(fw))),
+    _fw(&fw)
+{}
 
+JsonStreamWriter::JsonStreamWriter(std::string& out) :
+    _impl(std::make_unique<Impl>(std::make_shared<StringOutputAdapter>(out)))
+{}
+
+JsonStreamWriter::~JsonStreamWriter() = default;
+
+void JsonStreamWriter::write(const char* s, size_t size) {
+    _impl->adapter->write_characters(s, size);
+}
+
+void JsonStreamWriter::next_element() {
+    if (_afterKey) {
+        _afterKey = false;
+        return;
+    }
+    if (!_notEmpty.empty()) {
+        if (_notEmpty.back()) {
+            write(",", 1);
+        } else {
+            _notEmpty.back() = true;
+        }
+    }
+}
+
+void JsonStreamWriter::begin_object() {
+    next_element();
+    write("{", 1);
+    _notEmpty.push_back(false);
+}
+
+void JsonStreamWriter::end_object() {
+    assert(!_notEmpty.empty() && !_afterKey);
+    _notEmpty.pop_back();
+    write("}", 1);
+}
+
+void JsonStreamWriter::begin_array() {
+    next_element();
+    write("[", 1);
+    _notEmpty.push_back(false);
+}
+
+void JsonStreamWriter::end_array() {
+    assert(!_notEmpty.empty() && !_afterKey);
+    _notEmpty.pop_back();
+    write("]", 1);
+}
+
+void JsonStreamWriter::key(const char* name) {
+    assert(!_afterKey);
+    next_element();
+    write("\"", 1);
+    write(name, strlen(name));
+    write("\":", 2);
+    _afterKey = true;
+}
+
+void JsonStreamWriter::value(const json& v) {
+    next_element();
+    try {
+        _impl->serializer.dump(v, false, false, 0);
+    } catch (const std::exception& e) {
+        LOG_ERROR() << "dump json: " << e.what();
+        _ok = false;
+    }
+}
+
+bool JsonStreamWriter::finalize() {
+    assert(_notEmpty.empty());
+    if (_fw) {
+        static const char eol = 10;
+        _fw->write(&eol, 1);
+        _fw->finalize();
+    }
+    return _ok;
+}
+
+} //namespace
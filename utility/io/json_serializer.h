@@ -15,11 +15,63 @@
 #pragma once
 #include "utility/io/fragment_writer.h"
 #include "nlohmann/json_fwd.hpp"
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace beam {
 
 // appends json msg to out by fragment writer
 bool serialize_json_msg(io::FragmentWriter& packer, const nlohmann::json& o);
 
+/// SAX-style json writer, emits the document directly into the output as it goes,
+/// without building the whole DOM. Nested values may still be passed as (small) json objects.
+/// Keys are written verbatim, they're expected to be plain literals.
+class JsonStreamWriter {
+public:
+    /// Writes into fragment writer. finalize() writes the terminating eol and finalizes the message
+    explicit JsonStreamWriter(io::FragmentWriter& fw);
+
+    /// Appends to the string
+    explicit JsonStreamWriter(std::string& out);
+
+    ~JsonStreamWriter();
+
+    JsonStreamWriter(const JsonStreamWriter&) = delete;
+    JsonStreamWriter& operator=(const JsonStreamWriter&) = delete;
+
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+
+    /// Object member name, must be followed by a value or begin_object/begin_array
+    void key(const char* name);
+
+    void value(const nlohmann::json& v);
+
+    void member(const char* name, const nlohmann::json& v) {
+        key(name);
+        value(v);
+    }
+
+    /// Returns false if serialization failed (the output must be discarded then)
+    bool finalize();
+
+private:
+    struct Impl;
+
+    void write(const char* s, size_t size);
+    void next_element();
+
+    std::unique_ptr<Impl> _impl;
+    io::FragmentWriter* _fw = nullptr;
+
+    /// Per nesting level: if any element was written already
+    std::vector<bool> _notEmpty;
+    bool _afterKey = false;
+    bool _ok = true;
+};
+
 } //namespace
 
@@ -34,6 +34,10 @@
 #include <iostream>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <vector>
 #include <algorithm>
 
 namespace beam {
@@ -43,6 +47,7 @@ using namespace std;
 Logger* Logger::g_logger = 0;
 
 class LoggerImpl : public Logger {
+    friend class AsyncLogger;
 protected:
     mutex _mutex;
     static const size_t MAX_HEADER_SIZE = 256;
@@ -87,15 +92,9 @@ protected:
     }
 
     void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
-        char timestampFormatted[MAX_TIMESTAMP_SIZE];
         char headerFormatted[MAX_HEADER_SIZE];
-        if (!_timeFormat.empty()) {
-            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
-        } else {
-            timestampFormatted[0] = 0;
-        }
-        size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
-        write_impl(header.level, headerFormatted, headerSize, buf, size);
+        size_t headerSize = format_header(headerFormatted, header);
+        write_formatted(header.level, headerFormatted, headerSize, buf, size, true);
     }
 
     const FileNameType& get_current_file_name() override {
@@ -108,13 +107,38 @@ public:
         return level >= _minLevel;
     }
 
-    void write_impl(int level, const char* header, size_t headerSize, const char* msg, size_t size) {
+    bool level_flushes(int level) const {
+        return level >= _flushLevel;
+    }
+
+    /// Formats the message header into buf, which must be at least MAX_HEADER_SIZE long
+    size_t format_header(char* buf, const LogMessageHeader& header) {
+        char timestampFormatted[MAX_TIMESTAMP_SIZE];
+        if (!_timeFormat.empty()) {
+            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
+        } else {
+            timestampFormatted[0] = 0;
+        }
+        return std::min(_headerFormatter(buf, MAX_HEADER_SIZE, timestampFormatted, header), MAX_HEADER_SIZE - 1);
+    }
+
+    /// Writes the already formatted message to the sink(s). If allowFlush is false - the caller is responsible to call flush() later
+    virtual void write_formatted(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool allowFlush) {
+        write_impl(level, header, headerSize, msg, size, allowFlush);
+    }
+
+    virtual void flush() {
+        lock_guard<mutex> lock(_mutex);
+        if (_sink) fflush(_sink);
+    }
+
+    void write_impl(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool allowFlush) {
         if (!_sink) return; 
         lock_guard<mutex> lock(_mutex);
         if (!_sink) return; // double check
         fwrite(header, 1, headerSize, _sink);
         fwrite(msg, 1, size, _sink);
-        if (level >= _flushLevel) fflush(_sink);
+        if (allowFlush && level_flushes(level)) fflush(_sink);
     }
 };
 
@@ -225,23 +249,20 @@ public:
         _consoleSink(flushLevel, consoleLevel)
     {}
 
-    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
-        char timestampFormatted[MAX_TIMESTAMP_SIZE];
-        char headerFormatted[MAX_HEADER_SIZE];
-        if (!_timeFormat.empty()) {
-            format_timestamp(timestampFormatted, MAX_TIMESTAMP_SIZE, _timeFormat.c_str(), header.timestamp, _printMilliseconds);
-        } else {
-            timestampFormatted[0] = 0;
+    void write_formatted(int level, const char* header, size_t headerSize, const char* msg, size_t size, bool allowFlush) override {
+        if (_consoleSink.level_accepted(level)) {
+            _consoleSink.write_impl(level, header, headerSize, msg, size, allowFlush);
         }
-        size_t headerSize = _headerFormatter(headerFormatted, MAX_HEADER_SIZE, timestampFormatted, header);
-        if (_consoleSink.level_accepted(header.level)) {
-            _consoleSink.write_impl(header.level, headerFormatted, headerSize, buf, size);
-        }
-        if (_fileSink.level_accepted(header.level)) {
-            _fileSink.write_impl(header.level, headerFormatted, headerSize, buf, size);
+        if (_fileSink.level_accepted(level)) {
+            _fileSink.write_impl(level, header, headerSize, msg, size, allowFlush);
         }
     }
 
+    void flush() override {
+        _consoleSink.flush();
+        _fileSink.flush();
+    }
+
     const FileNameType& get_current_file_name() override {
         return _fileSink.get_current_file_name();
     }
@@ -251,18 +272,287 @@ public:
     }
 };
 
+// Messages are formatted by the calling thread, and put into its own ring buffer (single producer, single consumer, no locking).
+// The background thread collects them from all the rings, and writes to the sinks in batches.
+// If the ring of the calling thread is full - the message is dropped (and accounted for).
+class AsyncLogger : public Logger {
+    static constexpr size_t RING_SIZE = 256 * 1024; // per producing thread
+    static constexpr unsigned WAIT_PERIOD_MSEC = 50;
+
+    struct RecordHeader {
+        uint64_t timestamp;
+        uint32_t size; // payload (header + msg) size
+        int level;
+    };
+
+    struct Ring {
+        std::unique_ptr<char[]> data;
+        std::atomic<size_t> head; // total bytes written, modified by the producer only
+        std::atomic<size_t> tail; // total bytes read, modified by the consumer only
+        std::atomic<bool> abandoned; // the producing thread is gone
+
+        Ring() :
+            data(new char[RING_SIZE]),
+            head(0),
+            tail(0),
+            abandoned(false)
+        {}
+
+        void put(size_t pos, const void* p, size_t size) {
+            pos %= RING_SIZE;
+            size_t n = std::min(size, RING_SIZE - pos);
+            memcpy(data.get() + pos, p, n);
+            memcpy(data.get(), (const char*) p + n, size - n);
+        }
+
+        void get(size_t pos, void* p, size_t size) const {
+            pos %= RING_SIZE;
+            size_t n = std::min(size, RING_SIZE - pos);
+            memcpy(p, data.get() + pos, n);
+            memcpy((char*) p + n, data.get(), size - n);
+        }
+    };
+
+    using RingPtr = std::shared_ptr<Ring>;
+
+    struct ThreadSlot {
+        uint64_t generation = 0;
+        RingPtr ring;
+
+        ~ThreadSlot() {
+            if (ring) ring->abandoned = true;
+        }
+    };
+
+    struct Entry {
+        uint64_t timestamp;
+        int level;
+        size_t offset; // in the batch buffer
+        size_t size;
+    };
+
+    static std::atomic<uint64_t> s_generation;
+
+    std::unique_ptr<Logger> _owner;
+    LoggerImpl* _impl;
+    const uint64_t _generation;
+
+    std::mutex _mutex; // protects _rings and the wakeup
+    std::condition_variable _cv;
+    std::vector<RingPtr> _rings;
+    std::atomic<bool> _pending;
+    bool _stop;
+
+    std::atomic<uint64_t> _dropped;
+    uint64_t _droppedReported;
+
+    std::thread _thread;
+
+public:
+    explicit AsyncLogger(LoggerImpl* impl) :
+        _owner(impl),
+        _impl(impl),
+        _generation(++s_generation),
+        _pending(false),
+        _stop(false),
+        _dropped(0),
+        _droppedReported(0)
+    {
+        _thread = std::thread(&AsyncLogger::thread_func, this);
+    }
+
+    ~AsyncLogger() {
+        if (this == g_logger) {
+            g_logger = 0;
+        }
+
+        {
+            lock_guard<mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_one();
+        _thread.join();
+    }
+
+    void set_header_formatter(LogMessageHeaderFormatter formatter) override {
+        _impl->set_header_formatter(formatter);
+    }
+
+    void set_time_format(const char* format, bool printMilliseconds) override {
+        _impl->set_time_format(format, printMilliseconds);
+    }
+
+    const FileNameType& get_current_file_name() override {
+        return _impl->get_current_file_name();
+    }
+
+    void rotate() override {
+        // the sink is switched under its mutex, so it's safe wrt concurrent batch write
+        _impl->rotate();
+    }
+
+    uint64_t get_dropped_count() const override {
+        return _dropped;
+    }
+
+protected:
+    bool level_accepted(int level) override {
+        return _impl->level_accepted(level);
+    }
+
+    void write_message(const LogMessageHeader& header, const char* buf, size_t size) override {
+        char headerFormatted[LoggerImpl::MAX_HEADER_SIZE];
+        size_t headerSize = _impl->format_header(headerFormatted, header);
+
+        Ring& ring = get_ring();
+
+        RecordHeader rh;
+        rh.timestamp = header.timestamp;
+        rh.level = header.level;
+        rh.size = uint32_t(headerSize + size);
+
+        size_t total = sizeof(rh) + rh.size;
+        size_t head = ring.head.load(std::memory_order_relaxed);
+        size_t used = head - ring.tail.load(std::memory_order_acquire);
+
+        if (total > RING_SIZE - used) {
+            _dropped++;
+            return;
+        }
+
+        ring.put(head, &rh, sizeof(rh));
+        ring.put(head + sizeof(rh), headerFormatted, headerSize);
+        ring.put(head + sizeof(rh) + headerSize, buf, size);
+        ring.head.store(head + total, std::memory_order_release);
+
+        if (_impl->level_flushes(header.level) || (used + total > RING_SIZE / 2)) {
+            // no locking here. The wakeup may be missed, then it's delayed by WAIT_PERIOD_MSEC at most
+            _pending = true;
+            _cv.notify_one();
+        }
+    }
+
+private:
+    Ring& get_ring() {
+        static thread_local ThreadSlot slot;
+        if (slot.generation != _generation) {
+            if (slot.ring) slot.ring->abandoned = true;
+
+            slot.ring = std::make_shared<Ring>();
+            slot.generation = _generation;
+
+            lock_guard<mutex> lock(_mutex);
+            _rings.push_back(slot.ring);
+        }
+        return *slot.ring;
+    }
+
+    void thread_func() {
+        std::vector<char> batch;
+        std::vector<Entry> entries;
+        std::vector<RingPtr> rings;
+
+        while (true) {
+            bool stop;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _cv.wait_for(lock, std::chrono::milliseconds(WAIT_PERIOD_MSEC), [this]() { return _stop || _pending; });
+                _pending = false;
+                stop = _stop;
+
+                rings = _rings;
+
+                // forget the rings of finished threads, once they're drained
+                _rings.erase(
+                    std::remove_if(_rings.begin(), _rings.end(), [](const RingPtr& r) {
+                        return r->abandoned && (r->head == r->tail);
+                    }),
+                    _rings.end()
+                );
+            }
+
+            write_batch(rings, batch, entries);
+            rings.clear();
+
+            if (stop) {
+                break;
+            }
+        }
+    }
+
+    void write_batch(const std::vector<RingPtr>& rings, std::vector<char>& batch, std::vector<Entry>& entries) {
+        batch.clear();
+        entries.clear();
+
+        for (const RingPtr& pRing : rings) {
+            Ring& ring = *pRing;
+            size_t tail = ring.tail.load(std::memory_order_relaxed);
+            size_t head = ring.head.load(std::memory_order_acquire);
+
+            while (tail != head) {
+                RecordHeader rh;
+                ring.get(tail, &rh, sizeof(rh));
+
+                Entry e;
+                e.timestamp = rh.timestamp;
+                e.level = rh.level;
+                e.offset = batch.size();
+                e.size = rh.size;
+
+                batch.resize(batch.size() + rh.size);
+                ring.get(tail + sizeof(rh), batch.data() + e.offset, rh.size);
+                entries.push_back(e);
+
+                tail += sizeof(rh) + rh.size;
+            }
+
+            ring.tail.store(tail, std::memory_order_release);
+        }
+
+        // restore the chronological order among different threads
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.timestamp < b.timestamp; });
+
+        bool needFlush = false;
+        for (const Entry& e : entries) {
+            _impl->write_formatted(e.level, batch.data() + e.offset, e.size, nullptr, 0, false);
+            if (_impl->level_flushes(e.level)) needFlush = true;
+        }
+
+        uint64_t dropped = _dropped;
+        if (dropped != _droppedReported) {
+            char buf[128];
+            int n = snprintf(buf, sizeof(buf), "logger: %llu messages dropped, async queue overflow\n", (unsigned long long) (dropped - _droppedReported));
+            _droppedReported = dropped;
+
+            LogMessageHeader header(LOG_LEVEL_WARNING, 0, 0, 0);
+            _impl->write_message(header, buf, size_t(n));
+        }
+
+        if (needFlush) {
+            _impl->flush();
+        }
+
+        if (batch.capacity() > RING_SIZE * 4) {
+            std::vector<char>().swap(batch); // don't keep excessive memory after bursts
+        }
+    }
+};
+
+std::atomic<uint64_t> AsyncLogger::s_generation(0);
+
 std::shared_ptr<Logger> Logger::create(
     int flushLevel,
     int consoleLevel,
     int fileLevel,
     const std::string& fileNamePrefix,
-    const std::string& dstPath
+    const std::string& dstPath,
+    bool async
 ) {
     if (g_logger) {
         throw runtime_error("logger already initialized");
     }
 
-    std::shared_ptr<Logger> logger;
+    LoggerImpl* impl = nullptr;
 
     int what = 0;
 
@@ -271,18 +561,25 @@ std::shared_ptr<Logger> Logger::create(
 
     switch (what) {
         case 3:
-            logger.reset(new CombinedLogger(flushLevel, consoleLevel, fileLevel, fileNamePrefix, dstPath));
+            impl = new CombinedLogger(flushLevel, consoleLevel, fileLevel, fileNamePrefix, dstPath);
             break;
         case 2:
-            logger.reset(new FileLogger(flushLevel, fileLevel, fileNamePrefix, dstPath));
+            impl = new FileLogger(flushLevel, fileLevel, fileNamePrefix, dstPath);
             break;
         case 1:
-            logger.reset(new ConsoleLogger(flushLevel, consoleLevel));
+            impl = new ConsoleLogger(flushLevel, consoleLevel);
             break;
         default:
             throw runtime_error("no logger sink configured");
     }
 
+    std::shared_ptr<Logger> logger;
+    if (async) {
+        logger.reset(new AsyncLogger(impl));
+    } else {
+        logger.reset(static_cast<Logger*>(impl));
+    }
+
     g_logger = logger.get();
     return logger;
 }
@@ -144,7 +144,10 @@ public:
         const std::string& fileNamePrefix = std::string(),
 
         // path to log file
-        const std::string& dstPath = std::string()
+        const std::string& dstPath = std::string(),
+
+        // if set - messages are formatted on the calling thread, and written to the sinks by a background thread
+        bool async = false
     );
 
     virtual ~Logger() {}
@@ -167,6 +170,9 @@ public:
     /// Rotates file name, called externally
     virtual void rotate() = 0;
 
+    /// Returns the total number of messages dropped (by all threads) because their async queues were full. Always 0 for synchronous logger
+    virtual uint64_t get_dropped_count() const { return 0; }
+
     static bool will_log(int level) {
         return g_logger && g_logger->level_accepted(level);
     }
@@ -0,0 +1,236 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include <sstream>
+
+namespace beam {
+namespace metrics
+{
+	/////////////////////////////
+	// Histogram
+	Histogram::Histogram()
+	{
+		Reset();
+	}
+
+	void Histogram::Reset()
+	{
+		for (uint32_t i = 0; i < s_Buckets; i++)
+			m_pBucket[i].store(0, std::memory_order_relaxed);
+		m_Count.m_Value.store(0, std::memory_order_relaxed);
+		m_Sum.m_Value.store(0, std::memory_order_relaxed);
+	}
+
+	uint32_t Histogram::get_Bucket(uint64_t x)
+	{
+		if (x < s_Linear)
+			return static_cast<uint32_t>(x);
+
+		if (x >> s_MaxBits)
+			return s_Buckets - 1;
+
+		// index of the highest bit
+		uint32_t nBit = 0;
+		for (uint32_t nStep = 32; nStep; nStep >>= 1)
+		{
+			if (x >> (nBit + nStep))
+				nBit += nStep;
+		}
+
+		assert(nBit > s_SubBits);
+		uint32_t nSub = static_cast<uint32_t>(x >> (nBit - s_SubBits)) & (s_SubBuckets - 1);
+		return s_Linear + (nBit - s_SubBits - 1) * s_SubBuckets + nSub;
+	}
+
+	uint64_t Histogram::get_BucketMin(uint32_t i)
+	{
+		if (i < s_Linear)
+			return i;
+
+		i -= s_Linear;
+		uint32_t nShift = i / s_SubBuckets + 1;
+		return static_cast<uint64_t>(s_SubBuckets + i % s_SubBuckets) << nShift;
+	}
+
+	uint64_t Histogram::get_BucketMax(uint32_t i)
+	{
+		if (i < s_Linear)
+			return i + 1;
+
+		uint32_t nShift = (i - s_Linear) / s_SubBuckets + 1;
+		return get_BucketMin(i) + (static_cast<uint64_t>(1) << nShift);
+	}
+
+	void Histogram::Add(uint64_t x)
+	{
+		m_pBucket[get_Bucket(x)].fetch_add(1, std::memory_order_relaxed);
+		m_Count.Inc();
+		m_Sum.Inc(x);
+	}
+
+	uint64_t Histogram::get_Quantile(double q) const
+	{
+		uint64_t pVal[s_Buckets];
+		uint64_t nTotal = 0;
+		for (uint32_t i = 0; i < s_Buckets; i++)
+		{
+			pVal[i] = m_pBucket[i].load(std::memory_order_relaxed);
+			nTotal += pVal[i];
+		}
+
+		if (!nTotal)
+			return 0;
+
+		uint64_t nRank = static_cast<uint64_t>(q * nTotal + 0.5);
+		if (!nRank)
+			nRank = 1;
+
+		uint64_t nAcc = 0;
+		uint32_t i = 0;
+		for (; i + 1 < s_Buckets; i++)
+		{
+			nAcc += pVal[i];
+			if (nAcc >= nRank)
+				break;
+		}
+
+		uint64_t x0 = get_BucketMin(i);
+		return x0 + (get_BucketMax(i) - x0) / 2;
+	}
+
+	/////////////////////////////
+	// Registry
+	Registry& Registry::get()
+	{
+		static Registry s_Registry;
+		return s_Registry;
+	}
+
+	void Registry::AddInternal(Entry::Type t, const char* szName, const char* szHelp, const char* szLabels, const void* p)
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
+		m_vec.emplace_back();
+		Entry& e = m_vec.back();
+		e.m_Type = t;
+		e.m_szName = szName;
+		e.m_szHelp = szHelp;
+		if (szLabels)
+			e.m_sLabels = szLabels;
+		e.m_pObj = p;
+	}
+
+	void Registry::Add(const char* szName, const char* szHelp, const Counter& x, const char* szLabels /* = nullptr */)
+	{
+		AddInternal(Entry::Type::Counter, szName, szHelp, szLabels, &x);
+	}
+
+	void Registry::Add(const char* szName, const char* szHelp, const Gauge& x, const char* szLabels /* = nullptr */)
+	{
+		AddInternal(Entry::Type::Gauge, szName, szHelp, szLabels, &x);
+	}
+
+	void Registry::Add(const char* szName, const char* szHelp, const Histogram& x, const char* szLabels /* = nullptr */)
+	{
+		AddInternal(Entry::Type::Histogram, szName, szHelp, szLabels, &x);
+	}
+
+	namespace
+	{
+		void WriteLabels(std::ostream& os, const std::string& sLabels, const char* szExtra = nullptr)
+		{
+			if (sLabels.empty() && !szExtra)
+				return;
+
+			os << '{' << sLabels;
+			if (szExtra)
+			{
+				if (!sLabels.empty())
+					os << ',';
+				os << szExtra;
+			}
+			os << '}';
+		}
+	}
+
+	void Registry::Write(std::ostream& os) const
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
+		const char* szPrev = nullptr;
+		for (const Entry& e : m_vec)
+		{
+			if (!szPrev || strcmp(szPrev, e.m_szName))
+			{
+				szPrev = e.m_szName;
+
+				if (e.m_szHelp)
+					os << "# HELP " << e.m_szName << ' ' << e.m_szHelp << '\n';
+
+				static const char* s_szTypes[] = { "counter", "gauge", "summary" };
+				os << "# TYPE " << e.m_szName << ' ' << s_szTypes[static_cast<int>(e.m_Type)] << '\n';
+			}
+
+			switch (e.m_Type)
+			{
+			case Entry::Type::Counter:
+				os << e.m_szName;
+				WriteLabels(os, e.m_sLabels);
+				os << ' ' << static_cast<const Counter*>(e.m_pObj)->get() << '\n';
+				break;
+
+			case Entry::Type::Gauge:
+				os << e.m_szName;
+				WriteLabels(os, e.m_sLabels);
+				os << ' ' << static_cast<const Gauge*>(e.m_pObj)->get() << '\n';
+				break;
+
+			case Entry::Type::Histogram:
+				{
+					const Histogram& h = *static_cast<const Histogram*>(e.m_pObj);
+
+					static const char* s_szQ[] = { "0.5", "0.9", "0.99", "0.999" };
+					static const double s_pQ[] = { 0.5, 0.9, 0.99, 0.999 };
+
+					for (size_t i = 0; i < _countof(s_pQ); i++)
+					{
+						std::string sQ = std::string("quantile=\"") + s_szQ[i] + '"';
+						os << e.m_szName;
+						WriteLabels(os, e.m_sLabels, sQ.c_str());
+						os << ' ' << h.get_Quantile(s_pQ[i]) << '\n';
+					}
+
+					os << e.m_szName << "_sum";
+					WriteLabels(os, e.m_sLabels);
+					os << ' ' << h.get_Sum() << '\n';
+
+					os << e.m_szName << "_count";
+					WriteLabels(os, e.m_sLabels);
+					os << ' ' << h.get_Count() << '\n';
+				}
+				break;
+			}
+		}
+	}
+
+	std::string Registry::Write() const
+	{
+		std::ostringstream os;
+		Write(os);
+		return os.str();
+	}
+
+} // namespace metrics
+} // namespace beam
@@ -0,0 +1,133 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "common.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace beam {
+namespace metrics
+{
+	// All the updates are lock-free (relaxed atomics), safe to call from any thread.
+	// Reading is not synchronized with updates, the snapshot may be slightly inconsistent.
+
+	struct Counter
+	{
+		std::atomic<uint64_t> m_Value;
+
+		Counter() :m_Value(0) {}
+
+		void Inc(uint64_t n = 1) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+		uint64_t get() const { return m_Value.load(std::memory_order_relaxed); }
+	};
+
+	struct Gauge
+	{
+		std::atomic<int64_t> m_Value;
+
+		Gauge() :m_Value(0) {}
+
+		void Set(int64_t n) { m_Value.store(n, std::memory_order_relaxed); }
+		void Add(int64_t n) { m_Value.fetch_add(n, std::memory_order_relaxed); }
+		int64_t get() const { return m_Value.load(std::memory_order_relaxed); }
+	};
+
+	// Log-linear histogram (HDR-style). Values below s_Linear are exact, above - each power of 2
+	// is split into s_SubBuckets buckets, i.e. the relative error is below 1/s_SubBuckets.
+	struct Histogram
+	{
+		static const uint32_t s_SubBits = 3;
+		static const uint32_t s_SubBuckets = 1U << s_SubBits;
+		static const uint32_t s_Linear = s_SubBuckets * 2;
+		static const uint32_t s_MaxBits = 40; // larger values are clamped
+		static const uint32_t s_Buckets = s_Linear + (s_MaxBits - s_SubBits - 1) * s_SubBuckets;
+
+		std::atomic<uint64_t> m_pBucket[s_Buckets];
+		Counter m_Count;
+		Counter m_Sum;
+
+		Histogram();
+
+		void Add(uint64_t);
+		void Reset();
+
+		uint64_t get_Count() const { return m_Count.get(); }
+		uint64_t get_Sum() const { return m_Sum.get(); }
+		uint64_t get_Quantile(double) const; // returns the middle of the appropriate bucket, 0 if empty
+
+		static uint32_t get_Bucket(uint64_t);
+		static uint64_t get_BucketMin(uint32_t);
+		static uint64_t get_BucketMax(uint32_t); // exclusive
+	};
+
+	struct Stopwatch
+	{
+		typedef std::chrono::steady_clock Clock;
+		Clock::time_point m_t0;
+
+		Stopwatch() :m_t0(Clock::now()) {}
+
+		uint64_t get_us() const {
+			return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_t0).count();
+		}
+	};
+
+	// Measures the lifetime of the object in microseconds
+	struct Timer
+		:public Stopwatch
+	{
+		Histogram& m_Hist;
+
+		Timer(Histogram& h) :m_Hist(h) {}
+		~Timer() { m_Hist.Add(get_us()); }
+	};
+
+	// Registered metrics must stay alive as long as the registry may be written (typically - static objects).
+	// Metrics with the same name and different labels must be added consecutively.
+	class Registry
+	{
+		struct Entry
+		{
+			enum struct Type { Counter, Gauge, Histogram };
+
+			Type m_Type;
+			const char* m_szName;
+			const char* m_szHelp;
+			std::string m_sLabels; // inner part, without braces
+			const void* m_pObj;
+		};
+
+		mutable std::mutex m_Mutex;
+		std::vector<Entry> m_vec;
+
+		void AddInternal(Entry::Type, const char* szName, const char* szHelp, const char* szLabels, const void*);
+
+	public:
+		static Registry& get();
+
+		void Add(const char* szName, const char* szHelp, const Counter&, const char* szLabels = nullptr);
+		void Add(const char* szName, const char* szHelp, const Gauge&, const char* szLabels = nullptr);
+		void Add(const char* szName, const char* szHelp, const Histogram&, const char* szLabels = nullptr);
+
+		// Text exposition format (prometheus-compatible). Histograms are exposed as summaries (quantiles, sum, count)
+		void Write(std::ostream&) const;
+		std::string Write() const;
+	};
+
+} // namespace metrics
+} // namespace beam
@@ -0,0 +1,154 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/arena.h"
+#include "utility/test_helpers.h"
+#include "core/block_crypt.h"
+#include "core/serialization_adapters.h"
+#include <thread>
+#include <cstring>
+#include <assert.h>
+
+using namespace beam;
+using namespace std;
+
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+
+struct Obj {
+    BEAM_ARENA_ALLOCATED
+    uint64_t m_pVal[5];
+};
+
+void test_scope() {
+#ifndef NDEBUG
+    Arena::Stats& s = Arena::s_Stats;
+    uint64_t nHeap = s.m_AllocsHeap.get(), nArena = s.m_Allocs.get(), nChunks = s.m_Chunks.get();
+#endif // NDEBUG
+
+    unique_ptr<Obj> p0(new Obj);
+#ifndef NDEBUG
+    CHECK(s.m_AllocsHeap.get() == nHeap + 1);
+#endif // NDEBUG
+
+    vector<unique_ptr<Obj> > v;
+    {
+        Arena::Scope scope;
+        for (uint32_t i = 0; i < 10000; i++) {
+            v.emplace_back(new Obj);
+            v.back()->m_pVal[0] = i;
+            CHECK(!(reinterpret_cast<uintptr_t>(v.back().get()) & 0xf)); // aligned
+        }
+
+        {
+            Arena::Scope scope2; // nested
+            unique_ptr<Obj> p1(new Obj);
+        }
+
+        unique_ptr<uint8_t> p2(static_cast<uint8_t*>(Arena::Allocate(Arena::s_ObjMax))); // too large
+        Arena::Free(p2.release());
+    }
+
+#ifndef NDEBUG
+    CHECK(s.m_Allocs.get() == nArena + 10001);
+    CHECK(s.m_AllocsHeap.get() == nHeap + 2);
+    uint64_t nUsed = s.m_Chunks.get() - nChunks;
+    CHECK((nUsed > 1) && (nUsed < 20));
+#endif // NDEBUG
+
+    // objects outlive the scope
+    for (uint32_t i = 0; i < v.size(); i++)
+        CHECK(v[i]->m_pVal[0] == i);
+
+    // released from different threads
+    std::thread pThread[2];
+    for (uint32_t i = 0; i < _countof(pThread); i++)
+        pThread[i] = std::thread([&v, i]() {
+            for (size_t j = i; j < v.size(); j += _countof(pThread))
+                v[j].reset();
+        });
+
+    for (uint32_t i = 0; i < _countof(pThread); i++)
+        pThread[i].join();
+}
+
+void benchmark_deserialize() {
+    Transaction txv;
+
+    for (uint32_t i = 0; i < 3000; i++) {
+        txv.m_vInputs.emplace_back(new Input);
+        txv.m_vOutputs.emplace_back(new Output);
+        txv.m_vOutputs.back()->m_pConfidential.reset(new ECC::RangeProof::Confidential);
+        ZeroObject(*txv.m_vOutputs.back()->m_pConfidential);
+        txv.m_vKernels.emplace_back(new TxKernelStd);
+    }
+
+    Serializer ser;
+    ser & txv;
+    ByteBuffer buf;
+    ser.swap_buf(buf);
+
+    const uint32_t nIterations = 20;
+
+    for (int iArena = 0; iArena < 2; iArena++) {
+#ifndef NDEBUG
+        uint64_t nHeap = Arena::s_Stats.m_AllocsHeap.get(), nArena = Arena::s_Stats.m_Allocs.get(), nChunks = Arena::s_Stats.m_Chunks.get();
+#endif // NDEBUG
+
+        helpers::StopWatch sw;
+        sw.start();
+
+        for (uint32_t i = 0; i < nIterations; i++) {
+            std::unique_ptr<Arena::Scope> pScope;
+            if (iArena)
+                pScope.reset(new Arena::Scope);
+
+            Transaction txv2;
+            Deserializer der;
+            der.reset(buf);
+            der & txv2;
+
+            CHECK(txv2.m_vOutputs.size() == txv.m_vOutputs.size());
+            pScope.reset();
+        }
+
+        sw.stop();
+        cout << "Deserialize 3K inputs/outputs/kernels, " << (iArena ? "arena" : "heap") << ": "
+            << sw.microseconds() / nIterations << " us per block" << endl;
+
+#ifndef NDEBUG
+        cout << "    " << (Arena::s_Stats.m_AllocsHeap.get() - nHeap) / nIterations << " heap allocations, "
+            << (Arena::s_Stats.m_Allocs.get() - nArena) / nIterations << " arena allocations in "
+            << (Arena::s_Stats.m_Chunks.get() - nChunks) / nIterations << " chunks" << endl;
+#endif // NDEBUG
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool bBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
+    test_scope();
+
+    if (bBenchmark)
+        benchmark_deserialize();
+    return error_count;
+}
@@ -14,7 +14,12 @@
 
 #include "utility/logger_checkpoints.h"
 #include "utility/helpers.h"
+#include "utility/test_helpers.h"
+#include <boost/filesystem.hpp>
 #include <thread>
+#include <vector>
+#include <fstream>
+#include <cstring>
 
 using namespace beam;
 
@@ -79,7 +84,115 @@ void test_ndc_2(bool exc)
     }
 }
 
-int main() {
+int g_failures = 0;
+
+void run_log_threads(unsigned nThreads, unsigned nMessages, std::vector<uint64_t>& vElapsed_us) {
+    vElapsed_us.assign(nThreads, 0);
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < nThreads; i++) {
+        threads.emplace_back([i, nMessages, &vElapsed_us]() {
+            helpers::StopWatch sw;
+            sw.start();
+            for (unsigned j = 0; j < nMessages; j++) {
+                LOG_INFO() << "Thread " << i << " message " << j << " some payload " << 0xabcdef;
+            }
+            sw.stop();
+            vElapsed_us[i] = sw.microseconds();
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+size_t count_lines(const Logger::FileNameType& fileName, size_t& nReports) {
+    std::ifstream fs(fileName);
+    size_t n = 0;
+    nReports = 0;
+    for (std::string line; std::getline(fs, line); ) {
+        if (line.find("async queue overflow") != std::string::npos) {
+            nReports++;
+        } else {
+            n++;
+        }
+    }
+    return n;
+}
+
+void test_logger_async() {
+    const unsigned nThreads = 4;
+    const unsigned nMessages = 1000;
+
+    Logger::FileNameType fileName;
+    uint64_t nDropped = 0;
+    {
+        auto logger = Logger::create(LOG_LEVEL_WARNING, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, "Zzzzz_async_", "", true);
+        fileName = logger->get_current_file_name();
+
+        std::vector<uint64_t> vElapsed_us;
+        run_log_threads(nThreads, nMessages, vElapsed_us);
+
+        nDropped = logger->get_dropped_count();
+    } // the logger flushes everything on destruction
+
+    size_t nReports = 0;
+    size_t nLines = count_lines(fileName, nReports);
+    size_t nExpected = nThreads * nMessages - nDropped;
+
+    if (nLines != nExpected) {
+        printf("async logger: %u lines expected, %u written\n", unsigned(nExpected), unsigned(nLines));
+        g_failures++;
+    }
+
+    // overflows are reported by the writer, possibly in several lines
+    if (nDropped ? !nReports : nReports) {
+        printf("async logger: %u dropped, %u overflow reports\n", unsigned(nDropped), unsigned(nReports));
+        g_failures++;
+    }
+
+    boost::filesystem::remove(fileName);
+}
+
+void benchmark_log_latency(bool async) {
+    const unsigned nThreads = 4;
+    const unsigned nMessages = 20000;
+
+    Logger::FileNameType fileName;
+    uint64_t nDropped = 0;
+    std::vector<uint64_t> vElapsed_us;
+
+    helpers::StopWatch sw;
+    sw.start();
+    {
+        // flush on each message, as the node does
+        auto logger = Logger::create(LOG_LEVEL_DEBUG, LOG_SINK_DISABLED, LOG_LEVEL_DEBUG, "Zzzzz_bench_", "", async);
+        fileName = logger->get_current_file_name();
+
+        run_log_threads(nThreads, nMessages, vElapsed_us);
+        nDropped = logger->get_dropped_count();
+    }
+    sw.stop();
+
+    uint64_t total_us = 0;
+    for (uint64_t x : vElapsed_us) {
+        total_us += x;
+    }
+
+    printf("%s logger, %u threads: %.3f us per call, total %u ms (including drain), dropped %u\n",
+        async ? "Async" : "Sync",
+        nThreads,
+        double(total_us) / (nThreads * nMessages),
+        unsigned(sw.milliseconds()),
+        unsigned(nDropped));
+
+    boost::filesystem::remove(fileName);
+}
+
+int main(int argc, char* argv[]) {
+    bool bBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
     test_logger_1();
     test_ndc_1();
     test_ndc_2(false);
@@ -87,4 +200,13 @@ int main() {
         test_ndc_2(true);
     }
     catch(...) {}
+
+    test_logger_async();
+
+    if (bBenchmark) {
+        benchmark_log_latency(false);
+        benchmark_log_latency(true);
+    }
+
+    return g_failures ? -1 : 0;
 }
@@ -0,0 +1,158 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/metrics.h"
+#include "utility/test_helpers.h"
+#include <thread>
+#include <cstring>
+#include <assert.h>
+
+using namespace beam;
+using namespace std;
+
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+
+void test_buckets() {
+    typedef metrics::Histogram H;
+
+    // buckets are contiguous and monotonic
+    for (uint32_t i = 0; i + 1 < H::s_Buckets; i++) {
+        CHECK(H::get_BucketMax(i) == H::get_BucketMin(i + 1));
+        CHECK(H::get_Bucket(H::get_BucketMin(i)) == i);
+        CHECK(H::get_Bucket(H::get_BucketMax(i) - 1) == i);
+    }
+
+    // relative error is bounded
+    for (uint64_t x = 1; x < (1ULL << H::s_MaxBits); x = x * 3 + 1) {
+        uint32_t i = H::get_Bucket(x);
+        uint64_t w = H::get_BucketMax(i) - H::get_BucketMin(i);
+        CHECK(w * H::s_SubBuckets <= x || w == 1);
+    }
+
+    CHECK(H::get_Bucket(uint64_t(-1)) == H::s_Buckets - 1);
+}
+
+void test_quantiles() {
+    metrics::Histogram h;
+    CHECK(!h.get_Quantile(0.5));
+
+    for (uint64_t i = 1; i <= 10000; i++)
+        h.Add(i);
+
+    CHECK(h.get_Count() == 10000);
+    CHECK(h.get_Sum() == 10000ULL * 10001 / 2);
+
+    static const double pQ[] = { 0.1, 0.5, 0.9, 0.99 };
+    for (double q : pQ) {
+        double x = static_cast<double>(h.get_Quantile(q));
+        double x0 = q * 10000;
+        CHECK((x > x0 * 0.85) && (x < x0 * 1.15));
+    }
+
+    h.Reset();
+    CHECK(!h.get_Count());
+}
+
+void test_concurrent() {
+    metrics::Counter c;
+    metrics::Histogram h;
+
+    const int nThreads = 4, nIterations = 100000;
+    std::thread pThread[nThreads];
+
+    for (int i = 0; i < nThreads; i++)
+        pThread[i] = std::thread([&]() {
+            for (int j = 0; j < nIterations; j++) {
+                c.Inc();
+                h.Add(j);
+            }
+        });
+
+    for (int i = 0; i < nThreads; i++)
+        pThread[i].join();
+
+    CHECK(c.get() == nThreads * nIterations);
+    CHECK(h.get_Count() == nThreads * nIterations);
+}
+
+void test_registry() {
+    static metrics::Counter s_Counter1, s_Counter2;
+    static metrics::Gauge s_Gauge;
+    static metrics::Histogram s_Hist;
+
+    metrics::Registry& r = metrics::Registry::get();
+    r.Add("test_counter", "Test counter", s_Counter1, "k=\"a\"");
+    r.Add("test_counter", nullptr, s_Counter2, "k=\"b\"");
+    r.Add("test_gauge", nullptr, s_Gauge);
+    r.Add("test_hist", "Test histogram", s_Hist);
+
+    s_Counter1.Inc(5);
+    s_Gauge.Set(-3);
+    s_Hist.Add(7);
+
+    std::string s = r.Write();
+    cout << s;
+
+    CHECK(s.find("# TYPE test_counter counter\n") != std::string::npos);
+    CHECK(s.find("# TYPE test_counter", s.find("# TYPE test_counter") + 1) == std::string::npos);
+    CHECK(s.find("test_counter{k=\"a\"} 5\n") != std::string::npos);
+    CHECK(s.find("test_counter{k=\"b\"} 0\n") != std::string::npos);
+    CHECK(s.find("test_gauge -3\n") != std::string::npos);
+    CHECK(s.find("# TYPE test_hist summary\n") != std::string::npos);
+    CHECK(s.find("test_hist{quantile=\"0.5\"} 7\n") != std::string::npos);
+    CHECK(s.find("test_hist_count 1\n") != std::string::npos);
+}
+
+void benchmark_histogram() {
+    metrics::Histogram h;
+    const uint32_t n = 10000000;
+
+    helpers::StopWatch sw;
+    sw.start();
+
+    for (uint32_t i = 0; i < n; i++)
+        h.Add(i);
+
+    sw.stop();
+    cout << "Histogram::Add: " << sw.microseconds() * 1000.0 / n << " ns per call" << endl;
+
+    sw.start();
+    for (uint32_t i = 0; i < n / 10; i++)
+        metrics::Timer tm(h);
+
+    sw.stop();
+    cout << "Timer: " << sw.microseconds() * 10000.0 / n << " ns per call" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool bBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
+    test_buckets();
+    test_quantiles();
+    test_concurrent();
+    test_registry();
+
+    if (bBenchmark)
+        benchmark_histogram();
+    return error_count;
+}
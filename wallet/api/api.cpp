@@ -933,6 +933,34 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
             {
                 offersList.filter.showAll = true;
             }
+
+            if (params["filter"].is_object() && existsJsonParam(params["filter"], "swap_coin"))
+            {
+                const auto& coin = params["filter"]["swap_coin"];
+                if (!coin.is_string() || from_string(coin) == AtomicSwapCoin::Unknown)
+                {
+                    throwIncorrectCurrencyError("swap_coin", id);
+                }
+                offersList.filter.coin = from_string(coin);
+            }
+        }
+
+        if (existsJsonParam(params, "count"))
+        {
+            if (params["count"] > 0)
+            {
+                offersList.count = params["count"];
+            }
+            else throw jsonrpc_exception{ ApiError::InvalidJsonRpc, "Invalid 'count' parameter.", id };
+        }
+
+        if (existsJsonParam(params, "skip"))
+        {
+            if (params["skip"] >= 0)
+            {
+                offersList.skip = params["skip"];
+            }
+            else throw jsonrpc_exception{ ApiError::InvalidJsonRpc, "Invalid 'skip' parameter.", id };
         }
 
         getHandler().onMessage(id, offersList);
@@ -1179,19 +1207,26 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
 
         for (auto& addr : res.list)
         {
-            msg["result"].push_back(
-            {
-                {"address", std::to_string(addr.m_walletID)},
-                {"comment", addr.m_label},
-                {"category", addr.m_category},
-                {"create_time", addr.getCreateTime()},
-                {"duration", addr.m_duration},
-                {"expired", addr.isExpired()},
-                {"own", addr.isOwn()}
-            });
+            json item;
+            getAddressJson(addr, item);
+            msg["result"].push_back(std::move(item));
         }
     }
 
+    void WalletApi::getAddressJson(const WalletAddress& addr, json& item)
+    {
+        item = json
+        {
+            {"address", std::to_string(addr.m_walletID)},
+            {"comment", addr.m_label},
+            {"category", addr.m_category},
+            {"create_time", addr.getCreateTime()},
+            {"duration", addr.m_duration},
+            {"expired", addr.isExpired()},
+            {"own", addr.isOwn()}
+        };
+    }
+
     void WalletApi::getResponse(const JsonRpcId& id, const ValidateAddress::Response& res, json& msg)
     {
         msg = json
@@ -1218,24 +1253,46 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
 
         for (auto& utxo : res.utxos)
         {
-            std::string createTxId = utxo.m_createTxId.is_initialized() ? TxIDToString(*utxo.m_createTxId) : "";
-            std::string spentTxId = utxo.m_spentTxId.is_initialized() ? TxIDToString(*utxo.m_spentTxId) : "";
-
-            msg["result"].push_back(
-            { 
-                {"id", utxo.toStringID()},
-                {"amount", utxo.m_ID.m_Value},
-                {"type", (const char*)FourCC::Text(utxo.m_ID.m_Type)},
-                {"maturity", utxo.get_Maturity()},
-                {"createTxId", createTxId},
-                {"spentTxId", spentTxId},
-                {"status", utxo.m_status},
-                {"status_string", utxo.getStatusString()},
-                {"session", utxo.m_sessionId}
-            });
+            json item;
+            getUtxoJson(utxo, item);
+            msg["result"].push_back(std::move(item));
         }
     }
 
+    void WalletApi::getUtxoJson(const Coin& utxo, json& item)
+    {
+        std::string createTxId = utxo.m_createTxId.is_initialized() ? TxIDToString(*utxo.m_createTxId) : "";
+        std::string spentTxId = utxo.m_spentTxId.is_initialized() ? TxIDToString(*utxo.m_spentTxId) : "";
+
+        item = json
+        {
+            {"id", utxo.toStringID()},
+            {"amount", utxo.m_ID.m_Value},
+            {"type", (const char*)FourCC::Text(utxo.m_ID.m_Type)},
+            {"maturity", utxo.get_Maturity()},
+            {"createTxId", createTxId},
+            {"spentTxId", spentTxId},
+            {"status", utxo.m_status},
+            {"status_string", utxo.getStatusString()},
+            {"session", utxo.m_sessionId}
+        };
+    }
+
+    void WalletApi::beginListResponse(JsonStreamWriter& writer, const JsonRpcId& id)
+    {
+        writer.begin_object();
+        writer.member(JsonRpcHrd, JsonRpcVerHrd);
+        writer.member("id", id);
+        writer.key("result");
+        writer.begin_array();
+    }
+
+    void WalletApi::endListResponse(JsonStreamWriter& writer)
+    {
+        writer.end_array();
+        writer.end_object();
+    }
+
     void WalletApi::getResponse(const JsonRpcId& id, const Send::Response& res, json& msg)
     {
         msg = json
@@ -21,6 +21,7 @@
 #include "wallet/client/extensions/offers_board/swap_offer.h"
 #endif  // BEAM_ATOMIC_SWAP_SUPPORT
 #include "nlohmann/json.hpp"
+#include "utility/io/json_serializer.h"
 
 namespace beam::wallet
 {
@@ -134,7 +135,12 @@ namespace beam::wallet
         {
             boost::optional<SwapOfferStatus> status;
             boost::optional<bool> showAll;
+            boost::optional<AtomicSwapCoin> coin;
         } filter;
+
+        int count = 0;
+        int skip = 0;
+
         struct Response
         {
             std::vector<WalletAddress> addrList;
@@ -472,6 +478,14 @@ namespace beam::wallet
 
 #undef RESPONSE_FUNC
 
+        // Streamed list responses: the items are written between begin and end one by one,
+        // without building the whole json document
+        static void beginListResponse(JsonStreamWriter& writer, const JsonRpcId& id);
+        static void endListResponse(JsonStreamWriter& writer);
+
+        static void getAddressJson(const WalletAddress& addr, json& item);
+        static void getUtxoJson(const Coin& utxo, json& item);
+
     private:
         IWalletApiHandler& getHandler() const;
 
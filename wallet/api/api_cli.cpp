@@ -452,6 +452,20 @@ private:
             serialize_json_msg(_lineProtocol, msg);
         }
 
+        bool serializeMsgStream(const StreamFunc& func) override
+        {
+            // the line is sent only once it's complete, otherwise the client would get a malformed one
+            std::string buf;
+            if (!bufferMsgStream(func, buf))
+                return false;
+
+            static const char eol = 10;
+            _lineProtocol.write(buf.data(), buf.size());
+            _lineProtocol.write(&eol, 1);
+            _lineProtocol.finalize();
+            return true;
+        }
+
         void on_write(io::SharedBuffer&& msg)
         {
             _stream->write(msg);
@@ -526,6 +540,34 @@ private:
             _keepalive = send(_connection, 200, "OK");
         }
 
+        bool serializeMsgStream(const StreamFunc& func) override
+        {
+            // the body is sent after it's complete
+            size_t initialFragments = _body.size();
+            bool ok = false;
+            try
+            {
+                JsonStreamWriter writer(_packer.acquire_writer(_body));
+                func(writer);
+                ok = writer.finalize();
+            }
+            catch (const std::exception& e)
+            {
+                LOG_ERROR() << "response stream: " << e.what();
+            }
+
+            _packer.release_writer();
+
+            if (!ok)
+            {
+                _body.resize(initialFragments);
+                return false;
+            }
+
+            _keepalive = send(_connection, 200, "OK");
+            return true;
+        }
+
     private:
 
         bool on_request(uint64_t id, const HttpMsgReader::Message& msg)
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "api_connection.h"
+#include "wallet/core/common_utils.h"
 
 #include "wallet/core/simple_transaction.h"
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
@@ -79,20 +80,12 @@ bool checkIsEnoughtSwapAmount(
 }
 
 boost::optional<SwapOffer> getOfferFromBoardByTxId(
-    const std::vector<SwapOffer>& board, const TxID& txId)
+    const SwapOffersBoard& board, const TxID& txId)
 {
-    auto it = std::find_if(
-        board.begin(), board.end(),
-        [txId] (const SwapOffer& publicOffer)
-        {
-            auto publicTxId = publicOffer.GetTxID();
-            if (publicTxId)
-                return txId == *publicTxId;
-            return false;
-        });
-    if (it != board.end())
-        return *it;
-    
+    auto offer = board.getOffer(txId);
+    if (offer && offer->m_status == SwapOfferStatus::Pending)
+        return offer;
+
     return boost::optional<SwapOffer>();
 }
 
@@ -173,6 +166,38 @@ void ApiConnection::doError(const JsonRpcId& id, ApiError code, const std::strin
     serializeMsg(msg);
 }
 
+bool ApiConnection::bufferMsgStream(const StreamFunc& func, std::string& out)
+{
+    try
+    {
+        JsonStreamWriter writer(out);
+        func(writer);
+        return writer.finalize();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR() << "response stream: " << e.what();
+    }
+
+    return false;
+}
+
+bool ApiConnection::serializeMsgStream(const StreamFunc& func)
+{
+    std::string buf;
+    if (!bufferMsgStream(func, buf))
+        return false;
+
+    serializeMsg(json::parse(buf));
+    return true;
+}
+
+void ApiConnection::doResponseStream(const JsonRpcId& id, const StreamFunc& func)
+{
+    if (!serializeMsgStream(func))
+        doError(id, ApiError::InternalErrorJsonRpc, "Failed to build the response.");
+}
+
 void ApiConnection::onInvalidJsonRpc(const json& msg)
 {
     LOG_DEBUG() << "onInvalidJsonRpc: " << msg;
@@ -268,7 +293,19 @@ void ApiConnection::onMessage(const JsonRpcId& id, const AddrList& data)
 {
     LOG_DEBUG() << "AddrList(id = " << id << ")";
 
-    doResponse(id, AddrList::Response{ _walletData.getWalletDB()->getAddresses(data.own) });
+    auto walletDB = _walletData.getWalletDB();
+    doResponseStream(id, [&](JsonStreamWriter& writer)
+    {
+        WalletApi::beginListResponse(writer, id);
+        walletDB->visitAddresses(data.own, [&writer](const WalletAddress& addr)
+        {
+            json item;
+            WalletApi::getAddressJson(addr, item);
+            writer.value(item);
+            return true;
+        });
+        WalletApi::endListResponse(writer);
+    });
 }
 
 void ApiConnection::onMessage(const JsonRpcId& id, const ValidateAddress& data)
@@ -554,16 +591,21 @@ void ApiConnection::onMessage(const JsonRpcId& id, const GetUtxo& data)
 {
     LOG_DEBUG() << "GetUtxo(id = " << id << ")";
 
-    GetUtxo::Response response;
-    _walletData.getWalletDB()->visitCoins([&response](const Coin& c)->bool
+    auto walletDB = _walletData.getWalletDB();
+    Pagination page(data.skip, data.count);
+
+    doResponseStream(id, [&](JsonStreamWriter& writer)
     {
-        response.utxos.push_back(c);
-        return true;
+        WalletApi::beginListResponse(writer, id);
+        walletDB->visitCoins([&writer](const Coin& c)->bool
+        {
+            json item;
+            WalletApi::getUtxoJson(c, item);
+            writer.value(item);
+            return true;
+        }, page.skip, page.count);
+        WalletApi::endListResponse(writer);
     });
-
-    doPagination(data.skip, data.count, response.utxos);
-
-    doResponse(id, response);
 }
 
 void ApiConnection::onMessage(const JsonRpcId& id, const WalletStatus& data)
@@ -632,57 +674,34 @@ void ApiConnection::onMessage(const JsonRpcId& id, const TxList& data)
 {
     LOG_DEBUG() << "List(filter.status = " << (data.filter.status ? std::to_string((uint32_t)*data.filter.status) : "nul") << ")";
 
-    TxList::Response res;
-
-    {
-        auto walletDB = _walletData.getWalletDB();
-        auto txList = walletDB->getTxHistory();
-
-        Block::SystemState::ID stateID = {};
-        _walletData.getWalletDB()->getSystemStateID(stateID);
-
-        for (const auto& tx : txList)
-        {
-            Status::Response item;
-            item.tx = tx;
-            item.kernelProofHeight = 0;
-            item.systemHeight = stateID.m_Height;
-            item.confirmations = 0;
-
-            storage::getTxParameter(*walletDB, tx.m_txId, TxParameterID::KernelProofHeight, item.kernelProofHeight);
-            res.resultList.push_back(item);
-        }
-    }
-
-    using Result = decltype(res.resultList);
+    auto walletDB = _walletData.getWalletDB();
 
-    // filter transactions by status if provided
-    if (data.filter.status)
-    {
-        Result filteredList;
+    TxHistoryFilter filter;
+    filter.m_Status = data.filter.status;
+    filter.m_KernelProofHeight = data.filter.height;
 
-        for (const auto& it : res.resultList)
-            if (it.tx.m_status == *data.filter.status)
-                filteredList.push_back(it);
+    Pagination page(data.skip, data.count);
+    auto txList = walletDB->getTxHistory(filter, page.skip, page.count ? static_cast<int>(page.count) : std::numeric_limits<int>::max());
 
-        res.resultList = filteredList;
-    }
+    Block::SystemState::ID stateID = {};
+    walletDB->getSystemStateID(stateID);
 
-    // filter transactions by height if provided
-    if (data.filter.height)
+    doResponseStream(id, [&](JsonStreamWriter& writer)
     {
-        Result filteredList;
-
-        for (const auto& it : res.resultList)
-            if (it.kernelProofHeight == *data.filter.height)
-                filteredList.push_back(it);
+        WalletApi::beginListResponse(writer, id);
 
-        res.resultList = filteredList;
-    }
+        for (const auto& tx : txList)
+        {
+            Height kernelProofHeight = 0;
+            storage::getTxParameter(*walletDB, tx.m_txId, TxParameterID::KernelProofHeight, kernelProofHeight);
 
-    doPagination(data.skip, data.count, res.resultList);
+            json item;
+            GetStatusResponseJson(tx, item, kernelProofHeight, stateID.m_Height);
+            writer.value(item);
+        }
 
-    doResponse(id, res);
+        WalletApi::endListResponse(writer);
+    });
 }
 
 #ifdef BEAM_ATOMIC_SWAP_SUPPORT
@@ -691,28 +710,37 @@ void ApiConnection::onMessage(const JsonRpcId& id, const OffersList& data)
     bool showAll = data.filter.showAll && *data.filter.showAll;
     bool filter = data.filter.status.is_initialized();
     SwapOfferStatus filterStatus = SwapOfferStatus::Completed;
-    
+
+    const auto& board = _walletData.getAtomicSwapProvider().getSwapOffersBoard();
+    SwapOffersBoard::Filter boardFilter;
+    boardFilter.coin = data.filter.coin;
+
+    // public offers go first, in the board index order, then own swaps which are not on the board
+    size_t skip = data.skip;
+    size_t count = data.count;
+
     std::vector<SwapOffer> offers;
+    bool withBoard = !filter || (*data.filter.status != SwapOfferStatus::Pending);
     if (filter)
     {
         filterStatus = *data.filter.status;
-        if (filterStatus != SwapOfferStatus::Pending)
-        {
-            offers = _walletData.getAtomicSwapProvider().getSwapOffersBoard().getOffersList();
-        }
     }
-    else
+
+    if (withBoard)
     {
-        offers = _walletData.getAtomicSwapProvider().getSwapOffersBoard().getOffersList();
+        size_t boardCount = board.getOffersCount(boardFilter);
+        offers = board.getOffersList(boardFilter, skip, count);
+        skip = (skip > boardCount) ? (skip - boardCount) : 0;
     }
 
     auto walletDB = _walletData.getWalletDB();
 
     auto swapTxs = walletDB->getTxHistory(TxType::AtomicSwap);
-    offers.reserve(offers.size() + swapTxs.size());
-    
     for (const auto& tx : swapTxs)
     {
+        if (count && offers.size() >= count)
+            break;
+
         SwapOffer offer(tx);
 
         if (!showAll)
@@ -730,15 +758,27 @@ void ApiConnection::onMessage(const JsonRpcId& id, const OffersList& data)
             }
         }
 
-        const auto it = std::find_if(
-            offers.begin(),
-            offers.end(),
-            [&offer] (const SwapOffer& offerFromBoard) {
-                return offer.m_txId == offerFromBoard.m_txId;
-            });
+        if (data.filter.coin && offer.swapCoinType() != *data.filter.coin)
+            continue;
+
+        if (withBoard)
+        {
+            auto offerFromBoard = board.getOffer(offer.m_txId);
+            if (offerFromBoard &&
+                offerFromBoard->m_status == boardFilter.status &&
+                (!boardFilter.coin || offerFromBoard->swapCoinType() == *boardFilter.coin))
+            {
+                continue; // already listed
+            }
+        }
+
+        if (skip)
+        {
+            --skip;
+            continue;
+        }
 
-        if (it == offers.end())
-            offers.push_back(offer);
+        offers.push_back(offer);
     }
 
     doResponse(
@@ -863,7 +903,7 @@ void ApiConnection::onMessage(const JsonRpcId& id, const AcceptOffer & data)
         throw FailToParseToken();
 
     auto publicOffer = getOfferFromBoardByTxId(
-        _walletData.getAtomicSwapProvider().getSwapOffersBoard().getOffersList(), *txId);
+        _walletData.getAtomicSwapProvider().getSwapOffersBoard(), *txId);
 
     auto walletDB = _walletData.getWalletDB();
 
@@ -984,7 +1024,7 @@ void ApiConnection::onMessage(const JsonRpcId& id, const OfferStatus& data)
         throw FailToParseToken();
 
     auto publicOffer = getOfferFromBoardByTxId(
-        _walletData.getAtomicSwapProvider().getSwapOffersBoard().getOffersList(), *txId);
+        _walletData.getAtomicSwapProvider().getSwapOffersBoard(), *txId);
 
     auto walletDB = _walletData.getWalletDB();
 
@@ -41,6 +41,19 @@ public:
 
     virtual void serializeMsg(const json& msg) = 0;
 
+    using StreamFunc = std::function<void(JsonStreamWriter& writer)>;
+
+    // Writes the (potentially large) response directly into the output.
+    // Returns false if the response could not be built, nothing is sent then.
+    // Default implementation buffers it and passes to serializeMsg
+    virtual bool serializeMsgStream(const StreamFunc& func);
+
+    // Builds the whole response text, catches the errors
+    static bool bufferMsgStream(const StreamFunc& func, std::string& out);
+
+    // Streams the response, or reports an internal error to the client
+    void doResponseStream(const JsonRpcId& id, const StreamFunc& func);
+
     template<typename T>
     void doResponse(const JsonRpcId& id, const T& response)
     {
@@ -64,24 +77,18 @@ public:
 
     void doTxAlreadyExistsError(const JsonRpcId& id);
 
-    template<typename T>
-    static void doPagination(size_t skip, size_t count, std::vector<T>& res)
+    // Pagination parameters as passed to the DB queries, count == 0 means no pagination
+    struct Pagination
     {
-        if (count > 0)
-        {
-            size_t start = skip;
-            size_t end = start + count;
-            size_t size = res.size();
-
-            if (start < size)
-            {
-                if (end > size) end = size;
+        size_t skip;
+        size_t count;
 
-                res = std::vector<T>(res.begin() + start, res.begin() + end);
-            }
-            else res = {};
+        Pagination(int skip_, int count_)
+            : skip(count_ > 0 && skip_ > 0 ? skip_ : 0)
+            , count(count_ > 0 ? count_ : 0)
+        {
         }
-    }
+    };
 
 protected:
     IWalletData& _walletData;
@@ -16,6 +16,8 @@
 
 #include "utility/logger.h"
 
+#include <limits>
+
 namespace beam::wallet
 {
 /**
@@ -51,7 +53,7 @@ bool SwapOffersBoard::onMessage(uint64_t unused, ByteBuffer&& msg)
             newOffer->m_status = SwapOfferStatus::Expired;
         }
         
-        m_offersCache[newOffer->m_txId] = *newOffer;
+        insertOffer(*newOffer);
 
         if (newOffer->m_status == SwapOfferStatus::Pending)
         {
@@ -65,14 +67,14 @@ bool SwapOffersBoard::onMessage(uint64_t unused, ByteBuffer&& msg)
     // Existing offer update
     else    
     {
-        SwapOfferStatus existingStatus = m_offersCache[newOffer->m_txId].m_status;
+        SwapOfferStatus existingStatus = it->second.m_status;
 
         // Normal case
         if (existingStatus == SwapOfferStatus::Pending)
         {
             if (newOffer->m_status != SwapOfferStatus::Pending)
             {
-                m_offersCache[newOffer->m_txId].m_status = newOffer->m_status;
+                setOfferStatus(it->second, newOffer->m_status);
                 notifySubscribers(ChangeAction::Removed, std::vector<SwapOffer>{*newOffer});
             }
         }
@@ -99,15 +101,21 @@ void SwapOffersBoard::onSystemStateChanged(const Block::SystemState::ID& stateID
 {
     m_currentHeight = stateID.m_Height;
 
-    for (auto& pair : m_offersCache)
+    std::vector<SwapOffer> expiredOffers;
+
+    // only the pending offers are tracked, the rest have to be already removed from board
+    while (!m_pendingExpiration.empty() && m_pendingExpiration.begin()->first <= m_currentHeight)
     {
-        auto& offer = pair.second;
-        if (offer.m_status != SwapOfferStatus::Pending) continue;    // have to be already removed from board
-        if (isOfferExpired(offer))
-        {
-            offer.m_status = SwapOfferStatus::Expired;
-            notifySubscribers(ChangeAction::Removed, std::vector<SwapOffer>{offer});
-        }
+        auto it = m_offersCache.find(m_pendingExpiration.begin()->second);
+        assert(it != m_offersCache.end());
+
+        setOfferStatus(it->second, SwapOfferStatus::Expired);
+        expiredOffers.push_back(it->second);
+    }
+
+    if (!expiredOffers.empty())
+    {
+        notifySubscribers(ChangeAction::Removed, expiredOffers);
     }
 }
 
@@ -116,15 +124,60 @@ void SwapOffersBoard::onSystemStateChanged(const Block::SystemState::ID& stateID
  *  are supposed to be invalid and expired by default.
  */
 bool SwapOffersBoard::isOfferExpired(const SwapOffer& offer) const
+{
+    return getExpiresHeight(offer) <= m_currentHeight;
+}
+
+Height SwapOffersBoard::getExpiresHeight(const SwapOffer& offer)
 {
     auto peerResponseTime = offer.GetParameter<Height>(TxParameterID::PeerResponseTime);
     auto minHeight = offer.GetParameter<Height>(TxParameterID::MinHeight);
-        if (peerResponseTime && minHeight)
-        {
-            auto expiresHeight = *minHeight + *peerResponseTime;
-        return expiresHeight <= m_currentHeight;
+    if (peerResponseTime && minHeight)
+    {
+        return *minHeight + *peerResponseTime;
+    }
+    return 0;
+}
+
+bool SwapOffersBoard::OfferKey::operator < (const OfferKey& other) const
+{
+    return std::tie(m_status, m_coin, m_expiresHeight, m_txId) < std::tie(other.m_status, other.m_coin, other.m_expiresHeight, other.m_txId);
+}
+
+SwapOffersBoard::OfferKey SwapOffersBoard::getOfferKey(const SwapOffer& offer)
+{
+    return OfferKey{ offer.m_status, offer.swapCoinType(), getExpiresHeight(offer), offer.m_txId };
+}
+
+void SwapOffersBoard::insertOffer(const SwapOffer& offer)
+{
+    auto& newOffer = m_offersCache[offer.m_txId] = offer;
+    OfferKey key = getOfferKey(newOffer);
+
+    m_offersIndex.insert(key);
+    if (newOffer.m_status == SwapOfferStatus::Pending)
+    {
+        m_pendingExpiration.emplace(key.m_expiresHeight, key.m_txId);
+    }
+}
+
+void SwapOffersBoard::setOfferStatus(SwapOffer& offer, SwapOfferStatus newStatus)
+{
+    OfferKey key = getOfferKey(offer);
+
+    m_offersIndex.erase(key);
+    if (offer.m_status == SwapOfferStatus::Pending)
+    {
+        m_pendingExpiration.erase(std::make_pair(key.m_expiresHeight, key.m_txId));
+    }
+
+    offer.m_status = key.m_status = newStatus;
+
+    m_offersIndex.insert(key);
+    if (newStatus == SwapOfferStatus::Pending)
+    {
+        m_pendingExpiration.emplace(key.m_expiresHeight, key.m_txId);
     }
-    else return true;
 }
 
 void SwapOffersBoard::onTransactionChanged(ChangeAction action, const std::vector<TxDescription>& items)
@@ -176,8 +229,8 @@ void SwapOffersBoard::updateOffer(const TxID& offerTxID, SwapOfferStatus newStat
 
         if (currentStatus == SwapOfferStatus::Pending)
         {
-            m_offersCache[offerTxID].m_status = newStatus;
-            notifySubscribers(ChangeAction::Removed, std::vector<SwapOffer>{m_offersCache[offerTxID]});
+            setOfferStatus(offerIt->second, newStatus);
+            notifySubscribers(ChangeAction::Removed, std::vector<SwapOffer>{offerIt->second});
             sendUpdateToNetwork(offerTxID, publisherId, coin, newStatus);
         }
     }
@@ -190,27 +243,71 @@ void SwapOffersBoard::updateOffer(const TxID& offerTxID, SwapOfferStatus newStat
         // will notify network about offer status change only
         // on receivng original 'pending-status' offer from network.
         SwapOffer incompleteOffer(offerTxID);
+        incompleteOffer.m_txId = offerTxID;
         incompleteOffer.m_status = newStatus;
-        m_offersCache[offerTxID] = incompleteOffer;
+        insertOffer(incompleteOffer);
     }
 }
 
 auto SwapOffersBoard::getOffersList() const -> std::vector<SwapOffer>
+{
+    return getOffersList(Filter());
+}
+
+auto SwapOffersBoard::getIndexRange(const Filter& filter) const -> std::pair<std::set<OfferKey>::const_iterator, std::set<OfferKey>::const_iterator>
+{
+    using CoinType = std::underlying_type_t<AtomicSwapCoin>;
+    OfferKey keyMin{ filter.status, static_cast<AtomicSwapCoin>(std::numeric_limits<CoinType>::min()), 0, {} };
+    OfferKey keyMax{ filter.status, static_cast<AtomicSwapCoin>(std::numeric_limits<CoinType>::max()), MaxHeight, {} };
+    keyMax.m_txId.fill(0xff);
+
+    if (filter.coin)
+    {
+        keyMin.m_coin = keyMax.m_coin = *filter.coin;
+    }
+
+    return std::make_pair(m_offersIndex.lower_bound(keyMin), m_offersIndex.upper_bound(keyMax));
+}
+
+auto SwapOffersBoard::getOffersList(const Filter& filter, size_t skip, size_t count) const -> std::vector<SwapOffer>
 {
     std::vector<SwapOffer> offers;
 
-    for (auto offer : m_offersCache)
+    auto range = getIndexRange(filter);
+    for (auto it = range.first; it != range.second; ++it)
     {
-        SwapOfferStatus status = offer.second.m_status;
-        if (status == SwapOfferStatus::Pending)
+        if (skip)
         {
-            offers.push_back(offer.second);
+            --skip;
+            continue;
+        }
+
+        offers.push_back(m_offersCache.at(it->m_txId));
+        if (offers.size() == count)
+        {
+            break;
         }
     }
 
     return offers;
 }
 
+size_t SwapOffersBoard::getOffersCount(const Filter& filter) const
+{
+    auto range = getIndexRange(filter);
+    return std::distance(range.first, range.second);
+}
+
+auto SwapOffersBoard::getOffer(const TxID& txId) const -> boost::optional<SwapOffer>
+{
+    auto it = m_offersCache.find(txId);
+    if (it != m_offersCache.end())
+    {
+        return it->second;
+    }
+    return boost::none;
+}
+
 void SwapOffersBoard::publishOffer(const SwapOffer& offer) const
 {
     auto swapCoin = offer.GetParameter<AtomicSwapCoin>(TxParameterID::AtomicSwapCoin);
@@ -278,7 +375,7 @@ void SwapOffersBoard::notifySubscribers(ChangeAction action, const std::vector<S
 {
     for (const auto sub : m_subscribers)
     {
-            sub->onSwapOffersChanged(action, std::vector<SwapOffer>{offers});
+            sub->onSwapOffersChanged(action, offers);
     }
 }
 
@@ -22,6 +22,7 @@
 #include "wallet/core/wallet.h"
 #include "utility/std_extension.h"
 
+#include <set>
 #include <unordered_map>
 
 namespace beam::wallet
@@ -38,6 +39,12 @@ class SwapOffersBoard
 public:
     using Ptr = std::shared_ptr<SwapOffersBoard>;
 
+    struct Filter
+    {
+        SwapOfferStatus status = SwapOfferStatus::Pending;
+        boost::optional<AtomicSwapCoin> coin;
+    };
+
     SwapOffersBoard(IBroadcastMsgGateway&, OfferBoardProtocolHandler&);
     virtual ~SwapOffersBoard() {};
 
@@ -58,6 +65,13 @@ public:
     virtual void onSystemStateChanged(const Block::SystemState::ID& stateID) override;
 
     auto getOffersList() const -> std::vector<SwapOffer>;
+    /**
+     *  Offers matching @filter, ordered by coin and expiration height.
+     *  @count == 0 means no limit.
+     */
+    auto getOffersList(const Filter& filter, size_t skip = 0, size_t count = 0) const -> std::vector<SwapOffer>;
+    size_t getOffersCount(const Filter& filter) const;
+    auto getOffer(const TxID& txId) const -> boost::optional<SwapOffer>;
     void publishOffer(const SwapOffer& offer) const;
 
     void Subscribe(ISwapOffersObserver* observer);
@@ -67,11 +81,29 @@ private:
     IBroadcastMsgGateway& m_broadcastGateway;
     OfferBoardProtocolHandler& m_protocolHandler;       /// handles message creating and parsing
 
+    /// Offers are ordered by status, coin and expiration height, so that any filter is a contiguous range
+    struct OfferKey
+    {
+        SwapOfferStatus m_status;
+        AtomicSwapCoin m_coin;
+        Height m_expiresHeight;
+        TxID m_txId;
+
+        bool operator < (const OfferKey& other) const;
+    };
+
     Height m_currentHeight = 0;
     std::unordered_map<TxID, SwapOffer> m_offersCache;
+    std::set<OfferKey> m_offersIndex;
+    std::set<std::pair<Height, TxID>> m_pendingExpiration;  /// pending offers only
     std::vector<ISwapOffersObserver*> m_subscribers;    /// used to notify subscribers about offers changes
 
+    static Height getExpiresHeight(const SwapOffer& offer);
+    static OfferKey getOfferKey(const SwapOffer& offer);
     bool isOfferExpired(const SwapOffer& offer) const;
+    void insertOffer(const SwapOffer& offer);
+    void setOfferStatus(SwapOffer& offer, SwapOfferStatus newStatus);
+    auto getIndexRange(const Filter& filter) const -> std::pair<std::set<OfferKey>::const_iterator, std::set<OfferKey>::const_iterator>;
     void sendUpdateToNetwork(const TxID&, const WalletID&, AtomicSwapCoin, SwapOfferStatus) const;
     void updateOffer(const TxID& offerTxID, SwapOfferStatus newStatus);
     void notifySubscribers(ChangeAction action, const std::vector<SwapOffer>& offers) const;
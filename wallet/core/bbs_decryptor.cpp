@@ -0,0 +1,90 @@
+// Copyright 2019 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bbs_decryptor.h"
+
+namespace beam::wallet
+{
+
+void BbsDecryptor::Stop()
+{
+    if (m_Thread.joinable())
+    {
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            m_Shutdown = true;
+            m_NewTask.notify_all();
+        }
+
+        m_Thread.join();
+    }
+
+    m_Pending.clear();
+    m_Done.clear();
+    m_pEvt.reset();
+}
+
+bool BbsDecryptor::Decrypt(Task& t)
+{
+    if (!t.m_pKeys || t.m_Msg.empty())
+        return false;
+
+    proto::Bbs::Decryptor dec;
+    if (!dec.Init(&t.m_Msg.front(), static_cast<uint32_t>(t.m_Msg.size())))
+        return false;
+
+    for (const Key& key : *t.m_pKeys)
+    {
+        if (dec.Decrypt(t.m_Plaintext, key.m_sk, key.m_Pk))
+        {
+            t.m_pKey = &key;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BbsDecryptor::Thread()
+{
+    while (true)
+    {
+        Task::Ptr pTask;
+
+        for (std::unique_lock<std::mutex> scope(m_Mutex); ; m_NewTask.wait(scope))
+        {
+            if (m_Shutdown)
+                return;
+
+            if (!m_Pending.empty())
+            {
+                pTask = std::move(m_Pending.front());
+                m_Pending.pop_front();
+                break;
+            }
+        }
+
+        if (!Decrypt(*pTask))
+            continue;
+
+        {
+            std::unique_lock<std::mutex> scope(m_Mutex);
+            m_Done.push_back(std::move(pTask));
+        }
+
+        m_pEvt->post();
+    }
+}
+
+}  // namespace beam::wallet
@@ -0,0 +1,76 @@
+// Copyright 2019 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/ecc_native.h"
+#include "core/proto.h"
+#include "utility/io/asyncevent.h"
+
+namespace beam::wallet
+{
+
+struct BbsDecryptor
+{
+    // incoming messages decryption. Single thread, so that the messages are delivered in the order of arrival
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_NewTask;
+
+    volatile bool m_Shutdown;
+    io::AsyncEvent::Ptr m_pEvt;
+
+    struct Key
+    {
+        ECC::Scalar::Native m_sk; // private addr
+        PeerID m_Pk; // self public addr
+    };
+
+    // Immutable snapshot of the keys subscribed to a channel, shared with the worker thread
+    typedef std::vector<Key> KeyList;
+
+    struct Task
+    {
+        BbsChannel m_Channel;
+        ByteBuffer m_Msg;
+        std::shared_ptr<const KeyList> m_pKeys;
+
+        // result
+        ByteBuffer m_Plaintext;
+        const Key* m_pKey = nullptr;
+
+        typedef std::unique_ptr<Task> Ptr;
+    };
+
+    typedef std::deque<Task::Ptr> TaskQueue;
+
+    TaskQueue m_Pending;
+    TaskQueue m_Done; // only successfully decrypted
+
+    BbsDecryptor() :m_Shutdown(false) {}
+    ~BbsDecryptor() { Stop(); }
+
+    void Stop();
+    void Thread();
+
+    static bool Decrypt(Task&);
+};
+}  // namespace beam::wallet
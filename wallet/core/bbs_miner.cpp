@@ -17,6 +17,55 @@
 namespace beam::wallet
 {
 
+BbsMiner::Metrics::Metrics()
+{
+    metrics::Registry& r = metrics::Registry::get();
+
+    r.Add("beam_wallet_bbs_hashes", "BBS mining hashes computed", m_Hashes);
+    r.Add("beam_wallet_bbs_mined", "BBS messages mined", m_Mined);
+    r.Add("beam_wallet_bbs_cancelled", "BBS messages cancelled before mined", m_Cancelled);
+    r.Add("beam_wallet_bbs_latency_us", "BBS message queue and mining time", m_Latency);
+    r.Add("beam_wallet_bbs_pending", "BBS messages pending for mining", m_Pending);
+}
+
+BbsMiner::Metrics& BbsMiner::Metrics::get()
+{
+    static Metrics s_Metrics;
+    return s_Metrics;
+}
+
+std::shared_ptr<BbsMiner> BbsMiner::get()
+{
+    static std::mutex s_Mutex;
+    static std::weak_ptr<BbsMiner> s_pInstance;
+
+    std::unique_lock<std::mutex> scope(s_Mutex);
+
+    std::shared_ptr<BbsMiner> pRet = s_pInstance.lock();
+    if (!pRet)
+    {
+        uint32_t nThreads = std::thread::hardware_concurrency();
+        nThreads = (nThreads > 1) ? (nThreads - 1) : 1; // leave at least 1 vacant core for other things
+
+        pRet = std::make_shared<BbsMiner>(nThreads);
+        s_pInstance = pRet;
+    }
+
+    return pRet;
+}
+
+BbsMiner::BbsMiner(uint32_t nThreads)
+    :m_Shutdown(false)
+    ,m_Generation(0)
+    ,m_Seq(0)
+{
+    Metrics::get(); // make sure it's registered
+
+    m_vThreads.resize(nThreads);
+    for (uint32_t i = 0; i < nThreads; i++)
+        m_vThreads[i] = std::thread(&BbsMiner::Thread, this, i);
+}
+
 void BbsMiner::Stop()
 {
     if (!m_vThreads.empty())
@@ -32,17 +81,49 @@ void BbsMiner::Stop()
                 m_vThreads[i].join();
 
         m_vThreads.clear();
-        m_pEvt.reset();
     }
 }
 
+bool BbsMiner::TaskCmp::operator()(const Task::Ptr& p0, const Task::Ptr& p1) const
+{
+    if (p0->m_Priority != p1->m_Priority)
+        return p0->m_Priority > p1->m_Priority;
+
+    return p0->m_Seq < p1->m_Seq;
+}
+
+void BbsMiner::EraseLocked(const Task::Ptr& pTask)
+{
+    auto it = m_Pending.find(pTask);
+    assert(m_Pending.end() != it);
+
+    if (m_Pending.begin() == it)
+        m_Generation = m_Generation + 1;
+
+    m_Pending.erase(it);
+    Metrics::get().m_Pending.Add(-1);
+}
+
+void BbsMiner::CancelLocked(const Task::Ptr& pTask)
+{
+    if (pTask->m_Done)
+        return;
+
+    pTask->m_Done = true;
+    EraseLocked(pTask);
+    Metrics::get().m_Cancelled.Inc();
+}
+
 void BbsMiner::Thread(uint32_t iThread)
 {
+    // the nonce keeps growing across the tasks, so that the same thread never retries the same values
     proto::Bbs::NonceType nStep = static_cast<uint32_t>(m_vThreads.size());
+    proto::Bbs::NonceType nonce = iThread;
 
     while (true)
     {
         Task::Ptr pTask;
+        uint64_t nGeneration;
 
         for (std::unique_lock<std::mutex> scope(m_Mutex); ; m_NewTask.wait(scope))
         {
@@ -51,22 +132,27 @@ void BbsMiner::Thread(uint32_t iThread)
 
             if (!m_Pending.empty())
             {
-                pTask = m_Pending.front();
+                pTask = *m_Pending.begin();
+                nGeneration = m_Generation;
                 break;
             }
         }
 
         Timestamp ts = 0;
-        proto::Bbs::NonceType nonce = iThread;
         bool bSuccess = false;
 
         for (uint32_t i = 0; ; i++)
         {
-            if (pTask->m_Done || m_Shutdown)
-                break;
-
             if (!(i & 0xff))
+            {
+                // switch to the new top task if there is one
+                if (pTask->m_Done || m_Shutdown || (nGeneration != m_Generation))
+                    break;
+
                 ts = getTimestamp();
+                if (i)
+                    Metrics::get().m_Hashes.Inc(0x100);
+            }
 
             // attempt to mine it
             ECC::Hash::Value hv;
@@ -87,26 +173,81 @@ void BbsMiner::Thread(uint32_t iThread)
 
         if (bSuccess)
         {
+            proto::Bbs::NonceType nonceMined = nonce;
+            nonce += nStep;
+
             std::unique_lock<std::mutex> scope(m_Mutex);
 
-            if (pTask->m_Done)
-                bSuccess = false;
-            else
+            if (!pTask->m_Done)
             {
-                assert(m_Pending.front() == pTask);
-
                 pTask->m_Msg.m_TimePosted = ts;
-                pTask->m_Msg.m_Nonce = nonce;
+                pTask->m_Msg.m_Nonce = nonceMined;
 
                 pTask->m_Done = true;
-                m_Pending.pop_front();
-                m_Done.push_back(std::move(pTask));
+                EraseLocked(pTask);
+
+                Metrics& m = Metrics::get();
+                m.m_Mined.Inc();
+                m.m_Latency.Add(pTask->m_Age.get_us());
+
+                // the client is alive as long as its task is pending
+                Client& c = *pTask->m_pClient;
+                c.m_Done.push_back(std::move(pTask));
+                c.m_pEvt->post();
             }
         }
+    }
+}
 
-        if (bSuccess)
-            m_pEvt->post();
+/////////////////////////
+// Client
+BbsMiner::Client::Client(std::function<void()>&& onMined)
+    :m_pMiner(BbsMiner::get())
+{
+    m_pEvt = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(onMined));
+}
+
+BbsMiner::Client::~Client()
+{
+    BbsMiner& m = *m_pMiner;
+    std::unique_lock<std::mutex> scope(m.m_Mutex);
+
+    for (auto it = m.m_Pending.begin(); m.m_Pending.end() != it; )
+    {
+        Task::Ptr pTask = *it++;
+        if (this == pTask->m_pClient)
+            m.CancelLocked(pTask);
     }
 }
-    
+
+void BbsMiner::Client::Push(Task::Ptr pTask)
+{
+    BbsMiner& m = *m_pMiner;
+    std::unique_lock<std::mutex> scope(m.m_Mutex);
+
+    pTask->m_Done = false;
+    pTask->m_pClient = this;
+    pTask->m_Seq = ++m.m_Seq;
+    pTask->m_Age = metrics::Stopwatch();
+
+    auto it = m.m_Pending.insert(std::move(pTask)).first;
+    if (m.m_Pending.begin() == it)
+        m.m_Generation = m.m_Generation + 1;
+
+    Metrics::get().m_Pending.Add(1);
+    m.m_NewTask.notify_all();
+}
+
+BbsMiner::Task::Ptr BbsMiner::Client::Pop()
+{
+    std::unique_lock<std::mutex> scope(m_pMiner->m_Mutex);
+
+    if (m_Done.empty())
+        return nullptr;
+
+    Task::Ptr pTask = std::move(m_Done.front());
+    m_Done.pop_front();
+    return pTask;
+}
+
 }  // namespace beam::wallet
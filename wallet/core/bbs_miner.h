@@ -14,48 +14,104 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <thread>
 #include <vector>
 
 #include "core/ecc_native.h"
 #include "core/proto.h"
 #include "utility/io/asyncevent.h"
+#include "utility/metrics.h"
 
 namespace beam::wallet
 {
 
+// Process-wide BBS message miner. All the wallets in the process share the same thread pool,
+// the pending messages are mined one at a time: highest priority first, then FIFO.
 struct BbsMiner
 {
-    // message mining
-    std::vector<std::thread> m_vThreads;
-    std::mutex m_Mutex;
-    std::condition_variable m_NewTask;
-
-    volatile bool m_Shutdown;
-    io::AsyncEvent::Ptr m_pEvt;
+    struct Client;
 
     struct Task
     {
         proto::BbsMsg m_Msg;
         ECC::Hash::Processor m_hpPartial;
-        volatile bool m_Done;
-        uint64_t m_StoredMessageID;
+        uint64_t m_StoredMessageID = 0;
+
+        uint32_t m_Priority = 0; // higher goes first
+
+        // set by the miner
+        volatile bool m_Done = false; // mined or cancelled
+        uint64_t m_Seq = 0;
+        metrics::Stopwatch m_Age;
+        Client* m_pClient = nullptr;
 
         typedef std::shared_ptr<Task> Ptr;
     };
 
     typedef std::deque<Task::Ptr> TaskQueue;
 
-    TaskQueue m_Pending;
-    TaskQueue m_Done;
+    // Submits tasks on behalf of its owner and receives the mined ones, via the owner's reactor.
+    // Its pending tasks are cancelled on destruction. The shared miner is kept alive while there are clients.
+    struct Client
+    {
+        Client(std::function<void()>&& onMined); // must be created on the owner's reactor thread
+        ~Client();
+
+        void Push(Task::Ptr);
+        Task::Ptr Pop(); // mined tasks in the order of completion, nullptr if none
+
+    private:
+        friend struct BbsMiner;
+
+        std::shared_ptr<BbsMiner> m_pMiner;
+        io::AsyncEvent::Ptr m_pEvt;
+        TaskQueue m_Done;
+    };
+
+    struct Metrics
+    {
+        metrics::Counter m_Hashes; // rate() of it is the hashrate
+        metrics::Counter m_Mined;
+        metrics::Counter m_Cancelled;
+        metrics::Histogram m_Latency; // since the task submission until it's mined, in microseconds
+        metrics::Gauge m_Pending;
+
+        static Metrics& get();
 
-    BbsMiner() :m_Shutdown(false) {}
+    private:
+        Metrics();
+    };
+
+    static std::shared_ptr<BbsMiner> get(); // the shared instance, started on demand
+
+    BbsMiner(uint32_t nThreads);
     ~BbsMiner() { Stop(); }
 
+private:
+    struct TaskCmp
+    {
+        bool operator()(const Task::Ptr&, const Task::Ptr&) const;
+    };
+
+    std::vector<std::thread> m_vThreads;
+    std::mutex m_Mutex;
+    std::condition_variable m_NewTask;
+
+    volatile bool m_Shutdown;
+    volatile uint64_t m_Generation; // incremented each time the top task changes
+    uint64_t m_Seq;
+
+    std::set<Task::Ptr, TaskCmp> m_Pending;
+
     void Stop();
     void Thread(uint32_t);
-
+    void CancelLocked(const Task::Ptr&);
+    void EraseLocked(const Task::Ptr&);
 };
 }  // namespace beam::wallet
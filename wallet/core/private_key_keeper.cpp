@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "private_key_keeper.h"
+#include <algorithm>
 
 namespace beam::wallet
 {
@@ -180,47 +181,141 @@ namespace beam::wallet
 
 	////////////////////////////////
 	// ThreadedPrivateKeyKeeper
-	void ThreadedPrivateKeyKeeper::PushIn(Task::Ptr& p)
+	ThreadedPrivateKeyKeeper::Pool::Pool(uint32_t nThreads)
 	{
-		std::unique_lock<std::mutex> scope(m_MutexIn);
+		m_vThreads.resize(std::max(nThreads, 1U));
+		for (auto& t : m_vThreads)
+			t = std::thread(&Pool::Thread, this);
+	}
+
+	ThreadedPrivateKeyKeeper::Pool::~Pool()
+	{
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_Run = false;
+			m_NewJob.notify_all();
+		}
 
-		if (m_queIn.Push(p))
-			m_NewIn.notify_one();
+		for (auto& t : m_vThreads)
+			if (t.joinable())
+				t.join();
 	}
 
-	void ThreadedPrivateKeyKeeper::Thread()
+	ThreadedPrivateKeyKeeper::Pool::Ptr ThreadedPrivateKeyKeeper::Pool::get()
 	{
+		static std::mutex s_Mutex;
+		static std::weak_ptr<Pool> s_pInstance;
+
+		std::unique_lock<std::mutex> scope(s_Mutex);
+
+		Ptr pRet = s_pInstance.lock();
+		if (!pRet)
+		{
+			pRet = std::make_shared<Pool>(std::thread::hardware_concurrency());
+			s_pInstance = pRet;
+		}
+
+		return pRet;
+	}
+
+	void ThreadedPrivateKeyKeeper::Pool::Thread()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+
 		while (true)
 		{
-			Task::Ptr pTask;
+			if (!m_Run)
+				return;
 
+			if (m_Jobs.empty())
 			{
-				std::unique_lock<std::mutex> scope(m_MutexIn);
-				while (true)
-				{
-					if (!m_Run)
-						return;
-
-					if (!m_queIn.empty())
-					{
-						m_queIn.Pop(pTask);
-						break;
-					}
-
-					m_NewIn.wait(scope);
-				}
+				m_NewJob.wait(scope);
+				continue;
 			}
 
-			assert(pTask);
-			Cast::Up<Task>(*pTask).Exec(*m_pKeyKeeper);
+			Job job = m_Jobs.front();
+			m_Jobs.pop_front();
+
+			ThreadedPrivateKeyKeeper& kk = *job.m_pOwner;
+			kk.m_Executing++;
+
+			scope.unlock();
+			job.m_pTask->Exec(*kk.m_pKeyKeeper);
+			scope.lock();
+
+			kk.m_Executing--;
+			kk.OnDone(*job.m_pTask);
 
+			m_JobDone.notify_all();
+		}
+	}
+
+	void ThreadedPrivateKeyKeeper::PushIn(Task::Ptr& p)
+	{
+		std::unique_lock<std::mutex> scope(m_pPool->m_Mutex);
+
+		m_queIn.Push(p);
+		ScheduleLocked();
+	}
+
+	void ThreadedPrivateKeyKeeper::ScheduleLocked()
+	{
+		// pool mutex is locked
+		while (!m_queIn.empty())
+		{
+			Task& t = Cast::Up<Task>(m_queIn.front());
+			if (!CanStart(t))
+				break;
+
+			Task::Ptr pTask;
+			m_queIn.Pop(pTask);
+			m_queRunning.Push(pTask); // the list owns it now
+
+			m_Running++;
+			if (t.m_Exclusive)
+				m_RunningExclusive = true;
+
+			m_pPool->m_Jobs.push_back(Pool::Job{ this, &t });
+			m_pPool->m_NewJob.notify_one();
+		}
+	}
+
+	bool ThreadedPrivateKeyKeeper::CanStart(const Task& t) const
+	{
+		if (m_RunningExclusive)
+			return false;
+		return !(t.m_Exclusive && m_Running);
+	}
+
+	void ThreadedPrivateKeyKeeper::OnDone(Task& t)
+	{
+		// pool mutex is locked
+		t.m_Done = true;
+
+		assert(m_Running);
+		m_Running--;
+		if (t.m_Exclusive)
+			m_RunningExclusive = false;
+
+		bool bPost = false;
+		{
+			std::unique_lock<std::mutex> scope(m_MutexOut);
+
+			while (!m_queRunning.empty() && Cast::Up<Task>(m_queRunning.front()).m_Done)
 			{
-				std::unique_lock<std::mutex> scope(m_MutexOut);
+				Task::Ptr pTask;
+				m_queRunning.Pop(pTask);
 
 				if (m_queOut.Push(pTask))
-					m_pNewOut->post();
+					bPost = true;
 			}
 		}
+
+		if (bPost)
+			m_pNewOut->post();
+
+		// the next task may have been waiting for this one
+		ScheduleLocked();
 	}
 
 	void ThreadedPrivateKeyKeeper::OnNewOut()
@@ -235,24 +330,42 @@ namespace beam::wallet
 		CallNewOut(que);
 	}
 
-	ThreadedPrivateKeyKeeper::ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p)
+	ThreadedPrivateKeyKeeper::ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, uint32_t nThreads)
 		:m_pKeyKeeper(p)
+		,m_pPool(std::make_shared<Pool>(nThreads))
 	{
-		EnsureEvtOut();
-		m_Thread = std::thread(&ThreadedPrivateKeyKeeper::Thread, this);
+	}
+
+	ThreadedPrivateKeyKeeper::ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, const Pool::Ptr& pPool)
+		:m_pKeyKeeper(p)
+		,m_pPool(pPool)
+	{
+		assert(m_pPool);
 	}
 
 	ThreadedPrivateKeyKeeper::~ThreadedPrivateKeyKeeper()
 	{
-		if (m_Thread.joinable())
-		{
-			{
-				std::unique_lock<std::mutex> scope(m_MutexIn);
-				m_Run = false;
-				m_NewIn.notify_one();
-			}
-			m_Thread.join();
-		}
+		std::unique_lock<std::mutex> scope(m_pPool->m_Mutex);
+
+		// drop the pending tasks, wait for those that are being executed
+		m_queIn.Clear();
+
+		auto& v = m_pPool->m_Jobs;
+		v.erase(std::remove_if(v.begin(), v.end(), [this](const Pool::Job& job) { return job.m_pOwner == this; }), v.end());
+
+		while (m_Executing)
+			m_pPool->m_JobDone.wait(scope);
+	}
+
+	namespace
+	{
+		// methods that don't modify the key keeper state
+		bool IsStateless(const IPrivateKeyKeeper2::Method::get_Kdf&) { return true; }
+		bool IsStateless(const IPrivateKeyKeeper2::Method::get_NumSlots&) { return true; }
+		bool IsStateless(const IPrivateKeyKeeper2::Method::CreateOutput&) { return true; }
+
+		template <typename TMethod>
+		bool IsStateless(const TMethod&) { return false; }
 	}
 
 	template <typename TMethod>
@@ -263,9 +376,12 @@ namespace beam::wallet
 			virtual void Exec(IPrivateKeyKeeper2& k) override { m_Status = k.InvokeSync(*m_pM); }
 		};
 
+		EnsureEvtOut(); // must be created in the caller (reactor) thread
+
 		Task::Ptr pTask(new MyTask);
 		pTask->m_pHandler = pHandler;
 		Cast::Up<MyTask>(*pTask).m_pM = &m;
+		Cast::Up<MyTask>(*pTask).m_Exclusive = !IsStateless(m);
 
 		PushIn(pTask);
 	}
@@ -279,6 +395,21 @@ namespace beam::wallet
 	KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+	IPrivateKeyKeeper2::Status::Type ThreadedPrivateKeyKeeper::InvokeSync(Method::get_Kdf& m)
+	{
+		return m_pKeyKeeper->InvokeSync(m);
+	}
+
+	IPrivateKeyKeeper2::Status::Type ThreadedPrivateKeyKeeper::InvokeSync(Method::get_NumSlots& m)
+	{
+		return m_pKeyKeeper->InvokeSync(m);
+	}
+
+	IPrivateKeyKeeper2::Status::Type ThreadedPrivateKeyKeeper::InvokeSync(Method::CreateOutput& m)
+	{
+		return m_pKeyKeeper->InvokeSync(m);
+	}
+
 
 
 } // namespace beam::wallet
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "common.h"
+#include <deque>
 #include <boost/intrusive/list.hpp>
 
 namespace beam::wallet
@@ -330,35 +331,80 @@ namespace beam::wallet
 
 	};
 
+	// Runs the methods of the underlying key keeper on a pool of worker threads.
+	// Stateless methods (CreateOutput, get_Kdf, get_NumSlots) may run concurrently, the signing methods
+	// use nonce slots, hence each of them waits for the preceding methods to complete, and blocks the following ones.
+	// Completions are always reported in the order of invocation.
+	// More than 1 thread requires the stateless methods of the underlying key keeper to be thread-safe (true for LocalPrivateKeyKeeper2).
+	// The worker threads may be shared by several key keepers (see Pool::get), so that many wallets in the same process don't oversubscribe the CPU.
 	class ThreadedPrivateKeyKeeper
 		:public PrivateKeyKeeper_AsyncNotify
 	{
-        IPrivateKeyKeeper2::Ptr m_pKeyKeeper;
-
-		std::thread m_Thread;
-		bool m_Run = true;
-
-		std::mutex m_MutexIn;
-		std::condition_variable m_NewIn;
-
-		std::mutex m_MutexOut;
-
         struct Task
             :public PrivateKeyKeeper_AsyncNotify::Task
         {
+            bool m_Exclusive;
+            bool m_Done = false;
             virtual void Exec(IPrivateKeyKeeper2&) = 0;
         };
 
+    public:
+
+        class Pool
+        {
+            friend class ThreadedPrivateKeyKeeper;
+
+            std::vector<std::thread> m_vThreads;
+            bool m_Run = true;
+
+            std::mutex m_Mutex; // also protects the scheduling state of the attached key keepers
+            std::condition_variable m_NewJob;
+            std::condition_variable m_JobDone;
+
+            struct Job
+            {
+                ThreadedPrivateKeyKeeper* m_pOwner;
+                Task* m_pTask;
+            };
+
+            std::deque<Job> m_Jobs; // FIFO across all the key keepers
+
+            void Thread();
+
+        public:
+            typedef std::shared_ptr<Pool> Ptr;
+
+            Pool(uint32_t nThreads);
+            ~Pool();
+
+            static Ptr get(); // process-wide instance, one thread per core. Started on demand, stopped when the last key keeper is gone
+        };
+
+    private:
+
+        IPrivateKeyKeeper2::Ptr m_pKeyKeeper;
+        Pool::Ptr m_pPool;
+
+		std::mutex m_MutexOut;
+
+		// protected by the pool mutex
 		TaskList m_queIn;
+		TaskList m_queRunning; // in order of invocation, moved to m_queOut once all the preceding are done
+		uint32_t m_Running = 0; // scheduled to the pool or executing
+		uint32_t m_Executing = 0;
+		bool m_RunningExclusive = false;
 
         void PushIn(Task::Ptr& p);
-        void Thread();
+        void ScheduleLocked();
+        bool CanStart(const Task&) const;
+        void OnDone(Task&);
 
         virtual void OnNewOut() override;
 
     public:
 
-        ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p);
+        ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, uint32_t nThreads = 1); // dedicated pool
+        ThreadedPrivateKeyKeeper(const IPrivateKeyKeeper2::Ptr& p, const Pool::Ptr&);
         ~ThreadedPrivateKeyKeeper();
 
 		template <typename TMethod>
@@ -370,6 +416,12 @@ namespace beam::wallet
 		KEY_KEEPER_METHODS(THE_MACRO)
 #undef THE_MACRO
 
+		// stateless methods are invoked directly in the caller thread
+		Status::Type InvokeSync(Method::get_Kdf&) override;
+		Status::Type InvokeSync(Method::get_NumSlots&) override;
+		Status::Type InvokeSync(Method::CreateOutput&) override;
+		using PrivateKeyKeeper_AsyncNotify::InvokeSync;
+
 	};
 
 }
@@ -233,7 +233,7 @@ namespace beam::wallet
 
     void Wallet::ResumeAllTransactions()
     {
-        auto txs = m_WalletDB->getTxHistory(TxType::ALL);
+        auto txs = m_WalletDB->getActiveTxs();
         for (auto& tx : txs)
         {
             ResumeTransaction(tx);
@@ -339,6 +339,9 @@ namespace beam::wallet
 
     void Wallet::RequestHandler::OnComplete(Request& r)
     {
+        // all the DB modifications caused by the response are committed at once
+        WalletDbBatch batch(*get_ParentObj().m_WalletDB);
+
         uint32_t n = get_ParentObj().SyncRemains();
 
         switch (r.get_Type())
@@ -361,6 +364,8 @@ namespace beam::wallet
 
         if (n)
             get_ParentObj().CheckSyncDone();
+
+        batch.commit();
     }
 
     // Implementation of the INegotiatorGateway::confirm_kernel
@@ -836,8 +841,9 @@ namespace beam::wallet
             }
         }
 
-        // Rollback inactive (completed or active) transactions if applicable
-        auto txs = m_WalletDB->getTxHistory(TxType::ALL); // get list of ALL transactions
+        // Rollback inactive (completed or active) transactions if applicable.
+        // Only those confirmed above the new tip may be affected
+        auto txs = m_WalletDB->getTxsConfirmedAbove(sTip.m_Height);
         for (auto& tx : txs)
         {
             // For all transactions that are not currently in the 'active' tx list
@@ -860,6 +866,8 @@ namespace beam::wallet
 
     void Wallet::OnNewTip()
     {
+        WalletDbBatch batch(*m_WalletDB);
+
         m_WalletDB->ShrinkHistory();
 
         Block::SystemState::Full sTip;
@@ -882,6 +890,8 @@ namespace beam::wallet
         CheckSyncDone();
 
         ProcessStoredMessages();
+
+        batch.commit();
     }
 
     void Wallet::OnTipUnchanged()
@@ -19,6 +19,8 @@
 #include "sqlite/sqlite3.h"
 #include "core/block_rw.h"
 #include <sstream>
+#include <mutex>
+#include <thread>
 #include <boost/functional/hash.hpp>
 #include <boost/filesystem.hpp>
 #include "nlohmann/json.hpp"
@@ -67,6 +69,7 @@
 #define VARIABLES_NAME "variables"
 #define ADDRESSES_NAME "addresses"
 #define TX_PARAMS_NAME "txparams"
+#define TX_SUMMARY_NAME "txsummary"
 #define PRIVATE_VARIABLES_NAME "PrivateVariables"
 #define WALLET_MESSAGE_NAME "WalletMessages"
 #define INCOMING_WALLET_MESSAGE_NAME "IncomingWalletMessages"
@@ -102,6 +105,27 @@
 
 #define TX_PARAMS_FIELDS ENUM_TX_PARAMS_FIELDS(LIST, COMMA, )
 
+// Denormalized copy of the tx parameters used in history queries (default sub-tx only), see updateTxSummary.
+// confirmHeight is the max of KernelProofHeight/AssetConfirmedHeight over all sub-txs, it's never decreased,
+// hence it may only overestimate the set of txs affected by rollback
+#define ENUM_TX_SUMMARY_FIELDS(each, sep, obj) \
+    each(txID,              txID,              BLOB NOT NULL PRIMARY KEY, obj) sep \
+    each(txType,            txType,            INTEGER, obj) sep \
+    each(status,            status,            INTEGER NOT NULL DEFAULT 0, obj) sep \
+    each(amount,            amount,            INTEGER, obj) sep \
+    each(fee,               fee,               INTEGER NOT NULL DEFAULT 0, obj) sep \
+    each(assetID,           assetID,           INTEGER NOT NULL DEFAULT 0, obj) sep \
+    each(isSender,          isSender,          INTEGER, obj) sep \
+    each(myID,              myID,              BLOB, obj) sep \
+    each(peerID,            peerID,            BLOB, obj) sep \
+    each(createTime,        createTime,        INTEGER, obj) sep \
+    each(minHeight,         minHeight,         INTEGER NOT NULL DEFAULT 0, obj) sep \
+    each(kernelProofHeight, kernelProofHeight, INTEGER NOT NULL DEFAULT 0, obj) sep \
+    each(confirmHeight,     confirmHeight,     INTEGER NOT NULL DEFAULT 0, obj)
+
+// the same mandatory parameters as required by getTx
+#define TX_SUMMARY_COMPLETE "txType NOT NULL AND amount NOT NULL AND myID NOT NULL AND createTime NOT NULL AND isSender NOT NULL"
+
 #define ENUM_WALLET_MESSAGE_FIELDS(each, sep, obj) \
     each(ID,  ID,  INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, obj) sep \
     each(PeerID, PeerID,   BLOB, obj) sep \
@@ -769,7 +793,8 @@ namespace beam::wallet
         const char* SystemStateIDName = "SystemStateID";
         const char* LastUpdateTimeName = "LastUpdateTime";
         const int BusyTimeoutMs = 5000;
-        const int DbVersion   = 19;
+        const int DbVersion   = 20;
+        const int DbVersion19 = 19;
         const int DbVersion18 = 18;
         const int DbVersion17 = 17;
         const int DbVersion16 = 16;
@@ -980,6 +1005,17 @@ namespace beam::wallet
             throwIfError(ret, db);
         }
 
+        void CreateTxSummaryTable(sqlite3* db)
+        {
+            const char* req = "CREATE TABLE " TX_SUMMARY_NAME " (" ENUM_TX_SUMMARY_FIELDS(LIST_WITH_TYPES, COMMA, ) ") WITHOUT ROWID;"
+                              "CREATE INDEX TxSummaryTimeIndex ON " TX_SUMMARY_NAME "(createTime DESC, txID);"
+                              "CREATE INDEX TxSummaryTypeIndex ON " TX_SUMMARY_NAME "(txType, createTime DESC, txID);"
+                              "CREATE INDEX TxSummaryStatusIndex ON " TX_SUMMARY_NAME "(status);"
+                              "CREATE INDEX TxSummaryConfirmIndex ON " TX_SUMMARY_NAME "(confirmHeight);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
         void CreateStatesTable(sqlite3* db)
         {
             const char* req = "CREATE TABLE [" TblStates "] ("
@@ -1132,6 +1168,7 @@ namespace beam::wallet
         CreateVariablesTable(db);
         CreateAddressesTable(db);
         CreateTxParamsTable(db);
+        CreateTxSummaryTable(db);
         CreateStatesTable(db);
         CreateLaserTables(db);
         CreateAssetsTable(db);
@@ -1187,6 +1224,27 @@ namespace beam::wallet
     {
         using LocalPrivateKeyKeeperStd::LocalPrivateKeyKeeperStd;
 
+        // The slots are accessed by the wallet thread (slot allocation) and by the key keeper workers (signing)
+        std::mutex m_MutexState;
+
+        void get_Nonce(ECC::Scalar::Native& ret, Slot::Type iSlot) override
+        {
+            std::unique_lock<std::mutex> scope(m_MutexState);
+            LocalPrivateKeyKeeperStd::get_Nonce(ret, iSlot);
+        }
+
+        void Regenerate(Slot::Type iSlot) override
+        {
+            std::unique_lock<std::mutex> scope(m_MutexState);
+            LocalPrivateKeyKeeperStd::Regenerate(iSlot);
+        }
+
+        ECC::Hash::Value get_Slot(Slot::Type iSlot)
+        {
+            std::unique_lock<std::mutex> scope(m_MutexState);
+            return m_State.m_pSlot[iSlot];
+        }
+
         struct UsedSlots
         {
             static const char s_szDbName[];
@@ -1219,10 +1277,27 @@ namespace beam::wallet
                 db.setVarRaw(s_szDbName, ser.buffer().first, ser.buffer().second);
             }
         };
+
+        void ResetState(const UsedSlots*); // new nonces, except the used slots
     };
 
     const char WalletDB::LocalKeyKeeper::UsedSlots::s_szDbName[] = "KeyKeeperSlots";
 
+    void WalletDB::LocalKeyKeeper::ResetState(const UsedSlots* pUsed)
+    {
+        std::unique_lock<std::mutex> scope(m_MutexState);
+
+        ECC::GenRandom(m_State.m_hvLast);
+        m_State.Generate();
+
+        if (pUsed)
+        {
+            // restore used slots
+            for (const UsedSlots::UsedMap::value_type& val : pUsed->m_Used)
+                m_State.m_pSlot[val.first] = val.second;
+        }
+    }
+
     void WalletDB::FromMaster(const ECC::uintBig& seed)
     {
         ECC::HKdf::Create(m_pKdfMaster, seed);
@@ -1237,8 +1312,11 @@ namespace beam::wallet
 
         if (!m_pKeyKeeper)
         {
-            m_pKeyKeeper = std::make_shared<LocalKeyKeeper>(m_pKdfMaster);
-            m_pLocalKeyKeeper = &Cast::Up<LocalKeyKeeper>(*m_pKeyKeeper);
+            auto pLocal = std::make_shared<LocalKeyKeeper>(m_pKdfMaster);
+            m_pLocalKeyKeeper = pLocal.get();
+
+            // outputs (bulletproofs) are created in parallel, off the reactor thread. The pool is shared by all the wallets in the process
+            m_pKeyKeeper = std::make_shared<ThreadedPrivateKeyKeeper>(pLocal, ThreadedPrivateKeyKeeper::Pool::get());
         }
 
         UpdateLocalSlots();
@@ -1320,17 +1398,7 @@ namespace beam::wallet
         }
 
         if (m_pLocalKeyKeeper)
-        {
-            ECC::GenRandom(m_pLocalKeyKeeper->m_State.m_hvLast);
-            m_pLocalKeyKeeper->m_State.Generate();
-
-            if (bKeep)
-            {
-                // restore used slots
-                for (LocalKeyKeeper::UsedSlots::UsedMap::value_type val : us.m_Used)
-                    m_pLocalKeyKeeper->m_State.m_pSlot[val.first] = val.second;
-            }
-        }
+            m_pLocalKeyKeeper->ResetState(bKeep ? &us : nullptr);
     }
 
     IWalletDB::Ptr WalletDB::init(const string& path, const SecString& password, const ECC::NoLeak<ECC::uintBig>& secretKey, bool separateDBForPrivateData)
@@ -1593,6 +1661,12 @@ namespace beam::wallet
                     LOG_INFO() << "Converting DB from format 18...";
                     CreateNotificationsTable(walletDB->_db);
                     CreateExchangeRatesTable(walletDB->_db);
+                    // no break
+
+                case DbVersion19:
+                    LOG_INFO() << "Converting DB from format 19...";
+                    CreateTxSummaryTable(walletDB->_db);
+                    walletDB->fillTxSummary();
                     storage::setVar(*walletDB, Version, DbVersion);
                     // no break
 
@@ -1716,6 +1790,7 @@ namespace beam::wallet
                 }
                 m_DbTransaction.reset();
             }
+            m_TxSummaryStatements.clear(); // must be finalized before closing
             BEAM_VERIFY(SQLITE_OK == sqlite3_close(_db));
             if (m_PrivateDB && _db != m_PrivateDB)
             {
@@ -1775,7 +1850,7 @@ namespace beam::wallet
 
                 ECC::Hash::Value& hv = us.m_Used[iSlot];
                 if (m_pLocalKeyKeeper)
-                    hv = m_pLocalKeyKeeper->m_State.m_pSlot[iSlot];
+                    hv = m_pLocalKeyKeeper->get_Slot(iSlot);
                 else
                     hv = Zero;
             }
@@ -2294,10 +2369,15 @@ namespace beam::wallet
         return true;
     }
 
-    void WalletDB::visitCoins(function<bool(const Coin& coin)> func)
+    void WalletDB::visitCoins(function<bool(const Coin& coin)> func, uint64_t skip, uint64_t count)
     {
-        const char* req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " ORDER BY ROWID;";
+        const char* req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " ORDER BY ROWID LIMIT ?1 OFFSET ?2;";
         sqlite::Statement stm(this, req);
+        if (count)
+            stm.bind(1, count);
+        else
+            stm.bind(1, -1); // no limit
+        stm.bind(2, skip);
 
         Height h = getCurrentHeight();
         while (stm.step())
@@ -2449,64 +2529,75 @@ namespace beam::wallet
 
     vector<TxDescription> WalletDB::getTxHistory(wallet::TxType txType, uint64_t start, int count) const
     {
-        // TODO this is temporary solution
-        int txCount = 0;
-        {
-            std::string req = "SELECT COUNT(DISTINCT txID) FROM " TX_PARAMS_NAME " WHERE paramID = ?1";
-            req += (txType != wallet::TxType::ALL) ? " AND value = ?2 ;" : " ;";
-
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, wallet::TxParameterID::TransactionType);
-
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                typeBlob = toByteBuffer(txType);
-                stm.bind(2, typeBlob);
-            }
+        TxHistoryFilter filter;
+        filter.m_Type = txType;
+        return getTxHistory(filter, start, count);
+    }
 
-            stm.step();
-            stm.get(0, txCount);
+    vector<TxDescription> WalletDB::getTxHistory(const TxHistoryFilter& filter, uint64_t start, int count) const
+    {
+        std::string req = "SELECT txID FROM " TX_SUMMARY_NAME " WHERE " TX_SUMMARY_COMPLETE;
+        if (filter.m_Type != wallet::TxType::ALL)
+        {
+            req += " AND txType=?3";
         }
-
-        vector<TxDescription> res;
-        if (txCount > 0)
+        if (filter.m_Status)
         {
-            res.reserve(static_cast<size_t>(min(txCount, count)));
-            std::string req = "SELECT DISTINCT txID FROM " TX_PARAMS_NAME;
-
-            if (txType != wallet::TxType::ALL)
-            {
-                req += " WHERE paramID = ?3 AND value = ?4";
-            }
+            req += " AND status=?4";
+        }
+        if (filter.m_KernelProofHeight)
+        {
+            req += " AND kernelProofHeight=?5";
+        }
+        req += " ORDER BY createTime DESC, txID LIMIT ?1 OFFSET ?2;";
 
-            req += " LIMIT ?1 OFFSET ?2 ;";
+        sqlite::Statement stm(this, req.c_str());
+        stm.bind(1, count);
+        stm.bind(2, start);
+        if (filter.m_Type != wallet::TxType::ALL)
+        {
+            stm.bind(3, filter.m_Type);
+        }
+        if (filter.m_Status)
+        {
+            stm.bind(4, *filter.m_Status);
+        }
+        if (filter.m_KernelProofHeight)
+        {
+            stm.bind(5, *filter.m_KernelProofHeight);
+        }
+        return loadTxs(stm);
+    }
 
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, count);
-            stm.bind(2, start);
+    vector<TxDescription> WalletDB::getActiveTxs() const
+    {
+        sqlite::Statement stm(this, "SELECT txID FROM " TX_SUMMARY_NAME " WHERE status IN (?1, ?2, ?3) AND " TX_SUMMARY_COMPLETE ";");
+        stm.bind(1, TxStatus::Pending);
+        stm.bind(2, TxStatus::InProgress);
+        stm.bind(3, TxStatus::Registering);
+        return loadTxs(stm);
+    }
 
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                stm.bind(3, wallet::TxParameterID::TransactionType);
-                typeBlob = toByteBuffer(txType);
-                stm.bind(4, typeBlob);
-            }
+    vector<TxDescription> WalletDB::getTxsConfirmedAbove(Height h) const
+    {
+        sqlite::Statement stm(this, "SELECT txID FROM " TX_SUMMARY_NAME " WHERE confirmHeight>?1 AND " TX_SUMMARY_COMPLETE ";");
+        stm.bind(1, h);
+        return loadTxs(stm);
+    }
 
-            while (stm.step())
+    vector<TxDescription> WalletDB::loadTxs(sqlite::Statement& stm) const
+    {
+        vector<TxDescription> res;
+        while (stm.step())
+        {
+            TxID txID;
+            stm.get(0, txID);
+            auto t = getTx(txID);
+            if (t.is_initialized())
             {
-                TxID txID;
-                stm.get(0, txID);
-                auto t = getTx(txID);
-                if (t.is_initialized())
-                {
-                    res.emplace_back(*t);
-                }
+                res.emplace_back(std::move(*t));
             }
-            sort(res.begin(), res.end(), [](const auto& left, const auto& right) {return left.m_createTime > right.m_createTime; });
         }
-
         return res;
     }
     
@@ -2644,6 +2735,13 @@ namespace beam::wallet
             stm.bind(2, TxParameterID::TransactionType);
 
             stm.step();
+
+            // keep the summary consistent with the remaining parameter
+            sqlite::Statement stm2(this, "DELETE FROM " TX_SUMMARY_NAME " WHERE txID=?1;");
+            stm2.bind(1, txId);
+            stm2.step();
+            updateTxSummary(txId, kDefaultSubTxID, TxParameterID::TransactionType, toByteBuffer(tx->m_txType));
+
             deleteParametersFromCache(txId);
             notifyTransactionChanged(ChangeAction::Removed, { *tx });
         }
@@ -2738,21 +2836,32 @@ namespace beam::wallet
     std::vector<WalletAddress> WalletDB::getAddresses(bool own) const
     {
         vector<WalletAddress> res;
-        const char* req = "SELECT * FROM " ADDRESSES_NAME " ORDER BY createTime DESC;";
+        visitAddresses(own, [&res](const WalletAddress& a)
+        {
+            res.push_back(a);
+            return true;
+        });
+        return res;
+    }
+
+    void WalletDB::visitAddresses(bool own, function<bool(const WalletAddress& address)> func) const
+    {
+        const char* req = own
+            ? "SELECT * FROM " ADDRESSES_NAME " WHERE OwnID != 0 ORDER BY createTime DESC;"
+            : "SELECT * FROM " ADDRESSES_NAME " WHERE OwnID = 0 ORDER BY createTime DESC;";
         sqlite::Statement stm(this, req);
 
         while (stm.step())
         {
-            auto& a = res.emplace_back();
+            WalletAddress a;
             int colIdx = 0;
             ENUM_ADDRESS_FIELDS(STM_GET_LIST, NOSEP, a);
             if (a.isOwn())
                 get_Identity(a.m_Identity, a.m_OwnID);
 
-            if (a.isOwn() != own)
-                res.pop_back(); // akward, but ok
+            if (!func(a))
+                break;
         }
-        return res;
     }
 
     void WalletDB::saveAddress(const WalletAddress& address, bool isLaser)
@@ -3135,18 +3244,9 @@ namespace beam::wallet
 
     bool WalletDB::setTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob, bool shouldNotifyAboutChanges)
     {
-        if (auto txIter = m_TxParametersCache.find(txID); txIter != m_TxParametersCache.end())
+        if (auto pValue = m_TxParametersCache.peek(txID, subTxID, paramID); pValue && *pValue && blob == **pValue)
         {
-            if (auto subTxIter = txIter->second.find(subTxID); subTxIter != txIter->second.end())
-            {
-                if (auto pit = subTxIter->second.find(paramID); pit != subTxIter->second.end())
-                {
-                    if (pit->second && blob == *(pit->second))
-                    {
-                        return false;
-                    }
-                }
-            }
+            return false;
         }
 
         bool hasTx = hasTransaction(txID);
@@ -3171,6 +3271,7 @@ namespace beam::wallet
                 stm2.bind(3, paramID);
                 stm2.bind(4, blob);
                 stm2.step();
+                updateTxSummary(txID, subTxID, paramID, blob);
 
                 if (shouldNotifyAboutChanges)
                 {
@@ -3194,6 +3295,7 @@ namespace beam::wallet
         int colIdx = 0;
         ENUM_TX_PARAMS_FIELDS(STM_BIND_LIST, NOSEP, parameter);
         stm.step();
+        updateTxSummary(txID, subTxID, paramID, blob);
         if (shouldNotifyAboutChanges)
         {
             auto tx = getTx(txID);
@@ -3208,20 +3310,23 @@ namespace beam::wallet
 
     bool WalletDB::getTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID, ByteBuffer& blob) const
     {
-        if (auto txIter = m_TxParametersCache.find(txID); txIter != m_TxParametersCache.end())
+        return getTxParameterImpl(txID, subTxID, paramID, blob, true);
+    }
+
+    bool WalletDB::getTxParameterImpl(const TxID& txID, SubTxID subTxID, TxParameterID paramID, ByteBuffer& blob, bool isRead) const
+    {
+        auto pValue = isRead
+            ? m_TxParametersCache.find(txID, subTxID, paramID)
+            : m_TxParametersCache.peek(txID, subTxID, paramID);
+
+        if (pValue)
         {
-            if (auto subTxIter = txIter->second.find(subTxID); subTxIter != txIter->second.end())
+            if (*pValue)
             {
-                if (auto pit = subTxIter->second.find(paramID); pit != subTxIter->second.end())
-                {
-                    if (pit->second)
-                    {
-                        blob = *(pit->second);
-                        return true;
-                    }
-                    return false;
-                }
+                blob = **pValue;
+                return true;
             }
+            return false;
         }
 
         sqlite::Statement stm(this, "SELECT * FROM " TX_PARAMS_NAME " WHERE txID=?1 AND subTxID=?2 AND paramID=?3;");
@@ -3263,7 +3368,7 @@ namespace beam::wallet
 
     void WalletDB::insertParameterToCache(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const boost::optional<ByteBuffer>& blob) const
     {
-        m_TxParametersCache[txID][subTxID][paramID] = blob;
+        m_TxParametersCache.insert(txID, subTxID, paramID, blob);
     }
 
     void WalletDB::deleteParametersFromCache(const TxID& txID)
@@ -3271,12 +3376,302 @@ namespace beam::wallet
         m_TxParametersCache.erase(txID);
     }
 
+    TxParametersCache::Stats WalletDB::getTxParametersCacheStats() const
+    {
+        return m_TxParametersCache.getStats();
+    }
+
+    void WalletDB::setTxParametersCacheSize(size_t maxSize)
+    {
+        m_TxParametersCache.setMaxSize(maxSize);
+    }
+
+    TxParametersCache::TxParametersCache(size_t maxSize)
+        : m_MaxSize(maxSize)
+    {
+    }
+
+    const TxParametersCache::Value* TxParametersCache::find(const TxID& txID, SubTxID subTxID, TxParameterID paramID)
+    {
+        return lookup(txID, subTxID, paramID, true);
+    }
+
+    const TxParametersCache::Value* TxParametersCache::peek(const TxID& txID, SubTxID subTxID, TxParameterID paramID)
+    {
+        return lookup(txID, subTxID, paramID, false);
+    }
+
+    const TxParametersCache::Value* TxParametersCache::lookup(const TxID& txID, SubTxID subTxID, TxParameterID paramID, bool isRead)
+    {
+        auto it = m_Entries.find(txID);
+        if (it == m_Entries.end())
+        {
+            if (isRead)
+                ++m_Stats.m_Misses;
+            return nullptr;
+        }
+
+        Entry& entry = it->second;
+        if (isRead)
+            touch(entry);
+
+        auto pit = entry.m_Params.find(std::make_pair(subTxID, paramID));
+        if (pit == entry.m_Params.end())
+        {
+            if (isRead)
+                ++m_Stats.m_Misses;
+            return nullptr;
+        }
+
+        if (isRead)
+            ++m_Stats.m_Hits;
+        return &pit->second;
+    }
+
+    void TxParametersCache::insert(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const Value& value)
+    {
+        auto [it, isNew] = m_Entries.emplace(txID, Entry());
+        Entry& entry = it->second;
+        if (isNew)
+        {
+            m_Lru.push_front(txID);
+            entry.m_itLru = m_Lru.begin();
+        }
+        else
+        {
+            touch(entry);
+        }
+
+        auto [pit, isNewParam] = entry.m_Params.emplace(std::make_pair(subTxID, paramID), Value());
+        size_t oldSize = isNewParam ? 0 : getSize(pit->second);
+        pit->second = value;
+        size_t newSize = getSize(pit->second);
+
+        entry.m_Size += newSize - oldSize;
+        m_Stats.m_Size += newSize - oldSize;
+
+        if (subTxID == kDefaultSubTxID && paramID == TxParameterID::Status && value)
+        {
+            try
+            {
+                TxStatus status = TxStatus::Pending;
+                if (fromByteBuffer(*value, status))
+                {
+                    setPinned(txID, entry, status == TxStatus::Pending || status == TxStatus::InProgress || status == TxStatus::Registering);
+                }
+            }
+            catch (const std::exception&)
+            {
+                // malformed status, leave the tx evictable
+            }
+        }
+
+        evict();
+    }
+
+    void TxParametersCache::erase(const TxID& txID)
+    {
+        auto it = m_Entries.find(txID);
+        if (it == m_Entries.end())
+        {
+            return;
+        }
+
+        Entry& entry = it->second;
+        if (entry.m_Pinned)
+        {
+            --m_Stats.m_Pinned;
+        }
+        else
+        {
+            m_Lru.erase(entry.m_itLru);
+        }
+        m_Stats.m_Size -= entry.m_Size;
+        m_Entries.erase(it);
+    }
+
+    void TxParametersCache::setMaxSize(size_t maxSize)
+    {
+        m_MaxSize = maxSize;
+        evict();
+    }
+
+    TxParametersCache::Stats TxParametersCache::getStats() const
+    {
+        Stats stats = m_Stats;
+        stats.m_Txs = m_Entries.size();
+        return stats;
+    }
+
+    void TxParametersCache::touch(Entry& entry)
+    {
+        if (!entry.m_Pinned)
+        {
+            m_Lru.splice(m_Lru.begin(), m_Lru, entry.m_itLru);
+        }
+    }
+
+    void TxParametersCache::setPinned(const TxID& txID, Entry& entry, bool pinned)
+    {
+        if (entry.m_Pinned == pinned)
+        {
+            return;
+        }
+
+        entry.m_Pinned = pinned;
+        if (pinned)
+        {
+            m_Lru.erase(entry.m_itLru);
+            ++m_Stats.m_Pinned;
+        }
+        else
+        {
+            m_Lru.push_front(txID);
+            entry.m_itLru = m_Lru.begin();
+            --m_Stats.m_Pinned;
+        }
+    }
+
+    void TxParametersCache::evict()
+    {
+        while (m_Stats.m_Size > m_MaxSize && !m_Lru.empty())
+        {
+            auto it = m_Entries.find(m_Lru.back());
+            assert(it != m_Entries.end());
+
+            m_Stats.m_Size -= it->second.m_Size;
+            ++m_Stats.m_Evicted;
+
+            m_Lru.pop_back();
+            m_Entries.erase(it);
+        }
+    }
+
+    size_t TxParametersCache::getSize(const Value& value)
+    {
+        return s_ParamOverhead + (value ? value->size() : 0);
+    }
+
+    namespace
+    {
+        template <typename T>
+        uint64_t getSummaryValue(const ByteBuffer& blob)
+        {
+            T value = {};
+            deserialize(value, blob);
+            return static_cast<uint64_t>(value);
+        }
+    }
+
+    sqlite::Statement& WalletDB::getTxSummaryStatement(size_t index, const char* column)
+    {
+        if (m_TxSummaryStatements.size() <= index)
+        {
+            m_TxSummaryStatements.resize(index + 1);
+        }
+
+        auto& pStm = m_TxSummaryStatements[index];
+        if (!pStm)
+        {
+            std::string req;
+            if (column)
+            {
+                req = "INSERT INTO " TX_SUMMARY_NAME " (txID, ";
+                req += column;
+                req += ") VALUES(?1, ?2) ON CONFLICT(txID) DO UPDATE SET ";
+                req += column;
+                req += "=excluded.";
+                req += column;
+                req += ";";
+            }
+            else
+            {
+                req = "INSERT INTO " TX_SUMMARY_NAME " (txID, confirmHeight) VALUES(?1, ?2) "
+                      "ON CONFLICT(txID) DO UPDATE SET confirmHeight=MAX(confirmHeight, excluded.confirmHeight);";
+            }
+
+            pStm = std::make_unique<sqlite::Statement>(this, req.c_str());
+        }
+        else
+        {
+            onPrepareToModify();
+            pStm->Reset();
+        }
+
+        return *pStm;
+    }
+
+    void WalletDB::updateTxSummary(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob)
+    {
+        if (paramID == TxParameterID::KernelProofHeight || paramID == TxParameterID::AssetConfirmedHeight)
+        {
+            sqlite::Statement& stm = getTxSummaryStatement(0, nullptr);
+            stm.bind(1, txID);
+            stm.bind(2, getSummaryValue<Height>(blob));
+            stm.step();
+            stm.Reset();
+        }
+
+        if (subTxID != kDefaultSubTxID)
+        {
+            return;
+        }
+
+        const char* column = nullptr;
+        size_t index = 0; // of the cached statement
+        uint64_t value = 0;
+        bool isBlob = false;
+
+        switch (paramID)
+        {
+        case TxParameterID::TransactionType:    index = 1;  column = "txType";              value = getSummaryValue<TxType>(blob); break;
+        case TxParameterID::Status:             index = 2;  column = "status";              value = getSummaryValue<TxStatus>(blob); break;
+        case TxParameterID::Amount:             index = 3;  column = "amount";              value = getSummaryValue<Amount>(blob); break;
+        case TxParameterID::Fee:                index = 4;  column = "fee";                 value = getSummaryValue<Amount>(blob); break;
+        case TxParameterID::AssetID:            index = 5;  column = "assetID";             value = getSummaryValue<Asset::ID>(blob); break;
+        case TxParameterID::IsSender:           index = 6;  column = "isSender";            value = getSummaryValue<bool>(blob); break;
+        case TxParameterID::CreateTime:         index = 7;  column = "createTime";          value = getSummaryValue<Timestamp>(blob); break;
+        case TxParameterID::MinHeight:          index = 8;  column = "minHeight";           value = getSummaryValue<Height>(blob); break;
+        case TxParameterID::KernelProofHeight:  index = 9;  column = "kernelProofHeight";   value = getSummaryValue<Height>(blob); break;
+        case TxParameterID::MyID:               index = 10; column = "myID";                isBlob = true; break;
+        case TxParameterID::PeerID:             index = 11; column = "peerID";              isBlob = true; break;
+        default:
+            return;
+        }
+
+        sqlite::Statement& stm = getTxSummaryStatement(index, column);
+        stm.bind(1, txID);
+        if (isBlob)
+        {
+            stm.bind(2, blob);
+        }
+        else
+        {
+            stm.bind(2, value);
+        }
+        stm.step();
+        stm.Reset();
+    }
+
+    void WalletDB::fillTxSummary()
+    {
+        sqlite::Statement stm(this, "SELECT " TX_PARAMS_FIELDS " FROM " TX_PARAMS_NAME ";");
+
+        while (stm.step())
+        {
+            TxParameter parameter;
+            int colIdx = 0;
+            ENUM_TX_PARAMS_FIELDS(STM_GET_LIST, NOSEP, parameter);
+            updateTxSummary(parameter.m_txID, static_cast<SubTxID>(parameter.m_subTxID), static_cast<TxParameterID>(parameter.m_paramID), parameter.m_value);
+        }
+    }
+
     bool WalletDB::hasTransaction(const TxID& txID) const
     {
         ByteBuffer blob;
         for (const auto& paramID : m_mandatoryTxParams)
         {
-            if (!getTxParameter(txID, kDefaultSubTxID, paramID, blob))
+            if (!getTxParameterImpl(txID, kDefaultSubTxID, paramID, blob, false))
             {
                 return false;
             }
@@ -3306,6 +3701,7 @@ namespace beam::wallet
                 m_DbTransaction->rollback();
                 m_DbTransaction.reset();
             }
+            m_History.Invalidate();
         }
     }
 
@@ -3344,11 +3740,151 @@ namespace beam::wallet
         }
     }
 
+    namespace
+    {
+        template <typename T>
+        void addPendingChanges(vector<pair<ChangeAction, vector<T>>>& changes, ChangeAction action, const vector<T>& items)
+        {
+            if (changes.empty() || changes.back().first != action || action == ChangeAction::Reset)
+            {
+                changes.emplace_back(action, items);
+            }
+            else
+            {
+                auto& v = changes.back().second;
+                v.insert(v.end(), items.begin(), items.end());
+            }
+        }
+
+        // leaves the most recent version of each item, keeps the order of the first appearance
+        template <typename T, typename GetKey>
+        void removeDuplicates(vector<T>& items, GetKey&& getKey)
+        {
+            map<decltype(getKey(items.front())), size_t> index;
+            vector<T> res;
+            res.reserve(items.size());
+
+            for (auto& item : items)
+            {
+                auto [it, isNew] = index.emplace(getKey(item), res.size());
+                if (isNew)
+                    res.push_back(std::move(item));
+                else
+                    res[it->second] = std::move(item);
+            }
+            items.swap(res);
+        }
+    }
+
+    void WalletDB::beginBatch()
+    {
+        m_BatchDepth++;
+    }
+
+    void WalletDB::endBatch()
+    {
+        assert(m_BatchDepth);
+        if (--m_BatchDepth)
+            return;
+
+        try
+        {
+            flushDB();
+        }
+        catch (const std::exception& ex)
+        {
+            LOG_ERROR() << "Wallet DB Commit failed: " << ex.what();
+        }
+
+        if (m_NotifyTimer)
+        {
+            m_NotifyTimer->cancel();
+        }
+
+        flushNotifications();
+    }
+
+    void WalletDB::endBatchDeferred()
+    {
+        assert(m_BatchDepth);
+        if (--m_BatchDepth)
+            return;
+
+        try
+        {
+            flushDB();
+        }
+        catch (const std::exception& ex)
+        {
+            LOG_ERROR() << "Wallet DB Commit failed: " << ex.what();
+        }
+
+        if (!m_Initialized)
+        {
+            return; // no reactor yet, delivered by the next batch
+        }
+
+        if (!m_NotifyTimer)
+        {
+            m_NotifyTimer = io::Timer::create(io::Reactor::get_Current());
+        }
+
+        m_NotifyTimer->start(0, false, [this]()
+        {
+            if (!m_BatchDepth) // otherwise delivered when it ends
+            {
+                flushNotifications();
+            }
+        });
+    }
+
+    void WalletDB::flushNotifications()
+    {
+        ChangesList<Coin> coinsChanges;
+        ChangesList<TxDescription> txChanges;
+        ChangesList<WalletAddress> addressChanges;
+        boost::optional<Block::SystemState::ID> stateID;
+
+        coinsChanges.swap(m_PendingCoinsChanges);
+        txChanges.swap(m_PendingTransactionChanges);
+        addressChanges.swap(m_PendingAddressChanges);
+        stateID.swap(m_PendingStateID);
+
+        for (auto& [action, items] : coinsChanges)
+        {
+            removeDuplicates(items, [](const Coin& c) { return c.toStringID(); });
+            notifyCoinsChanged(action, items);
+        }
+
+        for (auto& [action, items] : txChanges)
+        {
+            removeDuplicates(items, [](const TxDescription& tx) { return tx.m_txId; });
+            notifyTransactionChanged(action, items);
+        }
+
+        for (auto& [action, items] : addressChanges)
+        {
+            removeDuplicates(items, [](const WalletAddress& a) { return a.m_walletID; });
+            notifyAddressChanged(action, items);
+        }
+
+        if (stateID)
+        {
+            notifySystemStateChanged(*stateID);
+        }
+    }
+
     void WalletDB::notifyCoinsChanged(ChangeAction action, const vector<Coin>& items)
     {
         if (items.empty() && action != ChangeAction::Reset)
             return;
 
+        if (m_BatchDepth)
+        {
+            addPendingChanges(m_PendingCoinsChanges, action, items);
+            return;
+        }
+
         for (const auto sub : m_subscribers)
         {
             sub->onCoinsChanged(action, items);
@@ -3360,6 +3896,12 @@ namespace beam::wallet
         if (items.empty() && action != ChangeAction::Reset)
             return;
 
+        if (m_BatchDepth)
+        {
+            addPendingChanges(m_PendingTransactionChanges, action, items);
+            return;
+        }
+
         for (const auto sub : m_subscribers)
         {
             sub->onTransactionChanged(action, items);
@@ -3368,6 +3910,12 @@ namespace beam::wallet
 
     void WalletDB::notifySystemStateChanged(const Block::SystemState::ID& stateID)
     {
+        if (m_BatchDepth)
+        {
+            m_PendingStateID = stateID; // only the last one matters
+            return;
+        }
+
         for (const auto sub : m_subscribers) sub->onSystemStateChanged(stateID);
     }
 
@@ -3376,6 +3924,12 @@ namespace beam::wallet
         if (items.empty() && action != ChangeAction::Reset)
             return;
 
+        if (m_BatchDepth)
+        {
+            addPendingChanges(m_PendingAddressChanges, action, items);
+            return;
+        }
+
         for (const auto sub : m_subscribers)
         {
             sub->onAddressChanged(action, items);
@@ -3395,13 +3949,7 @@ namespace beam::wallet
             const Height hMaxBacklog = Rules::get().MaxRollback * 2; // can actually be more
 
             if (s.m_Height > hMaxBacklog)
-            {
-                const char* req = "DELETE FROM " TblStates " WHERE " TblStates_Height "<=?";
-                sqlite::Statement stm(this, req);
-                stm.bind(1, s.m_Height - hMaxBacklog);
-                stm.step();
-
-            }
+                m_History.DeleteBelow(s.m_Height - hMaxBacklog);
         }
     }
 
@@ -3524,41 +4072,42 @@ namespace beam::wallet
         stm.step();
     }
 
-    bool WalletDB::History::Enum(IWalker& w, const Height* pBelow)
+    Block::SystemState::HistoryMap& WalletDB::History::get_Cache()
     {
-        const char* req = pBelow ?
-            "SELECT " TblStates_Hdr " FROM " TblStates " WHERE " TblStates_Height "<? ORDER BY " TblStates_Height " DESC;" :
-            "SELECT " TblStates_Hdr " FROM " TblStates " ORDER BY " TblStates_Height " DESC;";
-
-        sqlite::Statement stm(&get_ParentObj(), req);
+        if (!m_Loaded)
+        {
+            m_Cache.m_Map.clear();
 
-        if (pBelow)
-            stm.bind(1, *pBelow);
+            const char* req = "SELECT " TblStates_Hdr " FROM " TblStates " ORDER BY " TblStates_Height " ASC;";
+            sqlite::Statement stm(&get_ParentObj(), req);
 
-        while (stm.step())
-        {
-            Block::SystemState::Full s;
-            stm.get(0, s);
+            while (stm.step())
+            {
+                Block::SystemState::Full s;
+                stm.get(0, s);
+                m_Cache.m_Map.emplace_hint(m_Cache.m_Map.end(), s.m_Height, s);
+            }
 
-            if (!w.OnState(s))
-                return false;
+            m_Loaded = true;
         }
 
-        return true;
+        return m_Cache;
     }
 
-    bool WalletDB::History::get_At(Block::SystemState::Full& s, Height h)
+    void WalletDB::History::Invalidate()
     {
-        const char* req = "SELECT " TblStates_Hdr " FROM " TblStates " WHERE " TblStates_Height "=?";
-
-        sqlite::Statement stm(&get_ParentObj(), req);
-        stm.bind(1, h);
+        m_Loaded = false;
+        m_Cache.m_Map.clear();
+    }
 
-        if (!stm.step())
-            return false;
+    bool WalletDB::History::Enum(IWalker& w, const Height* pBelow)
+    {
+        return get_Cache().Enum(w, pBelow);
+    }
 
-        stm.get(0, s);
-        return true;
+    bool WalletDB::History::get_At(Block::SystemState::Full& s, Height h)
+    {
+        return get_Cache().get_At(s, h);
     }
 
     void WalletDB::History::AddStates(const Block::SystemState::Full* pS, size_t nCount)
@@ -3575,14 +4124,37 @@ namespace beam::wallet
             stm.bind(2, pS[i]);
             stm.step();
         }
+
+        if (m_Loaded)
+            m_Cache.AddStates(pS, nCount);
     }
 
     void WalletDB::History::DeleteFrom(Height h)
     {
+        auto& cache = get_Cache();
+        if (cache.m_Map.empty() || (cache.m_Map.rbegin()->first < h))
+            return; // nothing to delete
+
         const char* req = "DELETE FROM " TblStates " WHERE " TblStates_Height ">=?";
         sqlite::Statement stm(&get_ParentObj(), req);
         stm.bind(1, h);
         stm.step();
+
+        cache.DeleteFrom(h);
+    }
+
+    void WalletDB::History::DeleteBelow(Height h)
+    {
+        auto& cache = get_Cache();
+        if (cache.m_Map.empty() || (cache.m_Map.begin()->first > h))
+            return; // nothing to delete
+
+        const char* req = "DELETE FROM " TblStates " WHERE " TblStates_Height "<=?";
+        sqlite::Statement stm(&get_ParentObj(), req);
+        stm.bind(1, h);
+        stm.step();
+
+        cache.m_Map.erase(cache.m_Map.begin(), cache.m_Map.upper_bound(h));
     }
 
     namespace storage
@@ -26,6 +26,7 @@
 #endif
 
 #include <tuple>
+#include <list>
 #include "core/common.h"
 #include "core/ecc_native.h"
 #include "common.h"
@@ -192,6 +193,14 @@ namespace beam::wallet
         ByteBuffer m_value;
     };
 
+    // Transaction history query, evaluated over the tx summary table
+    struct TxHistoryFilter
+    {
+        TxType m_Type = TxType::Simple; // TxType::ALL for any type
+        boost::optional<TxStatus> m_Status;
+        boost::optional<Height> m_KernelProofHeight;
+    };
+
     // Outgoing wallet messages sent through SBBS (used in Cold Wallet)
     struct OutgoingWalletMessage
     {
@@ -347,8 +356,8 @@ namespace beam::wallet
         virtual bool findCoin(Coin& coin) = 0;
         virtual void clearCoins() = 0;
 
-        // Generic visitor to iterate over coin collection
-        virtual void visitCoins(std::function<bool(const Coin& coin)> func) = 0;
+        // Generic visitor to iterate over coin collection. If count is specified - visits at most count coins, starting from skip
+        virtual void visitCoins(std::function<bool(const Coin& coin)> func, uint64_t skip = 0, uint64_t count = 0) = 0;
 
         // Used in split API for session management
         virtual bool lockCoins(const CoinIDList& list, uint64_t session) = 0;
@@ -365,6 +374,12 @@ namespace beam::wallet
         // /////////////////////////////////////////////
         // Transaction management
         virtual std::vector<TxDescription> getTxHistory(wallet::TxType txType = wallet::TxType::Simple, uint64_t start = 0, int count = std::numeric_limits<int>::max()) const = 0;
+        // Newest first, only the requested page is loaded
+        virtual std::vector<TxDescription> getTxHistory(const TxHistoryFilter& filter, uint64_t start, int count) const = 0;
+        // Transactions that are not final yet (see TxDescription::canResume)
+        virtual std::vector<TxDescription> getActiveTxs() const = 0;
+        // Transactions confirmed above the given height in any of their sub-transactions (rollback candidates)
+        virtual std::vector<TxDescription> getTxsConfirmedAbove(Height h) const = 0;
         virtual boost::optional<TxDescription> getTx(const TxID& txId) const = 0;
         virtual void saveTx(const TxDescription& p) = 0;
         virtual void deleteTx(const TxID& txId) = 0;
@@ -380,6 +395,7 @@ namespace beam::wallet
         virtual boost::optional<WalletAddress> getAddress(
                 const WalletID&, bool isLaser = false) const = 0;
         virtual std::vector<WalletAddress> getAddresses(bool own) const = 0;
+        virtual void visitAddresses(bool own, std::function<bool(const WalletAddress& address)> func) const = 0;
         virtual void saveAddress(const WalletAddress&, bool isLaser = false) = 0;
         virtual void deleteAddress(const WalletID&, bool isLaser = false) = 0;
 
@@ -398,6 +414,14 @@ namespace beam::wallet
         virtual void Subscribe(IWalletDbObserver* observer) = 0;
         virtual void Unsubscribe(IWalletDbObserver* observer) = 0;
 
+        // Batch mode, may be nested. The modifications made within it are committed in a single DB transaction,
+        // and the change notifications are coalesced and delivered when the outermost batch ends.
+        // endBatchDeferred doesn't invoke the observers (for destructors), they're notified later from the reactor.
+        // Use WalletDbBatch rather than calling these directly
+        virtual void beginBatch() = 0;
+        virtual void endBatch() = 0;
+        virtual void endBatchDeferred() = 0;
+
         virtual void changePassword(const SecString& password) = 0;
 
         // Block History management, used in FlyClient
@@ -430,12 +454,105 @@ namespace beam::wallet
            bool get_CommitmentSafe(ECC::Point& comm, const CoinID&, IPrivateKeyKeeper2*);
     };
 
+    // Keeps the wallet DB in batch mode until commit() or the end of its lifetime.
+    // commit() delivers the notifications (observers may throw), the destructor only defers them.
+    class WalletDbBatch
+    {
+    public:
+        explicit WalletDbBatch(IWalletDB& db)
+            : m_DB(db)
+        {
+            m_DB.beginBatch();
+        }
+        ~WalletDbBatch()
+        {
+            if (m_Active)
+            {
+                try
+                {
+                    m_DB.endBatchDeferred();
+                }
+                catch (...)
+                {
+                    // must not throw from the destructor
+                }
+            }
+        }
+        void commit()
+        {
+            if (m_Active)
+            {
+                m_Active = false;
+                m_DB.endBatch();
+            }
+        }
+        WalletDbBatch(const WalletDbBatch&) = delete;
+        WalletDbBatch& operator=(const WalletDbBatch&) = delete;
+    private:
+        IWalletDB& m_DB;
+        bool m_Active = true;
+    };
+
     namespace sqlite
     {
         struct Statement;
         struct Transaction;
     }  // namespace sqlite
 
+    // Cache of the tx parameters, bounded by the total size of the cached values.
+    // Transactions are evicted as a whole, least recently used first.
+    // Active transactions (according to their Status parameter) are pinned and never evicted.
+    class TxParametersCache
+    {
+    public:
+        using Value = boost::optional<ByteBuffer>; // none - the parameter is known to be absent
+
+        struct Stats
+        {
+            uint64_t m_Hits = 0;
+            uint64_t m_Misses = 0;
+            uint64_t m_Evicted = 0; // transactions
+            size_t m_Txs = 0;
+            size_t m_Pinned = 0;
+            size_t m_Size = 0;
+        };
+
+        static const size_t s_DefaultMaxSize = 8 << 20;
+        static const size_t s_ParamOverhead = 64; // approximate memory cost of a cached parameter, besides its value
+
+        explicit TxParametersCache(size_t maxSize = s_DefaultMaxSize);
+
+        // nullptr if not cached
+        const Value* find(const TxID& txID, SubTxID subTxID, TxParameterID paramID);
+        // same, for the internal lookups of the writers: doesn't affect the stats and the LRU order
+        const Value* peek(const TxID& txID, SubTxID subTxID, TxParameterID paramID);
+        void insert(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const Value& value);
+        void erase(const TxID& txID);
+
+        void setMaxSize(size_t maxSize);
+        Stats getStats() const;
+
+    private:
+        struct Entry
+        {
+            std::map<std::pair<SubTxID, TxParameterID>, Value> m_Params;
+            size_t m_Size = 0;
+            bool m_Pinned = false;
+            std::list<TxID>::iterator m_itLru; // valid if not pinned
+        };
+
+        std::map<TxID, Entry> m_Entries;
+        std::list<TxID> m_Lru; // not pinned only, most recently used first
+        size_t m_MaxSize;
+        Stats m_Stats;
+
+        const Value* lookup(const TxID& txID, SubTxID subTxID, TxParameterID paramID, bool isRead);
+        void touch(Entry& entry);
+        void setPinned(const TxID& txID, Entry& entry, bool pinned);
+        void evict();
+        static size_t getSize(const Value& value);
+    };
+
     class WalletDB : public IWalletDB
     {
     public:
@@ -473,7 +590,7 @@ namespace beam::wallet
         bool findCoin(Coin& coin) override;
         void clearCoins() override;
 
-        void visitCoins(std::function<bool(const Coin& coin)> func) override;
+        void visitCoins(std::function<bool(const Coin& coin)> func, uint64_t skip = 0, uint64_t count = 0) override;
 
         void setVarRaw(const char* name, const void* data, size_t size) override;
         bool getVarRaw(const char* name, void* data, int size) const override;
@@ -487,6 +604,9 @@ namespace beam::wallet
         void rollbackConfirmedUtxo(Height minHeight) override;
 
         std::vector<TxDescription> getTxHistory(wallet::TxType txType, uint64_t start, int count) const override;
+        std::vector<TxDescription> getTxHistory(const TxHistoryFilter& filter, uint64_t start, int count) const override;
+        std::vector<TxDescription> getActiveTxs() const override;
+        std::vector<TxDescription> getTxsConfirmedAbove(Height h) const override;
         boost::optional<TxDescription> getTx(const TxID& txId) const override;
         void saveTx(const TxDescription& p) override;
         void deleteTx(const TxID& txId) override;
@@ -494,6 +614,7 @@ namespace beam::wallet
         void deleteCoinsCreatedByTx(const TxID& txId) override;
 
         std::vector<WalletAddress> getAddresses(bool own) const override;
+        void visitAddresses(bool own, std::function<bool(const WalletAddress& address)> func) const override;
         void saveAddress(const WalletAddress&, bool isLaser = false) override;
         boost::optional<WalletAddress> getAddress(
             const WalletID&, bool isLaser = false) const override;
@@ -512,6 +633,10 @@ namespace beam::wallet
         void Subscribe(IWalletDbObserver* observer) override;
         void Unsubscribe(IWalletDbObserver* observer) override;
 
+        void beginBatch() override;
+        void endBatch() override;
+        void endBatchDeferred() override;
+
         void changePassword(const SecString& password) override;
 
         bool setTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID,
@@ -543,6 +668,9 @@ namespace beam::wallet
         std::vector<ExchangeRate> getExchangeRates() const override;
         void saveExchangeRate(const ExchangeRate&) override;
 
+        TxParametersCache::Stats getTxParametersCacheStats() const;
+        void setTxParametersCacheSize(size_t maxSize);
+
     private:
         static std::shared_ptr<WalletDB> initBase(const std::string& path, const SecString& password, bool separateDBForPrivateData);
         void storeOwnerKey();
@@ -556,6 +684,7 @@ namespace beam::wallet
         void notifyTransactionChanged(ChangeAction action, const std::vector<TxDescription>& items);
         void notifySystemStateChanged(const Block::SystemState::ID& stateID);
         void notifyAddressChanged(ChangeAction action, const std::vector<WalletAddress>& items);
+        void flushNotifications();
 
         bool updateCoinRaw(const Coin&);
         void insertCoinRaw(const Coin&);
@@ -565,11 +694,15 @@ namespace beam::wallet
         std::vector<Coin> getUpdatedCoins(const std::vector<Coin>& coins) const;
         // ////////////////////////////////////////
         // Cache for optimized access for database fields
-        using ParameterCache = std::map<TxID, std::map<SubTxID, std::map<TxParameterID, boost::optional<ByteBuffer>>>>;
-
         void insertParameterToCache(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const boost::optional<ByteBuffer>& blob) const;
         void deleteParametersFromCache(const TxID& txID);
-        bool hasTransaction(const TxID& txID) const;
+        bool hasTransaction(const TxID& txID) const; // for the writers, doesn't affect the cache stats
+        bool getTxParameterImpl(const TxID& txID, SubTxID subTxID, TxParameterID paramID, ByteBuffer& blob, bool isRead) const;
+        // Denormalized tx summary, kept in sync with the tx parameters
+        void updateTxSummary(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob);
+        sqlite::Statement& getTxSummaryStatement(size_t index, const char* column);
+        void fillTxSummary();
+        std::vector<TxDescription> loadTxs(sqlite::Statement& stm) const;
         void insertAddressToCache(const WalletID& id, const boost::optional<WalletAddress>& address) const;
         void deleteAddressFromCache(const WalletID& id);
         void flushDB();
@@ -590,22 +723,41 @@ namespace beam::wallet
         io::Timer::Ptr m_FlushTimer;
         bool m_IsFlushPending;
         std::unique_ptr<sqlite::Transaction> m_DbTransaction;
+        std::vector<std::unique_ptr<sqlite::Statement>> m_TxSummaryStatements; // prepared once, by the updated column
         std::vector<IWalletDbObserver*> m_subscribers;
         const std::set<TxParameterID> m_mandatoryTxParams;
 
+        // Notifications held back while in batch mode, in the order of arrival
+        uint32_t m_BatchDepth = 0;
+        io::Timer::Ptr m_NotifyTimer; // delivers the notifications of the batch ended by endBatchDeferred
+        template <typename T>
+        using ChangesList = std::vector<std::pair<ChangeAction, std::vector<T>>>;
+        ChangesList<Coin> m_PendingCoinsChanges;
+        ChangesList<TxDescription> m_PendingTransactionChanges;
+        ChangesList<WalletAddress> m_PendingAddressChanges;
+        boost::optional<Block::SystemState::ID> m_PendingStateID;
+
         // Wallet has ablity to track blockchain state
         // This interface allows to check and update the blockchain state 
         // in the wallet database. Used in FlyClient implementation
+        // The recent states are loaded once and served from memory, modifications are written to both
         struct History :public Block::SystemState::IHistory {
             bool Enum(IWalker&, const Height* pBelow) override;
             bool get_At(Block::SystemState::Full&, Height) override;
             void AddStates(const Block::SystemState::Full*, size_t nCount) override;
             void DeleteFrom(Height) override;
 
+            void DeleteBelow(Height); // inclusive
+            void Invalidate();
+
+            Block::SystemState::HistoryMap m_Cache;
+            bool m_Loaded = false;
+            Block::SystemState::HistoryMap& get_Cache();
+
             IMPLEMENT_GET_PARENT_OBJ(WalletDB, m_History)
         } m_History;
         
-        mutable ParameterCache m_TxParametersCache;
+        mutable TxParametersCache m_TxParametersCache;
         mutable std::map<WalletID, boost::optional<WalletAddress>> m_AddressesCache;
 
         struct LocalKeyKeeper;
@@ -45,7 +45,7 @@ namespace beam::wallet {
 
     BaseMessageEndpoint::~BaseMessageEndpoint()
     {
-        
+        m_Decryptor.Stop();
     }
 
     void BaseMessageEndpoint::Subscribe()
@@ -66,56 +66,96 @@ namespace beam::wallet {
 
     void BaseMessageEndpoint::ProcessMessage(BbsChannel channel, const ByteBuffer& msg)
     {
-        Addr::Channel key;
-        key.m_Value = channel;
+        auto pKeys = get_ChannelKeys(channel);
+        if (!pKeys)
+            return; // not subscribed
+
+        if (!m_pKdfSbbs)
+        {
+            // read-only wallet
+            m_WalletDB->saveIncomingWalletMessage(channel, msg);
+            OnIncomingMessage();
+            return;
+        }
+
+        BbsDecryptor::Task::Ptr pTask = std::make_unique<BbsDecryptor::Task>();
+        pTask->m_Channel = channel;
+        pTask->m_Msg = msg;
+        pTask->m_pKeys = std::move(pKeys);
 
-        for (ChannelSet::iterator it = m_Channels.lower_bound(key); ; ++it)
+        if (!m_Decryptor.m_pEvt)
         {
-            if (m_Channels.end() == it)
-                break;
-            if (it->m_Value != channel)
-                break; // as well
+            m_Decryptor.m_pEvt = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { OnDecrypted(); });
+            m_Decryptor.m_Shutdown = false;
+            m_Decryptor.m_Thread = std::thread(&BbsDecryptor::Thread, &m_Decryptor);
+        }
 
+        std::unique_lock<std::mutex> scope(m_Decryptor.m_Mutex);
 
-            if (!m_pKdfSbbs)
+        m_Decryptor.m_Pending.push_back(std::move(pTask));
+        m_Decryptor.m_NewTask.notify_one();
+    }
+
+    void BaseMessageEndpoint::OnDecrypted()
+    {
+        while (true)
+        {
+            BbsDecryptor::Task::Ptr pTask;
             {
-                // read-only wallet
-                m_WalletDB->saveIncomingWalletMessage(channel, msg);
-                OnIncomingMessage();
-                return;
-            }
+                std::unique_lock<std::mutex> scope(m_Decryptor.m_Mutex);
 
-            ByteBuffer buf = msg; // duplicate
-            uint8_t* pMsg = &buf.front();
-            uint32_t nSize = static_cast<uint32_t>(buf.size());
+                if (m_Decryptor.m_Done.empty())
+                    break;
 
-            if (!proto::Bbs::Decrypt(pMsg, nSize, it->get_ParentObj().m_sk))
-                continue;
+                pTask = std::move(m_Decryptor.m_Done.front());
+                m_Decryptor.m_Done.pop_front();
+            }
 
             SetTxParameter msgWallet;
-            bool bValid = false;
 
             try {
                 Deserializer der;
-                der.reset(pMsg, nSize);
+                der.reset(pTask->m_Plaintext);
                 der& msgWallet;
-                bValid = true;
             }
             catch (const std::exception&) {
                 LOG_WARNING() << "BBS deserialization failed";
+                continue;
             }
 
-            if (bValid)
-            {
-                WalletID wid;
-                wid.m_Pk = it->get_ParentObj().m_Pk;
-                wid.m_Channel = it->m_Value;
-                m_Wallet.OnWalletMessage(wid, msgWallet);
-                break;
-            }
+            WalletID wid;
+            wid.m_Pk = pTask->m_pKey->m_Pk;
+            wid.m_Channel = pTask->m_Channel;
+            m_Wallet.OnWalletMessage(wid, msgWallet);
         }
     }
 
+    std::shared_ptr<const BbsDecryptor::KeyList> BaseMessageEndpoint::get_ChannelKeys(BbsChannel channel)
+    {
+        auto itK = m_ChannelKeys.find(channel);
+        if (m_ChannelKeys.end() != itK)
+            return itK->second;
+
+        Addr::Channel key;
+        key.m_Value = channel;
+
+        auto pKeys = std::make_shared<BbsDecryptor::KeyList>();
+        for (ChannelSet::iterator it = m_Channels.lower_bound(key); (m_Channels.end() != it) && (it->m_Value == channel); ++it)
+        {
+            const Addr& addr = it->get_ParentObj();
+
+            pKeys->emplace_back();
+            pKeys->back().m_sk = addr.m_sk;
+            pKeys->back().m_Pk = addr.m_Pk;
+        }
+
+        if (pKeys->empty())
+            return nullptr;
+
+        m_ChannelKeys[channel] = pKeys;
+        return pKeys;
+    }
+
     void BaseMessageEndpoint::AddOwnAddress(const WalletAddress& address)
     {
         if (!m_pKdfSbbs)
@@ -139,6 +179,7 @@ namespace beam::wallet {
 
             m_Addresses.insert(pAddr->m_Wid);
             m_Channels.insert(pAddr->m_Channel);
+            m_ChannelKeys.erase(pAddr->m_Channel.m_Value);
         }
         else
         {
@@ -171,6 +212,7 @@ namespace beam::wallet {
             OnChannelDeleted(v.m_Channel.m_Value);
         }
 
+        m_ChannelKeys.erase(v.m_Channel.m_Value);
         m_Addresses.erase(WidSet::s_iterator_to(v.m_Wid));
         m_Channels.erase(ChannelSet::s_iterator_to(v.m_Channel));
         delete& v;
@@ -248,7 +290,7 @@ namespace beam::wallet {
     {
         try
         {
-            m_Miner.Stop();
+            m_pMiner.reset();
             while (!m_PendingBbsMsgs.empty())
                 DeleteReq(m_PendingBbsMsgs.front());
         }
@@ -267,7 +309,6 @@ namespace beam::wallet {
         BbsMiner::Task::Ptr pTask = std::make_shared<BbsMiner::Task>();
         pTask->m_Msg.m_Message = msg;
 
-        pTask->m_Done = false;
         pTask->m_Msg.m_Channel = channel_from_wallet_id(peerID);
 
         pTask->m_StoredMessageID = messageID; // store id to be able to remove if send succeeded
@@ -276,23 +317,10 @@ namespace beam::wallet {
         {
             proto::Bbs::get_HashPartial(pTask->m_hpPartial, pTask->m_Msg);
 
-            if (!m_Miner.m_pEvt)
-            {
-                m_Miner.m_pEvt = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { OnMined(); });
-                m_Miner.m_Shutdown = false;
+            if (!m_pMiner)
+                m_pMiner = std::make_unique<BbsMiner::Client>([this]() { OnMined(); });
 
-                uint32_t nThreads = std::thread::hardware_concurrency();
-                nThreads = (nThreads > 1) ? (nThreads - 1) : 1; // leave at least 1 vacant core for other things
-                m_Miner.m_vThreads.resize(nThreads);
-
-                for (uint32_t i = 0; i < nThreads; i++)
-                    m_Miner.m_vThreads[i] = std::thread(&BbsMiner::Thread, &m_Miner, i);
-            }
-
-            std::unique_lock<std::mutex> scope(m_Miner.m_Mutex);
-
-            m_Miner.m_Pending.push_back(std::move(pTask));
-            m_Miner.m_NewTask.notify_all();
+            m_pMiner->Push(std::move(pTask));
         }
         else
         {
@@ -448,17 +476,7 @@ namespace beam::wallet {
 	{
 		while (true)
 		{
-			BbsMiner::Task::Ptr pTask;
-			{
-				std::unique_lock<std::mutex> scope(m_Miner.m_Mutex);
-
-				if (!m_Miner.m_Done.empty())
-				{
-					pTask = std::move(m_Miner.m_Done.front());
-					m_Miner.m_Done.pop_front();
-				}
-			}
-
+			BbsMiner::Task::Ptr pTask = m_pMiner->Pop();
 			if (!pTask)
 				break;
 
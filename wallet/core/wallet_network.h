@@ -18,6 +18,7 @@
 #include "core/proto.h"
 #include "utility/io/timer.h"
 #include "bbs_miner.h"
+#include "bbs_decryptor.h"
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 #include "wallet_request_bbs_msg.h"
@@ -68,6 +69,8 @@ namespace beam::wallet
     private:
         void DeleteAddr(const Addr&);
         bool IsSingleChannelUser(const Addr::Channel&);
+        std::shared_ptr<const BbsDecryptor::KeyList> get_ChannelKeys(BbsChannel);
+        void OnDecrypted();
 
         // IWalletMessageEndpoint
         void Send(const WalletID& peerID, const SetTxParameter& msg) override;
@@ -80,6 +83,10 @@ namespace beam::wallet
         typedef  bi::multiset<Addr::Channel> ChannelSet;
         ChannelSet m_Channels;
 
+        // keys of each channel, rebuilt lazily after the channel addresses are changed
+        std::map<BbsChannel, std::shared_ptr<const BbsDecryptor::KeyList> > m_ChannelKeys;
+        BbsDecryptor m_Decryptor;
+
         IWalletMessageConsumer& m_Wallet;
         IWalletDB::Ptr m_WalletDB;
         Key::IKdf::Ptr m_pKdfSbbs;
@@ -115,7 +122,7 @@ namespace beam::wallet
             IMPLEMENT_GET_PARENT_OBJ(BbsSender, m_BbsSentEvt)
         } m_BbsSentEvt;
 
-        BbsMiner m_Miner;
+        std::unique_ptr<BbsMiner::Client> m_pMiner;
     };
 
     class WalletNetworkViaBbs
@@ -25,7 +25,7 @@ Connection::Connection(const FlyClient::NetworkStd::Ptr& net)
 
 Connection::~Connection()
 {
-    m_Miner.Stop();
+    m_pMiner.reset();
 }
 
 void Connection::Connect()
@@ -75,17 +75,7 @@ void Connection::OnMined()
 {
     while (true)
     {
-        BbsMiner::Task::Ptr pTask;
-        {
-            std::unique_lock<std::mutex> scope(m_Miner.m_Mutex);
-
-            if (!m_Miner.m_Done.empty())
-            {
-                pTask = std::move(m_Miner.m_Done.front());
-                m_Miner.m_Done.pop_front();
-            }
-        }
-
+        BbsMiner::Task::Ptr pTask = m_pMiner->Pop();
         if (!pTask)
             break;
 
@@ -109,30 +99,15 @@ void Connection::MineBbsRequest(FlyClient::RequestBbsMsg& r)
 {
     BbsMiner::Task::Ptr pTask = std::make_shared<BbsMiner::Task>();
     pTask->m_Msg = r.m_Msg;
-    pTask->m_Done = false;
+    pTask->m_Priority = 1; // laser channel updates are time-critical
 
     proto::Bbs::get_HashPartial(pTask->m_hpPartial, pTask->m_Msg);
 
-    if (!m_Miner.m_pEvt)
-    {
-        m_Miner.m_pEvt = io::AsyncEvent::create(
-            io::Reactor::get_Current(),
-            [this] () { OnMined(); });
-        m_Miner.m_Shutdown = false;
-
-        uint32_t nThreads = std::thread::hardware_concurrency();
-        nThreads = (nThreads > 1) ? (nThreads - 1) : 1; // leave at least 1 vacant core for other things
-        m_Miner.m_vThreads.resize(nThreads);
-
-        for (uint32_t i = 0; i < nThreads; i++)
-            m_Miner.m_vThreads[i] = std::thread(&BbsMiner::Thread, &m_Miner, i);
-    }
-
-    std::unique_lock<std::mutex> scope(m_Miner.m_Mutex);
+    if (!m_pMiner)
+        m_pMiner = std::make_unique<BbsMiner::Client>([this] () { OnMined(); });
 
     m_handlers[pTask] = r.m_pTrg;
-    m_Miner.m_Pending.push_back(std::move(pTask));
-    m_Miner.m_NewTask.notify_all();
+    m_pMiner->Push(std::move(pTask));
 }
 
 }  // namespace beam::wallet::laser
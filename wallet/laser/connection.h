@@ -40,7 +40,7 @@ private:
 
     FlyClient::NetworkStd::Ptr m_pNet;
 
-    BbsMiner m_Miner;
+    std::unique_ptr<BbsMiner::Client> m_pMiner;
     bool m_MineOutgoing = true;
     std::unordered_map<
         BbsMiner::Task::Ptr,
@@ -201,14 +201,22 @@ namespace
             }
 
             auto range = m_Channels.lower_bound_range(msg.m_Channel);
+            if (range.first == range.second)
+            {
+                return;
+            }
 
-            for (auto it = range.first; it != range.second; ++it)
+            proto::Bbs::Decryptor dec;
+            if (!dec.Init(&msg.m_Message.front(), static_cast<uint32_t>(msg.m_Message.size())))
             {
-                ByteBuffer buf = msg.m_Message; // duplicate
-                uint8_t* pMsg = &buf.front();
-                uint32_t nSize = static_cast<uint32_t>(buf.size());
+                return;
+            }
+
+            ByteBuffer buf; // reused across the attempts
 
-                if (!proto::Bbs::Decrypt(pMsg, nSize, it->m_PrivateKey))
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (!dec.Decrypt(buf, it->m_PrivateKey, it->m_Address.m_Pk))
                     continue;
 
                 SetTxParameter msgWallet;
@@ -217,7 +225,7 @@ namespace
                 try 
                 {
                     Deserializer der;
-                    der.reset(pMsg, nSize);
+                    der.reset(buf);
                     der& msgWallet;
                     bValid = true;
                 }
@@ -222,6 +222,7 @@ namespace
         struct IApiConnectionHandler
         {
             virtual void serializeMsg(const json& msg) = 0;
+            virtual bool serializeMsgStream(const ApiConnection::StreamFunc& func) = 0;
             using KeyKeeperFunc = std::function<void(const json&)>;
             virtual void sendAsync(const json& msg, KeyKeeperFunc func) = 0;
         };
@@ -470,6 +471,11 @@ namespace
                 _handler->serializeMsg(msg);
             }
 
+            bool serializeMsgStream(const StreamFunc& func) override
+            {
+                return _handler->serializeMsgStream(func);
+            }
+
         private:
             IApiConnectionHandler* _handler;
         };
@@ -520,6 +526,16 @@ namespace
                 _sendFunc(msg.dump());
             }
 
+            bool serializeMsgStream(const ApiConnection::StreamFunc& func) override
+            {
+                std::string data;
+                if (!ApiConnection::bufferMsgStream(func, data))
+                    return false;
+
+                _sendFunc(data);
+                return true;
+            }
+
             void sendAsync(const json& msg, KeyKeeperFunc func) override
             {
                 _keeperCallbacks.push(std::move(func));
@@ -629,10 +629,15 @@ namespace
             nonExpiredHeight.m_Height = *h + *t - Height(1);
 
             uint32_t exCount = 0;
-            MockBoardObserver obsRemove([&exCount](ChangeAction action, const vector<SwapOffer>& offers) {
+            uint32_t notificationsCount = 0;
+            MockBoardObserver obsRemove([&exCount, &notificationsCount](ChangeAction action, const vector<SwapOffer>& offers) {
                 WALLET_CHECK(action == ChangeAction::Removed);
-                WALLET_CHECK(offers.front().m_status == SwapOfferStatus::Expired);
-                exCount++;
+                for (const auto& offer : offers)
+                {
+                    WALLET_CHECK(offer.m_status == SwapOfferStatus::Expired);
+                }
+                exCount += static_cast<uint32_t>(offers.size());
+                notificationsCount++;
             });
 
             Bob.Subscribe(&obsRemove);
@@ -648,6 +653,7 @@ namespace
             WALLET_CHECK(Alice.getOffersList().size() == offerCount - 2);
             WALLET_CHECK(Bob.getOffersList().size() == offerCount);
             WALLET_CHECK(exCount == 2);
+            WALLET_CHECK(notificationsCount == 1);  // expired offers are reported together
 
             // check expired offer 
             Alice.Subscribe(&obsRemove);
@@ -721,6 +727,104 @@ namespace
         cout << "Test end" << endl;
     }
 
+
+    void TestOffersIndex()
+    {
+        cout << endl << "Test offers index" << endl;
+
+        auto storage = createSqliteWalletDB();
+        std::shared_ptr<IPrivateKeyKeeper> keyKeeper =
+            make_shared<LocalPrivateKeyKeeper>(storage, storage->get_MasterKdf());
+        OfferBoardProtocolHandler protocolHandler(keyKeeper->get_SbbsKdf(), storage);
+        MockBbsNetwork mockNetwork;
+        BroadcastRouter broadcastRouterA(mockNetwork, mockNetwork);
+        BroadcastRouter broadcastRouterB(mockNetwork, mockNetwork);
+
+        SwapOffersBoard Alice(broadcastRouterA, protocolHandler);
+        SwapOffersBoard Bob(broadcastRouterB, protocolHandler);
+
+        SwapOffer correctOffer;
+        std::tie(correctOffer, std::ignore) = generateTestOffer(storage, keyKeeper);
+        TxID txID = correctOffer.m_txId;
+
+        const AtomicSwapCoin coins[] = { AtomicSwapCoin::Bitcoin, AtomicSwapCoin::Litecoin, AtomicSwapCoin::Qtum };
+        const size_t offersPerCoin = 5;
+        const Height responseTime = 100;
+        const Height minHeight = 100;
+        {
+            cout << "Case: offers filtered by coin and paged" << endl;
+
+            for (auto coin : coins)
+            {
+                for (size_t i = 0; i < offersPerCoin; ++i)
+                {
+                    SwapOffer o = createOffer(incrementTxID(txID), SwapOfferStatus::Pending, correctOffer.m_publisherId, coin);
+                    o.SetParameter(TxParameterID::MinHeight, minHeight + i);
+                    o.SetParameter(TxParameterID::PeerResponseTime, responseTime);
+                    Alice.publishOffer(o);
+                }
+            }
+            WALLET_CHECK(Bob.getOffersList().size() == offersPerCoin * std::size(coins));
+
+            SwapOffersBoard::Filter filter;
+            filter.coin = AtomicSwapCoin::Litecoin;
+            WALLET_CHECK(Bob.getOffersCount(filter) == offersPerCoin);
+
+            auto page1 = Bob.getOffersList(filter, 0, 3);
+            auto page2 = Bob.getOffersList(filter, 3, 3);
+            WALLET_CHECK(page1.size() == 3);
+            WALLET_CHECK(page2.size() == offersPerCoin - 3);
+
+            // pages follow each other in the order of expiration
+            page1.insert(page1.end(), page2.begin(), page2.end());
+            for (size_t i = 0; i < page1.size(); ++i)
+            {
+                WALLET_CHECK(page1[i].m_coin == AtomicSwapCoin::Litecoin);
+                WALLET_CHECK(page1[i].minHeight() == minHeight + i);
+            }
+
+            auto offer = Bob.getOffer(page1.front().m_txId);
+            WALLET_CHECK(offer && offer->m_txId == page1.front().m_txId);
+
+            filter.status = SwapOfferStatus::Expired;
+            WALLET_CHECK(Bob.getOffersCount(filter) == 0);
+        }
+        {
+            cout << "Case: expired offers leave the index" << endl;
+
+            uint32_t exCount = 0;
+            uint32_t notificationsCount = 0;
+            MockBoardObserver obsRemove([&exCount, &notificationsCount](ChangeAction action, const vector<SwapOffer>& offers) {
+                WALLET_CHECK(action == ChangeAction::Removed);
+                exCount += static_cast<uint32_t>(offers.size());
+                notificationsCount++;
+            });
+
+            Block::SystemState::ID stateID = {};
+            stateID.m_Height = minHeight + responseTime + 2; // first 3 offers of each coin
+            Bob.Subscribe(&obsRemove);
+            Bob.onSystemStateChanged(stateID);
+            Bob.Unsubscribe(&obsRemove);
+
+            WALLET_CHECK(notificationsCount == 1);
+            WALLET_CHECK(exCount == 3 * std::size(coins));
+            WALLET_CHECK(Bob.getOffersList().size() == (offersPerCoin - 3) * std::size(coins));
+
+            SwapOffersBoard::Filter filter;
+            filter.status = SwapOfferStatus::Expired;
+            filter.coin = AtomicSwapCoin::Qtum;
+            WALLET_CHECK(Bob.getOffersCount(filter) == 3);
+
+            // nothing else to expire
+            Bob.Subscribe(&obsRemove);
+            Bob.onSystemStateChanged(stateID);
+            Bob.Unsubscribe(&obsRemove);
+            WALLET_CHECK(notificationsCount == 1);
+        }
+
+        cout << "Test end" << endl;
+    }
+
 } // namespace
 
 int main()
@@ -737,6 +841,7 @@ int main()
     TestCommunication();
     TestLinkedTransactionChanges();
     TestDelayedOfferUpdate();
+    TestOffersIndex();
 
     boost::filesystem::remove(dbFileName);
 
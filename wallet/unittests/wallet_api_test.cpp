@@ -204,6 +204,20 @@ namespace
                 WALLET_CHECK(result[i]["type"] == "norm");
                 WALLET_CHECK(result[i]["maturity"] == 60);
             }
+
+            // streamed response must be the same
+            std::string buf;
+            JsonStreamWriter writer(buf);
+            WalletApi::beginListResponse(writer, 123);
+            for (const auto& coin : getUtxo.utxos)
+            {
+                json item;
+                WalletApi::getUtxoJson(coin, item);
+                writer.value(item);
+            }
+            WalletApi::endListResponse(writer);
+            WALLET_CHECK(writer.finalize());
+            WALLET_CHECK(json::parse(buf) == res);
         }
     }
 
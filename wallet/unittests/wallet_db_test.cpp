@@ -14,12 +14,15 @@
 
 #include "wallet/core/wallet_db.h"
 #include "wallet/core/base_transaction.h"
+#include "sqlite/sqlite3.h"
 #include <assert.h>
 #include "test_helpers.h"
 #include "utility/test_helpers.h"
 
 #include "utility/logger.h"
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cstring>
 #include <numeric>
 #include <queue>
 
@@ -364,6 +367,182 @@ void TestStoreTxRecord()
     WALLET_CHECK(t.size() == 0);
 }
 
+void TestTxSummary()
+{
+    cout << "\nWallet database tx summary test\n";
+    const char* dbName = "wallet.db";
+    const SecString pass("pass123");
+    auto walletDB = createSqliteWalletDB();
+
+    auto createTx = [](uint8_t i)
+    {
+        TxID txID = { {i} };
+        TxDescription tx(txID);
+        tx.m_txType = (i % 4) ? TxType::Simple : TxType::AtomicSwap;
+        tx.m_amount = 1000 + i;
+        tx.m_fee = 10;
+        tx.m_myId.m_Pk = unsigned(42);
+        tx.m_peerId.m_Pk = unsigned(23);
+        tx.m_createTime = 1000 + (i % 10);
+        tx.m_sender = (i % 2) != 0;
+        tx.m_status = (i % 3) ? TxStatus::Completed : TxStatus::InProgress;
+        return tx;
+    };
+
+    for (uint8_t i = 0; i < 40; ++i)
+    {
+        walletDB->saveTx(createTx(i));
+    }
+
+    auto checkHistory = [&](IWalletDB& db)
+    {
+        auto t = db.getTxHistory(TxType::ALL);
+        WALLET_CHECK(t.size() == 40);
+        for (size_t i = 1; i < t.size(); ++i)
+        {
+            // newest first
+            WALLET_CHECK(t[i - 1].m_createTime >= t[i].m_createTime);
+        }
+
+        WALLET_CHECK(db.getTxHistory(TxType::Simple).size() == 30);
+        WALLET_CHECK(db.getTxHistory(TxType::AtomicSwap).size() == 10);
+
+        TxHistoryFilter filter;
+        filter.m_Type = TxType::ALL;
+        filter.m_Status = TxStatus::InProgress;
+        t = db.getTxHistory(filter, 0, std::numeric_limits<int>::max());
+        WALLET_CHECK(t.size() == 15);
+        for (const auto& tx : t)
+        {
+            WALLET_CHECK(tx.m_status == TxStatus::InProgress);
+        }
+
+        t = db.getTxHistory(filter, 10, 10);
+        WALLET_CHECK(t.size() == 5);
+
+        filter.m_Status.reset();
+        filter.m_KernelProofHeight = 134;
+        t = db.getTxHistory(filter, 0, std::numeric_limits<int>::max());
+        WALLET_CHECK(t.size() == 1 && t[0].m_txId[0] == 7);
+
+        t = db.getActiveTxs();
+        WALLET_CHECK(t.size() == 15);
+        for (const auto& tx : t)
+        {
+            WALLET_CHECK(tx.canResume());
+        }
+
+        // confirmation heights of all the sub-txs are taken into account
+        WALLET_CHECK(db.getTxsConfirmedAbove(129).size() == 3);
+        t = db.getTxsConfirmedAbove(133);
+        WALLET_CHECK(t.size() == 2);
+        for (const auto& tx : t)
+        {
+            WALLET_CHECK(tx.m_txId[0] == 7 || tx.m_txId[0] == 8);
+        }
+        WALLET_CHECK(db.getTxsConfirmedAbove(140).empty());
+    };
+
+    // status and kernel height are updated later, not through saveTx
+    {
+        TxDescription tx = createTx(1);
+        tx.m_status = TxStatus::InProgress;
+        WALLET_CHECK(storage::setTxParameter(*walletDB, tx.m_txId, TxParameterID::Status, tx.m_status, false));
+        WALLET_CHECK(storage::setTxParameter(*walletDB, createTx(7).m_txId, TxParameterID::KernelProofHeight, Height(134), false));
+        WALLET_CHECK(storage::setTxParameter(*walletDB, createTx(8).m_txId, SubTxID(3), TxParameterID::KernelProofHeight, Height(140), false));
+        WALLET_CHECK(storage::setTxParameter(*walletDB, createTx(8).m_txId, SubTxID(2), TxParameterID::KernelProofHeight, Height(120), false));
+        WALLET_CHECK(storage::setTxParameter(*walletDB, createTx(9).m_txId, TxParameterID::AssetConfirmedHeight, Height(130), false));
+    }
+    checkHistory(*walletDB);
+
+    // deleted tx leaves its type parameter only, and must not be listed
+    walletDB->saveTx(createTx(100));
+    WALLET_CHECK(walletDB->getTxHistory(TxType::ALL).size() == 41);
+    walletDB->deleteTx(createTx(100).m_txId);
+    checkHistory(*walletDB);
+
+    // migration from the previous format rebuilds the summary from the parameters
+    walletDB.reset();
+    {
+        sqlite3* db = nullptr;
+        WALLET_CHECK(sqlite3_open_v2(dbName, &db, SQLITE_OPEN_READWRITE, nullptr) == SQLITE_OK);
+        WALLET_CHECK(sqlite3_key(db, pass.data(), static_cast<int>(pass.size())) == SQLITE_OK);
+        WALLET_CHECK(sqlite3_exec(db, "DROP TABLE txsummary;", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+        sqlite3_stmt* stm = nullptr;
+        WALLET_CHECK(sqlite3_prepare_v2(db, "UPDATE variables SET value=?1 WHERE name='Version';", -1, &stm, nullptr) == SQLITE_OK);
+        const int version = 19;
+        sqlite3_bind_blob(stm, 1, &version, sizeof(version), SQLITE_STATIC);
+        WALLET_CHECK(sqlite3_step(stm) == SQLITE_DONE);
+        sqlite3_finalize(stm);
+        sqlite3_close(db);
+    }
+    walletDB = WalletDB::open(dbName, pass);
+    checkHistory(*walletDB);
+}
+
+// 100k transactions with --benchmark, otherwise a quick run of the same checks
+void TestTxHistoryBenchmark(bool isBenchmark)
+{
+    cout << "\nWallet database tx history benchmark\n";
+    auto walletDB = createSqliteWalletDB();
+
+    const uint32_t Count = isBenchmark ? 100000 : 1000;
+    helpers::StopWatch sw;
+    sw.start();
+    for (uint32_t i = 0; i < Count; ++i)
+    {
+        TxID txID = {};
+        memcpy(txID.data(), &i, sizeof(i));
+        TxDescription tx(txID);
+        tx.m_amount = 1000 + i;
+        tx.m_myId.m_Pk = unsigned(42);
+        tx.m_createTime = i;
+        tx.m_sender = (i % 2) != 0;
+        tx.m_status = (i % 100) ? TxStatus::Completed : TxStatus::InProgress;
+        walletDB->saveTx(tx);
+        if (i % 100 == 1)
+        {
+            storage::setTxParameter(*walletDB, txID, TxParameterID::KernelProofHeight, Height(i), false);
+        }
+    }
+    sw.stop();
+    cout << "Saving " << Count << " transactions: " << sw.milliseconds() << " ms\n";
+
+    sw.start();
+    auto t = walletDB->getTxHistory(TxType::Simple, 0, 100);
+    sw.stop();
+    cout << "First page: " << sw.milliseconds() << " ms\n";
+    WALLET_CHECK(t.size() == 100 && t[0].m_createTime == Count - 1);
+
+    sw.start();
+    t = walletDB->getTxHistory(TxType::Simple, Count / 2, 100);
+    sw.stop();
+    cout << "Middle page: " << sw.milliseconds() << " ms\n";
+    WALLET_CHECK(t.size() == 100 && t[0].m_createTime == Count / 2 - 1);
+#ifdef NDEBUG
+    WALLET_CHECK(sw.milliseconds() <= 1000);
+#endif // NDEBUG
+
+    sw.start();
+    t = walletDB->getActiveTxs();
+    sw.stop();
+    cout << "Active transactions: " << sw.milliseconds() << " ms\n";
+    WALLET_CHECK(t.size() == Count / 100);
+
+    sw.start();
+    t = walletDB->getTxsConfirmedAbove(Count - 1000);
+    sw.stop();
+    cout << "Rollback candidates: " << sw.milliseconds() << " ms\n";
+    WALLET_CHECK(t.size() == 10);
+
+    sw.start();
+    t = walletDB->getTxHistory(TxType::ALL);
+    sw.stop();
+    cout << "Full history: " << sw.milliseconds() << " ms\n";
+    WALLET_CHECK(t.size() == Count);
+}
+
 void TestUTXORollback()
 {
     cout << "\nWallet database rollback test\n";
@@ -705,6 +884,108 @@ void TestAddresses()
     }
 }
 
+void TestPaging()
+{
+    cout << "\nWallet database paging test\n";
+    auto db = createSqliteWalletDB();
+
+    // coins are visited in the insertion order, skip/count are applied in SQL
+    const uint32_t nCoins = 25;
+    const uint32_t nPage = 10;
+    {
+        vector<Coin> coins;
+        for (uint32_t i = 0; i < nCoins; ++i)
+            coins.emplace_back(1000 + i);
+        db->storeCoins(coins);
+    }
+
+    auto visitPage = [&db](uint64_t skip, uint64_t count)
+    {
+        vector<Amount> res;
+        db->visitCoins([&res](const Coin& c)
+        {
+            res.push_back(c.m_ID.m_Value);
+            return true;
+        }, skip, count);
+        return res;
+    };
+
+    auto all = visitPage(0, 0);
+    WALLET_CHECK(all.size() == nCoins);
+    for (uint32_t i = 0; i < all.size(); ++i)
+        WALLET_CHECK(all[i] == 1000 + i);
+
+    vector<Amount> paged;
+    uint32_t nPages = 0;
+    for (uint64_t skip = 0; ; skip += nPage)
+    {
+        auto page = visitPage(skip, nPage);
+        WALLET_CHECK(page.size() == std::min<uint64_t>(nPage, nCoins - std::min<uint64_t>(skip, nCoins)));
+        if (page.empty())
+            break;
+
+        paged.insert(paged.end(), page.begin(), page.end());
+        nPages++;
+    }
+    WALLET_CHECK(nPages == (nCoins + nPage - 1) / nPage);
+    WALLET_CHECK(paged == all);
+
+    WALLET_CHECK(visitPage(nCoins - 1, nPage) == vector<Amount>{ all.back() }); // the last page
+    WALLET_CHECK(visitPage(nCoins, nPage).empty());
+    WALLET_CHECK(visitPage(nPage, 0).size() == nCoins - nPage); // no limit
+
+    uint32_t nVisited = 0;
+    db->visitCoins([&nVisited](const Coin&)
+    {
+        return ++nVisited < 3;
+    }, 0, nPage);
+    WALLET_CHECK(nVisited == 3);
+
+    // addresses are filtered by ownership in SQL, the newest first
+    const uint32_t nOwn = 7, nContacts = 5;
+    for (uint32_t i = 0; i < nOwn + nContacts; ++i)
+    {
+        WalletAddress a = {};
+        a.m_label = std::to_string(i);
+        a.m_createTime = 100 + i;
+        a.m_OwnID = (i < nOwn) ? (i + 1) : 0;
+        db->get_SbbsWalletID(a.m_walletID, 200 + i);
+        db->saveAddress(a);
+    }
+
+    for (bool own : { true, false })
+    {
+        vector<WalletAddress> addrs;
+        db->visitAddresses(own, [&addrs](const WalletAddress& a)
+        {
+            addrs.push_back(a);
+            return true;
+        });
+
+        WALLET_CHECK(addrs.size() == (own ? nOwn : nContacts));
+        for (size_t i = 0; i < addrs.size(); ++i)
+        {
+            WALLET_CHECK(addrs[i].isOwn() == own);
+            if (i)
+                WALLET_CHECK(addrs[i - 1].m_createTime > addrs[i].m_createTime);
+        }
+        WALLET_CHECK(addrs == db->getAddresses(own));
+
+        // stop at every possible boundary
+        for (size_t n = 1; n <= addrs.size(); ++n)
+        {
+            vector<WalletAddress> part;
+            db->visitAddresses(own, [&part, n](const WalletAddress& a)
+            {
+                part.push_back(a);
+                return part.size() < n;
+            });
+            WALLET_CHECK(part.size() == n);
+            WALLET_CHECK(std::equal(part.begin(), part.end(), addrs.begin()));
+        }
+    }
+}
+
 void TestExportImportTx()
 {
     cout << "\nWallet database transactions export/import test\n";
@@ -1073,6 +1354,98 @@ void TestTxParameters()
     WALLET_CHECK(p == pt2);
 }
 
+void TestTxParametersCache()
+{
+    cout << "\nWallet database transaction parameters cache test\n";
+
+    auto makeTxID = [](uint32_t i)
+    {
+        TxID txID = {};
+        memcpy(txID.data(), &i, sizeof(i));
+        return txID;
+    };
+
+    {
+        const size_t paramSize = 100;
+        const size_t txSize = TxParametersCache::s_ParamOverhead + paramSize;
+        TxParametersCache cache(10 * txSize);
+
+        ByteBuffer value(paramSize, 1);
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            cache.insert(makeTxID(i), kDefaultSubTxID, TxParameterID::Outputs, value);
+        }
+
+        // bounded, the least recently used are evicted
+        auto stats = cache.getStats();
+        WALLET_CHECK(stats.m_Size <= 10 * txSize);
+        WALLET_CHECK(stats.m_Txs == 10);
+        WALLET_CHECK(stats.m_Evicted == 10);
+        WALLET_CHECK(!cache.find(makeTxID(0), kDefaultSubTxID, TxParameterID::Outputs));
+        WALLET_CHECK(cache.find(makeTxID(19), kDefaultSubTxID, TxParameterID::Outputs));
+
+        // access makes it recent
+        WALLET_CHECK(cache.find(makeTxID(10), kDefaultSubTxID, TxParameterID::Outputs));
+        cache.insert(makeTxID(20), kDefaultSubTxID, TxParameterID::Outputs, value);
+        WALLET_CHECK(cache.find(makeTxID(10), kDefaultSubTxID, TxParameterID::Outputs));
+        WALLET_CHECK(!cache.find(makeTxID(11), kDefaultSubTxID, TxParameterID::Outputs));
+
+        // active txs are pinned, the absent parameters are cached too
+        cache.insert(makeTxID(100), kDefaultSubTxID, TxParameterID::Status, toByteBuffer(TxStatus::InProgress));
+        cache.insert(makeTxID(100), kDefaultSubTxID, TxParameterID::Kernel, boost::none);
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            cache.insert(makeTxID(i), kDefaultSubTxID, TxParameterID::Outputs, value);
+        }
+        auto pValue = cache.find(makeTxID(100), kDefaultSubTxID, TxParameterID::Kernel);
+        WALLET_CHECK(pValue && !*pValue);
+        WALLET_CHECK(cache.getStats().m_Pinned == 1);
+
+        // and evictable once completed
+        cache.insert(makeTxID(100), kDefaultSubTxID, TxParameterID::Status, toByteBuffer(TxStatus::Completed));
+        WALLET_CHECK(cache.getStats().m_Pinned == 0);
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            cache.insert(makeTxID(i), kDefaultSubTxID, TxParameterID::Outputs, value);
+        }
+        WALLET_CHECK(!cache.find(makeTxID(100), kDefaultSubTxID, TxParameterID::Status));
+
+        cache.erase(makeTxID(19));
+        WALLET_CHECK(!cache.find(makeTxID(19), kDefaultSubTxID, TxParameterID::Outputs));
+
+        stats = cache.getStats();
+        WALLET_CHECK(stats.m_Hits > 0 && stats.m_Misses > 0);
+        WALLET_CHECK(stats.m_Size == stats.m_Txs * txSize);
+    }
+
+    // evicted parameters are reloaded from the DB
+    auto walletDB = createSqliteWalletDB();
+    auto& db = static_cast<WalletDB&>(*walletDB);
+    db.setTxParametersCacheSize(4096);
+
+    const uint32_t count = 200;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        WALLET_CHECK(storage::setTxParameter(db, makeTxID(i), TxParameterID::Amount, Amount(i), false));
+        WALLET_CHECK(storage::setTxParameter(db, makeTxID(i), TxParameterID::Status, (i % 10) ? TxStatus::Completed : TxStatus::InProgress, false));
+    }
+
+    auto stats = db.getTxParametersCacheStats();
+    WALLET_CHECK(stats.m_Pinned == count / 10);
+    WALLET_CHECK(stats.m_Evicted > 0);
+    WALLET_CHECK(!stats.m_Hits && !stats.m_Misses); // the lookups of the writer are not counted
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        Amount amount = 0;
+        WALLET_CHECK(storage::getTxParameter(db, makeTxID(i), TxParameterID::Amount, amount));
+        WALLET_CHECK(amount == i);
+    }
+    stats = db.getTxParametersCacheStats();
+    WALLET_CHECK(stats.m_Txs < count);
+    WALLET_CHECK(stats.m_Hits + stats.m_Misses == count);
+}
+
 void TestSelect3()
 {
     cout << "\nWallet database coin selection 3 test\n";
@@ -1402,10 +1775,122 @@ void TestExchangeRates()
     }
 }
 
+void TestBatch()
+{
+    cout << "\nWallet database batch test\n";
+    auto db = createSqliteWalletDB();
+
+    WalletDBObserver w;
+    db->Subscribe(&w);
+    {
+        WalletDbBatch batch(*db);
+
+        Coin c1 = CreateAvailCoin(5);
+        db->storeCoin(c1);
+        Coin c2 = CreateAvailCoin(7);
+        db->storeCoin(c2);
+        w.m_changes.push({ ChangeAction::Added, { c1, c2 } });
+
+        {
+            WalletDbBatch nested(*db);
+
+            c1.m_status = Coin::Outgoing;
+            db->saveCoin(c1);
+            c2.m_status = Coin::Outgoing;
+            db->saveCoin(c2);
+
+            nested.commit();
+        }
+
+        // must be merged with the previous update of the same coin
+        c1.m_status = Coin::Spent;
+        db->saveCoin(c1);
+        w.m_changes.push({ ChangeAction::Updated, { c1, c2 } });
+
+        // nothing is delivered until the batch ends
+        WALLET_CHECK(w.m_changes.size() == 2);
+
+        batch.commit();
+        WALLET_CHECK(w.m_changes.empty());
+    }
+
+    // not committed explicitly (early return, exception): the destructor doesn't invoke the observers
+    Coin c3 = CreateAvailCoin(9);
+    {
+        WalletDbBatch batch(*db);
+        db->storeCoin(c3);
+        w.m_changes.push({ ChangeAction::Added, { c3 } });
+    }
+    WALLET_CHECK(w.m_changes.size() == 1);
+    io::Reactor::get_Current().run_once();
+    WALLET_CHECK(w.m_changes.empty());
+    db->Unsubscribe(&w);
+
+    // the changes must be committed by the end of the batch
+    auto db2 = WalletDB::open("wallet.db", string("pass123"));
+    size_t count = 0;
+    db2->visitCoins([&count](const Coin&)
+    {
+        ++count;
+        return true;
+    });
+    WALLET_CHECK(count == 3);
+}
+
+void TestHistoryCache()
+{
+    cout << "\nWallet database header history cache test\n";
+
+    const Height hMaxBacklog = Rules::get().MaxRollback * 2;
+    const Height hTop = hMaxBacklog + 100;
+
+    {
+        auto db = createSqliteWalletDB();
+        auto& history = db->get_History();
+
+        Block::SystemState::Full s;
+        WALLET_CHECK(!history.get_Tip(s));
+
+        std::vector<Block::SystemState::Full> v(hTop);
+        for (Height h = 1; h <= hTop; h++)
+        {
+            auto& x = v[h - 1];
+            ZeroObject(x);
+            x.m_Height = h;
+            x.m_TimeStamp = h * 60;
+        }
+        history.AddStates(&v.front(), v.size());
+
+        WALLET_CHECK(history.get_Tip(s) && s.m_Height == hTop && s.m_TimeStamp == hTop * 60);
+        WALLET_CHECK(history.get_At(s, 50) && s.m_Height == 50 && s.m_TimeStamp == 50 * 60);
+
+        history.DeleteFrom(hTop - 9);
+        WALLET_CHECK(history.get_Tip(s) && s.m_Height == hTop - 10);
+        WALLET_CHECK(!history.get_At(s, hTop - 5));
+
+        db->ShrinkHistory();
+        WALLET_CHECK(!history.get_At(s, 50));
+        WALLET_CHECK(history.get_At(s, hTop - 10 - hMaxBacklog + 1));
+    }
+
+    {
+        // the states must be persisted
+        auto db = WalletDB::open("wallet.db", string("pass123"));
+        auto& history = db->get_History();
+
+        Block::SystemState::Full s;
+        WALLET_CHECK(history.get_Tip(s) && s.m_Height == hTop - 10 && s.m_TimeStamp == (hTop - 10) * 60);
+        WALLET_CHECK(!history.get_At(s, 50));
+        WALLET_CHECK(history.get_At(s, hTop - 10 - hMaxBacklog + 1) && s.m_TimeStamp == (hTop - 10 - hMaxBacklog + 1) * 60);
+    }
+}
+
 }
 
-int main() 
+int main(int argc, char* argv[])
 {
+    bool isBenchmark = (argc > 1) && !strcmp(argv[1], "--benchmark");
+
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
     logLevel = LOG_LEVEL_VERBOSE;
@@ -1419,6 +1904,8 @@ int main()
     TestWalletDataBase();
     TestStoreCoins();
     TestStoreTxRecord();
+    TestTxSummary();
+    TestTxHistoryBenchmark(isBenchmark);
     TestTxRollback();
     TestUTXORollback();
     TestSelect();
@@ -1428,11 +1915,15 @@ int main()
     TestSelect5();
     TestSelect6();
     TestAddresses();
+    TestPaging();
     TestExportImportTx();
     TestTxParameters();
+    TestTxParametersCache();
     TestWalletMessages();
     TestNotifications();
     TestExchangeRates();
+    TestHistoryCache();
+    TestBatch();
 
     return WALLET_CHECK_RESULT;
 }
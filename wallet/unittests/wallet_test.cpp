@@ -2313,6 +2313,322 @@ void TestKeyKeeper()
     WALLET_CHECK(tx.IsValid(ctx));
 }
 
+void TestThreadedKeyKeeper()
+{
+    cout << "\nTesting threaded key keeper...\n";
+
+    io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+    io::Reactor::Scope scope(*mainReactor);
+
+    Key::IKdf::Ptr pKdf;
+    HKdf::Create(pKdf, 12345U);
+
+    auto pLocal = std::make_shared<LocalPrivateKeyKeeperStd>(pKdf);
+    pLocal->m_State.m_hvLast = 334U;
+    pLocal->m_State.Generate();
+
+    // forwards CreateOutput, emulates signing, checks that signing never overlaps with other methods
+    struct CheckingKeyKeeper
+        :public PrivateKeyKeeper_AsyncNotify
+    {
+        IPrivateKeyKeeper2::Ptr m_pKk;
+        std::atomic<uint32_t> m_Shared{ 0 };
+        std::atomic<uint32_t> m_Exclusive{ 0 };
+        std::atomic<uint32_t> m_MaxShared{ 0 };
+        std::atomic<bool> m_Overlap{ false };
+
+        Status::Type Sign()
+        {
+            if (m_Exclusive++ || m_Shared)
+                m_Overlap = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            m_Exclusive--;
+            return Status::Success;
+        }
+
+        void Enter()
+        {
+            uint32_t n = ++m_Shared;
+            if (m_Exclusive)
+                m_Overlap = true;
+            if (m_MaxShared < n)
+                m_MaxShared = n;
+        }
+
+        Status::Type Leave(Status::Type ret)
+        {
+            m_Shared--;
+            return ret;
+        }
+
+        Status::Type InvokeSync(Method::get_Kdf& m) override { Enter(); return Leave(m_pKk->InvokeSync(m)); }
+        Status::Type InvokeSync(Method::get_NumSlots& m) override { Enter(); return Leave(m_pKk->InvokeSync(m)); }
+        Status::Type InvokeSync(Method::CreateOutput& m) override { Enter(); return Leave(m_pKk->InvokeSync(m)); }
+        Status::Type InvokeSync(Method::SignReceiver&) override { return Sign(); }
+        Status::Type InvokeSync(Method::SignSender&) override { return Sign(); }
+        Status::Type InvokeSync(Method::SignSplit&) override { return Sign(); }
+    };
+
+    struct MyHandler
+        :public IPrivateKeyKeeper2::Handler
+    {
+        std::vector<size_t>* m_pDone;
+        size_t m_Index;
+        size_t m_Total;
+
+        void OnDone(IPrivateKeyKeeper2::Status::Type n) override
+        {
+            WALLET_CHECK(IPrivateKeyKeeper2::Status::Success == n);
+            m_pDone->push_back(m_Index);
+            if (m_pDone->size() == m_Total)
+                io::Reactor::get_Current().stop();
+        }
+    };
+
+    auto pChecking = std::make_shared<CheckingKeyKeeper>();
+    pChecking->m_pKk = pLocal;
+
+    const uint32_t nThreads = 4;
+    {
+        auto pKk = std::make_shared<ThreadedPrivateKeyKeeper>(pChecking, nThreads);
+
+        const size_t nCalls = 40;
+        std::vector<IPrivateKeyKeeper2::Method::CreateOutput> vOuts(nCalls);
+        std::vector<IPrivateKeyKeeper2::Method::SignSplit> vSplits(nCalls);
+        std::vector<size_t> vDone;
+
+        for (size_t i = 0; i < nCalls; i++)
+        {
+            auto pHandler = std::make_shared<MyHandler>();
+            pHandler->m_pDone = &vDone;
+            pHandler->m_Index = i;
+            pHandler->m_Total = nCalls;
+
+            // every 8th call is exclusive
+            if (i % 8 == 7)
+                pKk->InvokeAsync(vSplits[i], pHandler);
+            else
+            {
+                vOuts[i].m_hScheme = Rules::get().pForks[1].m_Height;
+                vOuts[i].m_Cid = CoinID(100 + i, i, Key::Type::Regular);
+                pKk->InvokeAsync(vOuts[i], pHandler);
+            }
+        }
+
+        mainReactor->run();
+
+        WALLET_CHECK(vDone.size() == nCalls);
+        for (size_t i = 0; i < vDone.size(); i++)
+        {
+            // completions are reported in the order of invocation
+            WALLET_CHECK(vDone[i] == i);
+        }
+
+        for (size_t i = 0; i < nCalls; i++)
+        {
+            if (i % 8 == 7)
+                continue;
+
+            WALLET_CHECK(vOuts[i].m_pResult);
+            Point::Native comm;
+            WALLET_CHECK(vOuts[i].m_pResult->IsValid(vOuts[i].m_hScheme, comm));
+        }
+
+        WALLET_CHECK(!pChecking->m_Overlap);
+        cout << "Max concurrent outputs: " << pChecking->m_MaxShared.load() << endl;
+    }
+
+    // several key keepers on the same pool, each keeps its own ordering
+    {
+        struct SharedHandler
+            :public IPrivateKeyKeeper2::Handler
+        {
+            std::vector<size_t>* m_pDone;
+            size_t m_Index;
+            size_t* m_pRemaining;
+
+            void OnDone(IPrivateKeyKeeper2::Status::Type n) override
+            {
+                WALLET_CHECK(IPrivateKeyKeeper2::Status::Success == n);
+                m_pDone->push_back(m_Index);
+                if (!--*m_pRemaining)
+                    io::Reactor::get_Current().stop();
+            }
+        };
+
+        auto pPool = std::make_shared<ThreadedPrivateKeyKeeper::Pool>(2);
+
+        const size_t nKeepers = 3;
+        const size_t nCalls = 12;
+        std::shared_ptr<CheckingKeyKeeper> ppChecking[nKeepers];
+        std::shared_ptr<ThreadedPrivateKeyKeeper> ppKk[nKeepers];
+        std::vector<IPrivateKeyKeeper2::Method::CreateOutput> pvOuts[nKeepers];
+        std::vector<IPrivateKeyKeeper2::Method::SignSplit> pvSplits[nKeepers];
+        std::vector<size_t> pvDone[nKeepers];
+        size_t nRemaining = nCalls * (nKeepers - 1);
+
+        for (size_t iKk = 0; iKk < nKeepers; iKk++)
+        {
+            ppChecking[iKk] = std::make_shared<CheckingKeyKeeper>();
+            ppChecking[iKk]->m_pKk = pLocal;
+            ppKk[iKk] = std::make_shared<ThreadedPrivateKeyKeeper>(ppChecking[iKk], pPool);
+            pvOuts[iKk].resize(nCalls);
+            pvSplits[iKk].resize(nCalls);
+        }
+
+        for (size_t i = 0; i < nCalls; i++)
+        {
+            for (size_t iKk = 0; iKk < nKeepers; iKk++)
+            {
+                auto pHandler = std::make_shared<SharedHandler>();
+                pHandler->m_pDone = pvDone + iKk;
+                pHandler->m_Index = i;
+                pHandler->m_pRemaining = &nRemaining;
+
+                if (i % 4 == 3)
+                    ppKk[iKk]->InvokeAsync(pvSplits[iKk][i], pHandler);
+                else
+                {
+                    pvOuts[iKk][i].m_hScheme = Rules::get().pForks[1].m_Height;
+                    pvOuts[iKk][i].m_Cid = CoinID(200 + i, i, Key::Type::Regular);
+                    ppKk[iKk]->InvokeAsync(pvOuts[iKk][i], pHandler);
+                }
+            }
+        }
+
+        // the last one is destroyed with its calls still pending, the others must not be affected
+        ppKk[nKeepers - 1].reset();
+
+        mainReactor->run();
+
+        for (size_t iKk = 0; iKk + 1 < nKeepers; iKk++)
+        {
+            WALLET_CHECK(pvDone[iKk].size() == nCalls);
+            for (size_t i = 0; i < pvDone[iKk].size(); i++)
+                WALLET_CHECK(pvDone[iKk][i] == i);
+
+            WALLET_CHECK(!ppChecking[iKk]->m_Overlap);
+        }
+
+        WALLET_CHECK(pvDone[nKeepers - 1].empty());
+    }
+
+    // benchmark, outputs of a split tx
+    std::vector<uint32_t> vOutputs = { 10, 100 };
+#ifdef NDEBUG
+    vOutputs.push_back(1000);
+#endif // NDEBUG
+
+    std::vector<uint32_t> vThreads = { 1 };
+    if (std::thread::hardware_concurrency() > 1)
+        vThreads.push_back(std::thread::hardware_concurrency());
+
+    for (uint32_t nOutputs : vOutputs)
+    {
+        for (uint32_t n : vThreads)
+        {
+            auto pKk = std::make_shared<ThreadedPrivateKeyKeeper>(pLocal, n);
+
+            std::vector<IPrivateKeyKeeper2::Method::CreateOutput> vOuts(nOutputs);
+            std::vector<size_t> vDone;
+
+            helpers::StopWatch sw;
+            sw.start();
+
+            for (uint32_t i = 0; i < nOutputs; i++)
+            {
+                auto pHandler = std::make_shared<MyHandler>();
+                pHandler->m_pDone = &vDone;
+                pHandler->m_Index = i;
+                pHandler->m_Total = nOutputs;
+
+                vOuts[i].m_hScheme = Rules::get().pForks[1].m_Height;
+                vOuts[i].m_Cid = CoinID(100 + i, i, Key::Type::Regular);
+                pKk->InvokeAsync(vOuts[i], pHandler);
+            }
+
+            mainReactor->run();
+            sw.stop();
+
+            WALLET_CHECK(vDone.size() == nOutputs);
+            cout << "Outputs: " << nOutputs << ", threads: " << n << ", elapsed: " << sw.milliseconds() << " ms" << endl;
+        }
+    }
+}
+
+void TestBbsMiner()
+{
+    cout << "\nTesting shared BBS miner...\n";
+
+    io::Reactor::Ptr mainReactor{ io::Reactor::create() };
+    io::Reactor::Scope scope(*mainReactor);
+
+    WALLET_CHECK(BbsMiner::get() == BbsMiner::get());
+
+    std::vector<BbsMiner::Task::Ptr> vMined;
+    std::unique_ptr<BbsMiner::Client> pC1, pC2;
+
+    auto fnOnMined = [&](std::unique_ptr<BbsMiner::Client>& pC)
+    {
+        while (auto pTask = pC->Pop())
+            vMined.push_back(std::move(pTask));
+
+        if (vMined.size() == 2)
+            mainReactor->stop();
+    };
+
+    pC1 = std::make_unique<BbsMiner::Client>([&]() { fnOnMined(pC1); });
+    pC2 = std::make_unique<BbsMiner::Client>([&]() { fnOnMined(pC2); });
+
+    auto fnCreateTask = [](uint32_t nPriority, uint8_t nMsg)
+    {
+        auto pTask = std::make_shared<BbsMiner::Task>();
+        pTask->m_Msg.m_Channel = 11;
+        pTask->m_Msg.m_Message.assign(10, nMsg);
+        pTask->m_Priority = nPriority;
+        proto::Bbs::get_HashPartial(pTask->m_hpPartial, pTask->m_Msg);
+        return pTask;
+    };
+
+    const BbsMiner::Metrics& m = BbsMiner::Metrics::get();
+    uint64_t nHashes = m.m_Hashes.get();
+    uint64_t nCancelled = m.m_Cancelled.get();
+
+    auto pLow = fnCreateTask(0, 1);
+    auto pHigh = fnCreateTask(1, 2);
+
+    // different clients share the same queue, the higher priority goes first
+    pC1->Push(pLow);
+    pC2->Push(pHigh);
+
+    helpers::StopWatch sw;
+    sw.start();
+    mainReactor->run();
+    sw.stop();
+
+    WALLET_CHECK(vMined.size() == 2);
+    WALLET_CHECK((vMined[0] == pHigh) && (vMined[1] == pLow));
+    for (const auto& pTask : vMined)
+    {
+        ECC::Hash::Value hv;
+        ECC::Hash::Processor hp = pTask->m_hpPartial;
+        hp << pTask->m_Msg.m_TimePosted << pTask->m_Msg.m_Nonce >> hv;
+        WALLET_CHECK(proto::Bbs::IsHashValid(hv));
+    }
+
+    WALLET_CHECK(m.m_Cancelled.get() == nCancelled);
+    WALLET_CHECK(m.m_Hashes.get() > nHashes);
+
+    // the pending tasks are cancelled with their client
+    auto pCancelled = fnCreateTask(0, 4);
+    pC1->Push(pCancelled);
+    pC1.reset();
+    WALLET_CHECK(pCancelled->m_Done);
+    WALLET_CHECK(m.m_Cancelled.get() == nCancelled + 1);
+
+    cout << "Mined 2 messages in " << sw.milliseconds() << " ms, hashes: " << m.m_Hashes.get() - nHashes << endl;
+}
+
 
 #if defined(BEAM_HW_WALLET)
 
@@ -2579,6 +2895,8 @@ int main()
     storage::HookErrors();
 
     TestKeyKeeper();
+    TestThreadedKeyKeeper();
+    TestBbsMiner();
 
     //TestBbsDecrypt();
 
@@ -100,7 +100,7 @@ public:
     void saveCoins(const std::vector<Coin>&) override {}
     void removeCoins(const std::vector<Coin::ID>&) override {}
     void removeCoin(const Coin::ID&) override {}
-    void visitCoins(std::function<bool(const Coin& coin)>) override {}
+    void visitCoins(std::function<bool(const Coin& coin)>, uint64_t, uint64_t) override {}
     void setVarRaw(const char*, const void*, size_t) override {}
     bool getVarRaw(const char*, void*, int) const override { return false; }
     bool getBlob(const char* name, ByteBuffer& var) const override { return false; }
@@ -110,8 +110,14 @@ public:
 
     void Subscribe(IWalletDbObserver* observer) override {}
     void Unsubscribe(IWalletDbObserver* observer) override {}
+    void beginBatch() override {}
+    void endBatch() override {}
+    void endBatchDeferred() override {}
 
     std::vector<TxDescription> getTxHistory(wallet::TxType, uint64_t, int) const override { return {}; };
+    std::vector<TxDescription> getTxHistory(const TxHistoryFilter&, uint64_t, int) const override { return {}; };
+    std::vector<TxDescription> getActiveTxs() const override { return {}; };
+    std::vector<TxDescription> getTxsConfirmedAbove(Height) const override { return {}; };
     boost::optional<TxDescription> getTx(const TxID&) const override { return boost::optional<TxDescription>{}; };
     void saveTx(const TxDescription& p) override
     {
@@ -134,6 +140,7 @@ public:
     void rollbackTx(const TxID&) override {}
 
     std::vector<WalletAddress> getAddresses(bool own) const override { return {}; }
+    void visitAddresses(bool own, std::function<bool(const WalletAddress& address)> func) const override {}
 
     WalletAddress m_LastAdddr;
 